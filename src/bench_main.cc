@@ -0,0 +1,387 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: bench_main.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Microbenchmark of the integral kernels. Every kernel is timed on a single thread for each angular-momentum class
+// and contraction depth, and one JSON object per class is written to the standard output (JSON lines), e.g.,
+//   {"kernel": "ERIBatch", "backend": "rys", "class": [2,1,1,0], "nprim": 3, ..., "integrals_per_second": 1.2e+08, ...}
+// Usage: Benchmark [--lmax L] [--nprim 1,3,6] [--time seconds] [--kernel ERIBatch,DFIntTask,...]
+
+#include <stddef.h>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <bagel_config.h>
+#include <src/util/timer.h>
+#include <src/util/parallel/resources.h>
+#include <src/util/math/bufferpool.h>
+#include <src/util/parallel/mpi_interface.h>
+#include <src/molecule/molecule.h>
+#include <src/df/dfinttask.h>
+#include <src/integral/rys/eribatch.h>
+#include <src/integral/rys/gradbatch.h>
+#include <src/integral/rys/naibatch.h>
+#include <src/integral/rys/smalleribatch.h>
+#include <src/integral/rys/breitbatch.h>
+#include <src/integral/ecp/ecpbatch.h>
+#include <src/integral/ecp/soecpbatch.h>
+#ifdef LIBINT_INTERFACE
+  #include <src/integral/libint/libint.h>
+  #include <src/integral/libint/glibint.h>
+#endif
+
+using namespace std;
+using namespace bagel;
+
+static MPI_Interface c;
+MPI_Interface* bagel::mpi__ = &c;
+
+Resources b(1);
+Resources* bagel::resources__ = &b;
+
+namespace {
+
+struct Options {
+  int lmax = 3;
+  vector<int> nprim = {1, 3};
+  double time = 0.1;
+  set<string> kernel;
+
+  bool run(const string& name) const { return kernel.empty() || kernel.count(name); }
+};
+
+vector<string> split(const string& s) {
+  vector<string> out;
+  stringstream ss(s);
+  string item;
+  while (getline(ss, item, ','))
+    if (!item.empty()) out.push_back(item);
+  return out;
+}
+
+Options parse(int argc, char** argv) {
+  Options out;
+  for (int i = 1; i < argc; ++i) {
+    const string key = argv[i];
+    if (i+1 == argc)
+      throw runtime_error("missing value for " + key);
+    const string value = argv[++i];
+    if (key == "--lmax") {
+      out.lmax = stoi(value);
+    } else if (key == "--nprim") {
+      out.nprim.clear();
+      for (auto& j : split(value)) out.nprim.push_back(stoi(j));
+    } else if (key == "--time") {
+      out.time = stod(value);
+    } else if (key == "--kernel") {
+      for (auto& j : split(value)) out.kernel.insert(j);
+    } else {
+      throw runtime_error("unknown option " + key);
+    }
+  }
+  return out;
+}
+
+// even-tempered primitives contracted into one function
+shared_ptr<Shell> make_shell(const int l, const int nprim, const array<double,3>& pos, const double scale = 1.0) {
+  vector<double> exponents;
+  for (int i = 0; i != nprim; ++i)
+    exponents.push_back(scale * 8.0 / (1 << (2*i)) + 0.1);
+  vector<vector<double>> contraction{vector<double>(nprim, 1.0)};
+  return make_shared<Shell>(true, pos, l, exponents, contraction, vector<pair<int,int>>{{0, nprim}});
+}
+
+// a few quartets of the same class at different geometries are cycled so that screening and caching do not bias the timing
+constexpr int ngeom = 4;
+
+array<double,3> position(const int icenter, const int igeom) {
+  return {{0.3*icenter + 0.1*igeom, -0.2*icenter + 0.05*igeom, 0.45*icenter}};
+}
+
+struct Result {
+  string kernel;
+  string backend;
+  vector<int> angular;
+  int nprim;
+  size_t nint;       // integrals per call (per derivative component for gradients)
+  size_t nquartet;   // primitive quartets (or pairs) per call
+};
+
+// calls f(igeom) repeatedly for at least the given time and prints the throughput
+void measure(const Result& r, const Options& opt, function<double(const int)> f) {
+  double check = 0.0;
+  for (int i = 0; i != ngeom; ++i)
+    check += f(i);
+
+  size_t ncall = 0lu;
+  double elapsed = 0.0;
+  Timer timer;
+  do {
+    for (int i = 0; i != ngeom; ++i)
+      f(i);
+    ncall += ngeom;
+    elapsed += timer.tick();
+  } while (elapsed < opt.time);
+
+  if (mpi__->rank() != 0) return;
+  stringstream ss;
+  ss << "{\"kernel\": \"" << r.kernel << "\", \"backend\": \"" << r.backend << "\", \"class\": [";
+  for (auto i = r.angular.begin(); i != r.angular.end(); ++i)
+    ss << (i == r.angular.begin() ? "" : ",") << *i;
+  ss << "], \"nprim\": " << r.nprim << ", \"calls\": " << ncall << scientific << setprecision(6)
+     << ", \"seconds\": " << elapsed
+     << ", \"integrals_per_second\": " << r.nint * ncall / elapsed
+     << ", \"quartets_per_second\": " << r.nquartet * ncall / elapsed
+     << ", \"checksum\": " << check << "}";
+  cout << ss.str() << endl;
+}
+
+template<typename T>
+size_t product(const T& shells, function<size_t(const Shell&)> f) {
+  size_t out = 1lu;
+  for (auto& i : shells)
+    if (!i->dummy()) out *= f(*i);
+  return out;
+}
+
+// (la lb|lc ld) with la >= lb, lc >= ld, and (la,lb) >= (lc,ld)
+vector<array<int,4>> four_center_classes(const int lmax) {
+  vector<array<int,4>> out;
+  for (int la = 0; la <= lmax; ++la)
+    for (int lb = 0; lb <= la; ++lb)
+      for (int lc = 0; lc <= la; ++lc)
+        for (int ld = 0; ld <= lc; ++ld)
+          if (make_pair(lc,ld) <= make_pair(la,lb))
+            out.push_back({{la, lb, lc, ld}});
+  return out;
+}
+
+// (la|lb lc) with lb >= lc
+vector<array<int,3>> three_center_classes(const int lmax) {
+  vector<array<int,3>> out;
+  for (int la = 0; la <= lmax+1; ++la)
+    for (int lb = 0; lb <= lmax; ++lb)
+      for (int lc = 0; lc <= lb; ++lc)
+        out.push_back({{la, lb, lc}});
+  return out;
+}
+
+
+template<typename TBatch>
+void four_center(const string name, const string backend, const Options& opt, const int nblock, function<shared_ptr<TBatch>(const array<shared_ptr<const Shell>,4>&)> make) {
+  if (!opt.run(name)) return;
+  for (auto& cls : four_center_classes(opt.lmax)) {
+    for (auto& np : opt.nprim) {
+      vector<array<shared_ptr<const Shell>,4>> quartets;
+      for (int g = 0; g != ngeom; ++g)
+        quartets.push_back({{make_shell(cls[0], np, position(0, g)), make_shell(cls[1], np, position(1, g), 0.7),
+                             make_shell(cls[2], np, position(2, g), 1.3), make_shell(cls[3], np, position(3, g), 0.4)}});
+      Result r{name, backend, vector<int>(cls.begin(), cls.end()), np,
+               product(quartets[0], [](const Shell& s) { return s.nbasis(); }) * nblock,
+               product(quartets[0], [](const Shell& s) { return s.num_primitive(); })};
+      measure(r, opt, [&](const int g) {
+        shared_ptr<TBatch> batch = make(quartets[g]);
+        batch->compute();
+        return batch->data(0)[0];
+      });
+    }
+  }
+}
+
+
+// (la|lb lc) with the small-component basis of (lb lc), as used in the relativistic DF
+template<typename TBatch>
+void three_center(const string name, const string backend, const Options& opt, const int nblock, const bool relativistic) {
+  if (!opt.run(name)) return;
+  auto dummy = make_shared<const Shell>(true);
+  for (auto& cls : three_center_classes(opt.lmax)) {
+    for (auto& np : opt.nprim) {
+      vector<array<shared_ptr<const Shell>,4>> quartets;
+      for (int g = 0; g != ngeom; ++g) {
+        array<shared_ptr<Shell>,3> s{{make_shell(cls[0], np, position(0, g), 2.0), make_shell(cls[1], np, position(1, g)), make_shell(cls[2], np, position(2, g), 0.6)}};
+        if (relativistic) {
+          s[1]->init_relativistic();
+          s[2]->init_relativistic();
+        }
+        quartets.push_back({{dummy, s[0], s[1], s[2]}});
+      }
+      Result r{name, backend, vector<int>(cls.begin(), cls.end()), np,
+               product(quartets[0], [](const Shell& s) { return s.nbasis(); }) * nblock,
+               product(quartets[0], [](const Shell& s) { return s.num_primitive(); })};
+      measure(r, opt, [&](const int g) {
+        TBatch batch(quartets[g], 0.0);
+        batch.compute();
+        return batch.data(0)[0];
+      });
+    }
+  }
+}
+
+
+// DF 3-index tasks as used in DFDist_ints::compute_3index: one basis shell pair with a set of auxiliary shells of the same class
+void df_task(const Options& opt) {
+  const string name = "DFIntTask";
+  if (!opt.run(name)) return;
+  constexpr int naux_shell = 8;
+  auto dummy = make_shared<const Shell>(true);
+  for (auto& cls : three_center_classes(opt.lmax)) {
+    for (auto& np : opt.nprim) {
+      auto b1 = make_shell(cls[1], np, position(1, 0));
+      auto b2 = make_shell(cls[2], np, position(2, 0), 0.6);
+      vector<shared_ptr<const Shell>> aux;
+      for (int i = 0; i != naux_shell; ++i)
+        aux.push_back(make_shell(cls[0], np, position(0, i), 2.0/(i+1)));
+      const size_t naux = aux.front()->nbasis() * naux_shell;
+      const size_t nbin = b1->nbasis() + b2->nbasis();
+      auto adist = make_shared<const StaticDist>(naux, 1);
+      array<shared_ptr<DFBlock>,1> blk{{make_shared<DFBlock>(adist, adist, naux, nbin, nbin, 0, 0, 0)}};
+      blk[0]->zero();
+
+      Result r{name, "rys", vector<int>(cls.begin(), cls.end()), np,
+               naux * b1->nbasis() * b2->nbasis(),
+               naux_shell * product(array<shared_ptr<const Shell>,3>{{aux.front(), b1, b2}}, [](const Shell& s) { return s.num_primitive(); })};
+      measure(r, opt, [&](const int g) {
+        DFIntTaskClass<ERIBatch,1> task;
+        for (int i = 0; i != naux_shell; ++i)
+          task.emplace_back((array<shared_ptr<const Shell>,4>{{dummy, aux[(i+g) % naux_shell], b1, b2}}),
+                            (array<int,3>{{static_cast<int>(b1->nbasis()), 0, static_cast<int>(aux.front()->nbasis()*i)}}), blk);
+        task.compute();
+        // the first element of the (b1, b2) block
+        return blk[0]->data()[naux*nbin*b1->nbasis()];
+      });
+    }
+  }
+}
+
+
+// 2-index Breit integrals (la|lb) between auxiliary shells as in BreitInt. Six components are computed.
+void breit(const Options& opt) {
+  const string name = "BreitBatch";
+  if (!opt.run(name)) return;
+  auto dummy = make_shared<const Shell>(true);
+  for (int la = 0; la <= opt.lmax+1; ++la) {
+    for (int lb = 0; lb <= la; ++lb) {
+      for (auto& np : opt.nprim) {
+        vector<array<shared_ptr<const Shell>,4>> quartets;
+        for (int g = 0; g != ngeom; ++g)
+          quartets.push_back({{make_shell(la, np, position(0, g), 2.0), dummy, make_shell(lb, np, position(1, g)), dummy}});
+        Result r{name, "rys", vector<int>{la, lb}, np,
+                 product(quartets[0], [](const Shell& s) { return s.nbasis(); }) * 6,
+                 product(quartets[0], [](const Shell& s) { return s.num_primitive(); })};
+        measure(r, opt, [&](const int g) {
+          BreitBatch batch(quartets[g], 1.0);
+          batch.compute();
+          return batch.data(0)[0];
+        });
+      }
+    }
+  }
+}
+
+
+template<typename TBatch>
+void two_center(const string name, const Options& opt, shared_ptr<const Molecule> mol) {
+  if (!opt.run(name)) return;
+  for (int la = 0; la <= opt.lmax; ++la) {
+    for (int lb = 0; lb <= la; ++lb) {
+      for (auto& np : opt.nprim) {
+        vector<array<shared_ptr<const Shell>,2>> pairs;
+        for (int g = 0; g != ngeom; ++g)
+          pairs.push_back({{make_shell(la, np, position(0, g)), make_shell(lb, np, position(1, g), 0.7)}});
+        Result r{name, "rys", vector<int>{la, lb}, np,
+                 product(pairs[0], [](const Shell& s) { return s.nbasis(); }),
+                 product(pairs[0], [](const Shell& s) { return s.num_primitive(); }) * mol->natom()};
+        measure(r, opt, [&](const int g) {
+          TBatch batch(pairs[g], mol);
+          batch.compute();
+          return batch.data(0)[0];
+        });
+      }
+    }
+  }
+}
+
+// three nuclei; the first one carries a small-core ECP with s to f projectors and p to f spin-orbit terms
+shared_ptr<const Molecule> make_molecule(const bool ecp) {
+  vector<shared_ptr<const Atom>> atoms;
+  const vector<string> names{"i", "o", "h"};
+  for (int i = 0; i != 3; ++i) {
+    const array<double,3> pos{{-0.8*i+0.1, 0.5*i, 0.2}};
+    vector<shared_ptr<const Shell>> shells{make_shell(0, 1, pos)};
+    if (ecp && i == 0) {
+      vector<shared_ptr<const Shell_ECP>> ecpshells;
+      vector<shared_ptr<const Shell_ECP>> soshells;
+      for (int l = 0; l <= 3; ++l)
+        ecpshells.push_back(make_shared<const Shell_ECP>(pos, l, vector<double>{20.0/(l+1), 2.5}, vector<double>{40.0, -5.0}, vector<int>{2, 2}));
+      for (int l = 1; l <= 3; ++l)
+        soshells.push_back(make_shared<const Shell_ECP>(pos, l, vector<double>{10.0/(l+1), 1.5}, vector<double>{3.0, -1.0}, vector<int>{2, 2}));
+      atoms.push_back(make_shared<const Atom>(names[i], "bench", shells, ecpshells, 28, 3, soshells));
+    } else if (ecp) {
+      // ECPBatch expects ECP parameters on every atom
+      atoms.push_back(make_shared<const Atom>(names[i], "bench", shells, make_shared<const ECP>()));
+    } else {
+      atoms.push_back(make_shared<const Atom>(names[i], "bench", shells));
+    }
+  }
+  return make_shared<const Molecule>(atoms, vector<shared_ptr<const Atom>>());
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  try {
+    const Options opt = parse(argc, argv);
+
+    four_center<ERIBatch>("ERIBatch", "rys", opt, 1, [](const array<shared_ptr<const Shell>,4>& s) { return make_shared<ERIBatch>(s, 0.0); });
+    four_center<GradBatch>("GradBatch", "rys", opt, 12, [](const array<shared_ptr<const Shell>,4>& s) { return make_shared<GradBatch>(s, 0.0); });
+#ifdef LIBINT_INTERFACE
+    four_center<Libint>("ERIBatch", "libint", opt, 1, [](const array<shared_ptr<const Shell>,4>& s) { return make_shared<Libint>(s); });
+    four_center<GLibint>("GradBatch", "libint", opt, 12, [](const array<shared_ptr<const Shell>,4>& s) { return make_shared<GLibint>(s); });
+#endif
+
+    df_task(opt);
+    three_center<SmallERIBatch>("SmallERIBatch", "rys", opt, SmallERIBatch::Nblocks(), true);
+    breit(opt);
+
+    two_center<NAIBatch>("NAIBatch", opt, make_molecule(false));
+    two_center<ECPBatch>("ECPBatch", opt, make_molecule(true));
+    two_center<SOECPBatch>("SOECPBatch", opt, make_molecule(true));
+
+    cerr << "  stack memory: " << resources__->num_stacks() << " stacks, high-water mark "
+         << resources__->stack_high_water() / 1048576.0 << " MB" << endl;
+    cerr << BufferPool::get().statistics() << endl;
+  } catch (const exception& e) {
+    cerr << "  ERROR: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
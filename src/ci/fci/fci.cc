@@ -99,6 +99,8 @@ void FCI::common_init() {
   thresh_ = idata_->get<double>("thresh_fci", thresh_);
   print_thresh_ = idata_->get<double>("print_thresh", 0.05);
   restart_ = idata_->get<bool>("restart", false);
+  sigma_block_ = idata_->get<int>("sigma_block", 0);
+  sigma_memory_ = idata_->get<double>("sigma_memory", 1024.0);
 
   if (nstate_ < 0) nstate_ = idata_->get<int>("nstate", 1);
   nguess_ = idata_->get<int>("nguess", nstate_);
@@ -288,6 +290,17 @@ vector<pair<bitset<nbit__> , bitset<nbit__>>> FCI::detseeds(const int ndet) cons
 }
 
 
+pair<int,int> FCI::sigma_batch(const int nroot, const int ij, const size_t lenab) const {
+  // E takes ij*lenab and D takes ijblock*lenab words per root; at least one root and one pair are processed at a time
+  const size_t mem = static_cast<size_t>(sigma_memory_ * (1LU << 20)) / sizeof(double);
+  int ijblock = sigma_block_ > 0 ? min(sigma_block_, ij) : ij;
+  if (sigma_block_ <= 0 && mem < 2*ij*lenab)
+    ijblock = max(1, min(ij, static_cast<int>(mem/lenab) - ij));
+  const int nbatch = max(1, static_cast<int>(min(static_cast<size_t>(nroot), mem/((ij+ijblock)*lenab))));
+  return {nbatch, ijblock};
+}
+
+
 void FCI::print_header() const {
   cout << "  ---------------------------" << endl;
   cout << "        FCI calculation      " << endl;
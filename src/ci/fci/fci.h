@@ -37,6 +37,10 @@ class FCI : public FCI_base {
     std::shared_ptr<DavidsonDiag<Civec>> davidson_;
 
     bool dipoles_;
+    // number of ij pairs for which the D intermediates are formed at a time in form_sigma (0: set from sigma_memory_)
+    int sigma_block_ = 0;
+    // memory (in MB) for the D and E intermediates in form_sigma
+    double sigma_memory_ = 1024.0;
 
   private:
     // serialization
@@ -128,6 +132,11 @@ class FCI : public FCI_base {
     // functions for RDM computation
     void sigma_2a1(std::shared_ptr<const Civec> cc, std::shared_ptr<Dvec> d) const;
     void sigma_2a2(std::shared_ptr<const Civec> cc, std::shared_ptr<Dvec> d) const;
+    // batched over roots, D(Phib, Phia, root, ij) for ij in [ijstart, ijstart+nij)
+    void sigma_2a1(const std::vector<std::shared_ptr<const Civec>>& cc, std::shared_ptr<Dvec> d, const int ijstart, const int nij) const;
+    void sigma_2a2(const std::vector<std::shared_ptr<const Civec>>& cc, std::shared_ptr<Dvec> d, const int ijstart, const int nij) const;
+    // number of roots per batch and of ij pairs per D block in form_sigma
+    std::pair<int,int> sigma_batch(const int nroot, const int ij, const size_t lenab) const;
 
     std::shared_ptr<const CIWfn> conv_to_ciwfn() const override;
     std::shared_ptr<const Reference> conv_to_ref() const override { return nullptr; }
@@ -48,35 +48,54 @@ shared_ptr<Dvec> HarrisonZarrabian::form_sigma(shared_ptr<const Dvec> ccvec, sha
   shared_ptr<Determinants> base_det = space_->finddet(nelea_, neleb_);
   shared_ptr<Determinants> int_det = space_->finddet(nelea_-1,neleb_-1);
 
-  /* d and e are only used in the alpha-beta case and exist in the (nalpha-1)(nbeta-1) spaces */
-  auto d = make_shared<Dvec>(int_det, ij);
-  auto e = make_shared<Dvec>(int_det, ij);
-
+  // the unconverged states are processed together in batches (see below)
+  vector<shared_ptr<const Civec>> cc;
+  vector<shared_ptr<Civec>> sigma;
   for (int istate = 0; istate != nstate_; ++istate) {
-    Timer pdebug(3);
     if (conv[istate]) continue;
-    shared_ptr<const Civec> cc = ccvec->data(istate);
-    shared_ptr<Civec> sigma = sigmavec->data(istate);
+    cc.push_back(ccvec->data(istate));
+    sigma.push_back(sigmavec->data(istate));
+  }
+  const int nroot = cc.size();
+  if (nroot == 0)
+    return sigmavec;
 
-    // (taskaa)
-    sigma_aa(cc, sigma, jop);
-    pdebug.tick_print("taskaa");
+  Timer pdebug(3);
 
+  for (int i = 0; i != nroot; ++i) {
+    // (taskaa)
+    sigma_aa(cc[i], sigma[i], jop);
     // (taskbb)
-    sigma_bb(cc, sigma, jop);
-    pdebug.tick_print("taskbb");
-
-    // (2ab) alpha-beta contributions
-    /* Resembles more the Knowles & Handy FCI terms */
-    d->zero();
-
-    sigma_2ab_1(cc, d);
-    pdebug.tick_print("task2ab-1");
-
-    sigma_2ab_2(d, e, jop);
-    pdebug.tick_print("task2ab-2");
+    sigma_bb(cc[i], sigma[i], jop);
+  }
+  pdebug.tick_print("taskaa,bb");
+
+  // (2ab) alpha-beta contributions
+  /* Resembles more the Knowles & Handy FCI terms */
+  /* d and e are only used in the alpha-beta case and exist in the (nalpha-1)(nbeta-1) spaces.
+     They are stored as (Phib, Phia, root, ij) so that the roots are stacked in one DGEMM.
+     The roots are processed in batches and d is formed for ijblock pairs of ij at a time to stay within sigma_memory_. */
+  int nbatch, ijblock;
+  tie(nbatch, ijblock) = sigma_batch(nroot, ij, int_det->size());
+
+  for (int rstart = 0; rstart < nroot; rstart += nbatch) {
+    const int nr = min(nbatch, nroot-rstart);
+    const vector<shared_ptr<const Civec>> ccb(cc.begin()+rstart, cc.begin()+rstart+nr);
+    const vector<shared_ptr<Civec>> sigmab(sigma.begin()+rstart, sigma.begin()+rstart+nr);
+
+    auto d = make_shared<Dvec>(int_det, ijblock*nr);
+    auto e = make_shared<Dvec>(int_det, ij*nr);
+    e->zero();
+
+    for (int ijstart = 0; ijstart < ij; ijstart += ijblock) {
+      const int nij = min(ijblock, ij-ijstart);
+      d->zero();
+      sigma_2ab_1(ccb, d, ijstart, nij);
+      sigma_2ab_2(d, e, jop, ijstart, nij);
+    }
+    pdebug.tick_print("task2ab-1,2");
 
-    sigma_2ab_3(sigma, e);
+    sigma_2ab_3(sigmab, e);
     pdebug.tick_print("task2ab-3");
   }
 
@@ -122,21 +141,22 @@ void HarrisonZarrabian::sigma_bb(shared_ptr<const Civec> cc, shared_ptr<Civec> s
 }
 
 
-void HarrisonZarrabian::sigma_2ab_1(shared_ptr<const Civec> cc, shared_ptr<Dvec> d) const {
+void HarrisonZarrabian::sigma_2ab_1(const vector<shared_ptr<const Civec>>& cc, shared_ptr<Dvec> d, const int ijstart, const int nij) const {
   const int norb = norb_;
+  const int nroot = cc.size();
+  assert(d->ij() >= nroot*nij);
 
-  shared_ptr<const Determinants> bdet = cc->det(); // base
   shared_ptr<const Determinants> tdet = d->det();  // target
 
-  const int lbs = bdet->lenb();
-  const double* source_base = cc->data();
+  TaskQueue<HZTaskAB1<double>> tasks(nij*nroot);
 
-  TaskQueue<HZTaskAB1<double>> tasks(norb*norb);
-
-  for (int k = 0; k < norb; ++k) {
-    for (int l = 0; l < norb; ++l) {
-      double* target_base = d->data(k*norb + l)->data();
-      tasks.emplace_back(tdet, lbs, source_base, target_base, k, l);
+  for (int kl = ijstart; kl != ijstart+nij; ++kl) {
+    const int k = kl / norb;
+    const int l = kl % norb;
+    for (int r = 0; r != nroot; ++r) {
+      const int lbs = cc[r]->det()->lenb(); // base
+      double* target_base = d->data((kl-ijstart)*nroot + r)->data();
+      tasks.emplace_back(tdet, lbs, cc[r]->data(), target_base, k, l);
     }
   }
 
@@ -144,31 +164,36 @@ void HarrisonZarrabian::sigma_2ab_1(shared_ptr<const Civec> cc, shared_ptr<Dvec>
 }
 
 
-void HarrisonZarrabian::sigma_2ab_2(shared_ptr<Dvec> d, shared_ptr<Dvec> e, shared_ptr<const MOFile> jop) const {
-  const int ij = d->ij();
-  const int lenab = d->lena() * d->lenb();
-  dgemm_("n", "n", lenab, ij, ij, 1.0, d->data(), lenab, jop->mo2e_ptr(), ij, 0.0, e->data(), lenab);
+void HarrisonZarrabian::sigma_2ab_2(shared_ptr<const Dvec> d, shared_ptr<Dvec> e, shared_ptr<const MOFile> jop, const int ijstart, const int nij) const {
+  const int ij = norb_*norb_;
+  const int nroot = e->ij() / ij;
+  // roots are stacked in the leading dimension
+  const int lenabr = d->lena() * d->lenb() * nroot;
+  dgemm_("n", "n", lenabr, ij, nij, 1.0, d->data(), lenabr, jop->mo2e_ptr()+ijstart, ij, 1.0, e->data(), lenabr);
 }
 
 
-void HarrisonZarrabian::sigma_2ab_3(shared_ptr<Civec> sigma, shared_ptr<Dvec> e) const {
-  const shared_ptr<const Determinants> base_det = sigma->det();
+void HarrisonZarrabian::sigma_2ab_3(const vector<shared_ptr<Civec>>& sigma, shared_ptr<const Dvec> e) const {
+  const int nroot = sigma.size();
+  const shared_ptr<const Determinants> base_det = sigma.front()->det();
   const shared_ptr<const Determinants> int_det = e->det();
 
   const int norb = norb_;
   const int lbt = base_det->lenb();
   const int lbs = int_det->lenb();
-  double* target_base = sigma->data();
 
   for (int i = 0; i < norb; ++i) {
     for (int j = 0; j < norb; ++j) {
-      const double* source_base = e->data(i*norb + j)->data();
-      for (auto& aiter : int_det->phiupa(i)) {
-        double *target = target_base + aiter.target*lbt;
-        const double *source = source_base + aiter.source*lbs;
-        for (auto& biter : int_det->phiupb(j)) {
-          const double sign = aiter.sign * biter.sign;
-          target[biter.target] += sign * source[biter.source];
+      for (int r = 0; r != nroot; ++r) {
+        double* target_base = sigma[r]->data();
+        const double* source_base = e->data((i*norb + j)*nroot + r)->data();
+        for (auto& aiter : int_det->phiupa(i)) {
+          double *target = target_base + aiter.target*lbt;
+          const double *source = source_base + aiter.source*lbs;
+          for (auto& biter : int_det->phiupb(j)) {
+            const double sign = aiter.sign * biter.sign;
+            target[biter.target] += sign * source[biter.source];
+          }
         }
       }
     }
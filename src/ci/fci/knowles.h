@@ -45,9 +45,10 @@ class KnowlesHandy : public FCI {
     // run-time functions
     void sigma_1(std::shared_ptr<const Civec> cc, std::shared_ptr<Civec> sigma, std::shared_ptr<const MOFile> jop) const;
     void sigma_3(std::shared_ptr<const Civec> cc, std::shared_ptr<Civec> sigma, std::shared_ptr<const MOFile> jop) const;
-    void sigma_2b (std::shared_ptr<Dvec> d, std::shared_ptr<Dvec> e, std::shared_ptr<const MOFile> jop) const;
-    void sigma_2c1(std::shared_ptr<Civec> sigma, std::shared_ptr<const Dvec> e) const;
-    void sigma_2c2(std::shared_ptr<Civec> sigma, std::shared_ptr<const Dvec> e) const;
+    // D and E intermediates hold a batch of unconverged roots (see form_sigma)
+    void sigma_2b (std::shared_ptr<const Dvec> d, std::shared_ptr<Dvec> e, std::shared_ptr<const MOFile> jop, const int ijstart, const int nij) const;
+    void sigma_2c1(const std::vector<std::shared_ptr<Civec>>& sigma, std::shared_ptr<const Dvec> e) const;
+    void sigma_2c2(const std::vector<std::shared_ptr<Civec>>& sigma, std::shared_ptr<const Dvec> e) const;
 
   private:
     friend class boost::serialization::access;
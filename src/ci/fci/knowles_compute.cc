@@ -41,49 +41,69 @@ shared_ptr<Dvec> KnowlesHandy::form_sigma(shared_ptr<const Dvec> ccvec, shared_p
   auto sigmavec = make_shared<Dvec>(ccvec->det(), nstate);
   sigmavec->zero();
 
-  // we need two vectors for intermediate quantities
-  auto d = make_shared<Dvec>(ccvec->det(), ij);
-  auto e = make_shared<Dvec>(ccvec->det(), ij);
-
-
+  // the unconverged states are processed together in batches (see below)
+  vector<shared_ptr<const Civec>> cc;
+  vector<shared_ptr<Civec>> sigma;
   for (int istate = 0; istate != nstate; ++istate) {
-    Timer pdebug(3);
     if (conv[istate]) continue;
-    shared_ptr<const Civec> cc = ccvec->data(istate);
-    shared_ptr<Civec> sigma = sigmavec->data(istate);
+    cc.push_back(ccvec->data(istate));
+    sigma.push_back(sigmavec->data(istate));
+  }
+  const int nroot = cc.size();
+  if (nroot == 0)
+    return sigmavec;
+
+  Timer pdebug(3);
+
+  // (task1) one-electron alpha: sigma(Psib, Psi'a) += sign h'(ij) C(Psib, Psia)
+  for (int i = 0; i != nroot; ++i)
+    sigma_1(cc[i], sigma[i], jop);
+  pdebug.tick_print("task1");
 
-    // (task1) one-electron alpha: sigma(Psib, Psi'a) += sign h'(ij) C(Psib, Psia)
-    sigma_1(cc, sigma, jop);
-    pdebug.tick_print("task1");
+  // (task2) two electron contributions
+  // D and E intermediates are stored as (Phib, Phia, root, ij) so that the roots are stacked in one DGEMM.
+  // The roots are processed in batches and D is formed for ijblock pairs of ij at a time to stay within sigma_memory_.
+  int nbatch, ijblock;
+  tie(nbatch, ijblock) = sigma_batch(nroot, ij, ccvec->det()->size());
 
-    // (task2) two electron contributions
-    d->zero();
+  for (int rstart = 0; rstart < nroot; rstart += nbatch) {
+    const int nr = min(nbatch, nroot-rstart);
+    const vector<shared_ptr<const Civec>> ccb(cc.begin()+rstart, cc.begin()+rstart+nr);
+    const vector<shared_ptr<Civec>> sigmab(sigma.begin()+rstart, sigma.begin()+rstart+nr);
 
-    // step (c) (task2a-1) D(Phib, Phia, ij) += sign C(Psib, Phi'a)
-    sigma_2a1(cc, d);
-    pdebug.tick_print("task2a-1");
+    auto d = make_shared<Dvec>(ccvec->det(), ijblock*nr);
+    auto e = make_shared<Dvec>(ccvec->det(), ij*nr);
+    e->zero();
 
-    // step (d) (task2a-2) D(Phib, Phia, ij) += sign C(Psib', Phia)
-    sigma_2a2(cc, d);
-    pdebug.tick_print("task2a-2");
+    for (int ijstart = 0; ijstart < ij; ijstart += ijblock) {
+      const int nij = min(ijblock, ij-ijstart);
+      d->zero();
 
-    // step (e) (task2b) E(Phib, Phia, kl) = D(Psib, Phia, ij) (ij|kl)
-    sigma_2b(d, e, jop);
-    pdebug.tick_print("task2b");
+      // step (c) (task2a-1) D(Phib, Phia, ij) += sign C(Psib, Phi'a)
+      sigma_2a1(ccb, d, ijstart, nij);
+
+      // step (d) (task2a-2) D(Phib, Phia, ij) += sign C(Psib', Phia)
+      sigma_2a2(ccb, d, ijstart, nij);
+
+      // step (e) (task2b) E(Phib, Phia, kl) += D(Psib, Phia, ij) (ij|kl)
+      sigma_2b(d, e, jop, ijstart, nij);
+    }
+    pdebug.tick_print("task2a,2b");
 
     // step (f) (task2c-1) sigma(Phib, Phia') += sign E(Psib, Phia, kl)
-    sigma_2c1(sigma, e);
+    sigma_2c1(sigmab, e);
     pdebug.tick_print("task2c-1");
 
     // step (g) (task2c-2) sigma(Phib', Phia) += sign E(Psib, Phia, kl)
-    sigma_2c2(sigma, e);
+    sigma_2c2(sigmab, e);
     pdebug.tick_print("task2c-2");
-
-    // (task3) one-electron beta: sigma(Psib', Psia) += sign h'(ij) C(Psib, Psia)
-    sigma_3(cc, sigma, jop);
-    pdebug.tick_print("task3");
   }
 
+  // (task3) one-electron beta: sigma(Psib', Psia) += sign h'(ij) C(Psib, Psia)
+  for (int i = 0; i != nroot; ++i)
+    sigma_3(cc[i], sigma[i], jop);
+  pdebug.tick_print("task3");
+
   return sigmavec;
 }
 
@@ -119,6 +139,43 @@ void FCI::sigma_2a2(shared_ptr<const Civec> cc, shared_ptr<Dvec> d) const {
   }
 }
 
+// Batched versions of the above: D(Phib, Phia, root, ij) for ij in [ijstart, ijstart+nij)
+void FCI::sigma_2a1(const vector<shared_ptr<const Civec>>& cc, shared_ptr<Dvec> d, const int ijstart, const int nij) const {
+  const int nroot = cc.size();
+  assert(d->ij() >= nroot*nij);
+  const int lb = d->lenb();
+  for (int ip = 0; ip != nij; ++ip) {
+    for (int r = 0; r != nroot; ++r) {
+      assert(d->det() == cc[r]->det());
+      const double* const source_base = cc[r]->data();
+      double* const target_base = d->data(ip*nroot + r)->data();
+      for (auto& iter : d->det()->phia(ijstart + ip)) {
+        const double sign = static_cast<double>(iter.sign);
+        double* const target_array = target_base + iter.source*lb;
+        blas::ax_plus_y_n(sign, source_base + iter.target*lb, lb, target_array);
+      }
+    }
+  }
+}
+
+void FCI::sigma_2a2(const vector<shared_ptr<const Civec>>& cc, shared_ptr<Dvec> d, const int ijstart, const int nij) const {
+  const int nroot = cc.size();
+  assert(d->ij() >= nroot*nij);
+  const int la = d->lena();
+  for (int i = 0; i < la; ++i) {
+    for (int r = 0; r != nroot; ++r) {
+      const double* const source_array0 = cc[r]->element_ptr(0, i);
+      for (int ip = 0; ip != nij; ++ip) {
+        double* const target_array0 = d->data(ip*nroot + r)->element_ptr(0, i);
+        for (auto& iter : d->det()->phib(ijstart + ip)) {
+          const double sign = static_cast<double>(iter.sign);
+          target_array0[iter.source] += sign * source_array0[iter.target];
+        }
+      }
+    }
+  }
+}
+
 void KnowlesHandy::sigma_1(shared_ptr<const Civec> cc, shared_ptr<Civec> sigma, shared_ptr<const MOFile> jop) const {
   assert(cc->det() == sigma->det());
   const int ij = (norb_*(norb_+1))/2;
@@ -132,29 +189,35 @@ void KnowlesHandy::sigma_1(shared_ptr<const Civec> cc, shared_ptr<Civec> sigma,
   }
 }
 
-void KnowlesHandy::sigma_2c1(shared_ptr<Civec> sigma, shared_ptr<const Dvec> e) const {
+void KnowlesHandy::sigma_2c1(const vector<shared_ptr<Civec>>& sigma, shared_ptr<const Dvec> e) const {
+  const int nroot = sigma.size();
   const int lb = e->lenb();
-  const int ij = e->ij();
+  const int ij = e->ij() / nroot;
   for (int ip = 0; ip != ij; ++ip) {
-    const double* const source_base = e->data(ip)->data();
-    for (auto& iter : e->det()->phia(ip)) {
-      const double sign = static_cast<double>(iter.sign);
-      double* const target_array = sigma->element_ptr(0, iter.target);
-      blas::ax_plus_y_n(sign, source_base + lb*iter.source, lb, target_array);
+    for (int r = 0; r != nroot; ++r) {
+      const double* const source_base = e->data(ip*nroot + r)->data();
+      for (auto& iter : e->det()->phia(ip)) {
+        const double sign = static_cast<double>(iter.sign);
+        double* const target_array = sigma[r]->element_ptr(0, iter.target);
+        blas::ax_plus_y_n(sign, source_base + lb*iter.source, lb, target_array);
+      }
     }
   }
 }
 
-void KnowlesHandy::sigma_2c2(shared_ptr<Civec> sigma, shared_ptr<const Dvec> e) const {
+void KnowlesHandy::sigma_2c2(const vector<shared_ptr<Civec>>& sigma, shared_ptr<const Dvec> e) const {
+  const int nroot = sigma.size();
   const int la = e->lena();
-  const int ij = e->ij();
+  const int ij = e->ij() / nroot;
   for (int i = 0; i < la; ++i) {
-    double* const target_array0 = sigma->element_ptr(0, i);
-    for (int ip = 0; ip != ij; ++ip) {
-      const double* const source_array0 = e->data(ip)->element_ptr(0, i);
-      for (auto& iter : e->det()->phib(ip)) {
-        const double sign = static_cast<double>(iter.sign);
-        target_array0[iter.target] += sign * source_array0[iter.source];
+    for (int r = 0; r != nroot; ++r) {
+      double* const target_array0 = sigma[r]->element_ptr(0, i);
+      for (int ip = 0; ip != ij; ++ip) {
+        const double* const source_array0 = e->data(ip*nroot + r)->element_ptr(0, i);
+        for (auto& iter : e->det()->phib(ip)) {
+          const double sign = static_cast<double>(iter.sign);
+          target_array0[iter.target] += sign * source_array0[iter.source];
+        }
       }
     }
   }
@@ -178,12 +241,11 @@ void KnowlesHandy::sigma_3(shared_ptr<const Civec> cc, shared_ptr<Civec> sigma,
   }
 }
 
-void KnowlesHandy::sigma_2b(shared_ptr<Dvec> d, shared_ptr<Dvec> e, shared_ptr<const MOFile> jop) const {
-  const int la = d->lena();
-  const int lb = d->lenb();
-  const int ij = d->ij();
-  const int lenab = la*lb;
-  dgemm_("n", "n", lenab, ij, ij, 0.5, d->data(), lenab, jop->mo2e_ptr(), ij,
-                                  0.0, e->data(), lenab);
+void KnowlesHandy::sigma_2b(shared_ptr<const Dvec> d, shared_ptr<Dvec> e, shared_ptr<const MOFile> jop, const int ijstart, const int nij) const {
+  const int ij = (norb_*(norb_+1))/2;
+  const int nroot = e->ij() / ij;
+  // roots are stacked in the leading dimension
+  const int lenabr = d->lena()*d->lenb()*nroot;
+  dgemm_("n", "n", lenabr, ij, nij, 0.5, d->data(), lenabr, jop->mo2e_ptr()+ijstart, ij,
+                                    1.0, e->data(), lenabr);
 }
-
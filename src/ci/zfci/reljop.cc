@@ -81,7 +81,7 @@ tuple<list<shared_ptr<RelDFHalf>>,list<shared_ptr<RelDFHalf>>>
     auto breitint = make_shared<BreitInt>(geom);
     list<shared_ptr<Breit2Index>> breit_2index;
     for (int i = 0; i != breitint->Nblocks(); ++i) {
-      breit_2index.push_back(make_shared<Breit2Index>(breitint->index(i), breitint->data(i), geom->df()->data2()));
+      breit_2index.push_back(make_shared<Breit2Index>(breitint->index(i), breitint->data(i), geom->df()->metric()));
       if (breitint->not_diagonal(i))
         breit_2index.push_back(breit_2index.back()->cross());
     }
@@ -29,8 +29,14 @@
 using namespace std;
 using namespace bagel;
 
-Breit2Index::Breit2Index(pair<const int, const int> index, shared_ptr<const Matrix> breit, shared_ptr<const Matrix> dat2)
- : index_(index), data_(make_shared<Matrix>(*dat2 % *breit * *dat2)) {
+Breit2Index::Breit2Index(pair<const int, const int> index, shared_ptr<const Matrix> breit, const double* metric) : index_(index) {
+  const int n = breit->ndim();
+  assert(breit->mdim() == n);
+  Matrix tmp(n, n, true);
+  dgemm_("T", "N", n, n, n, 1.0, metric, n, breit->data(), n, 0.0, tmp.data(), n);
+  auto out = make_shared<Matrix>(n, n, true);
+  dgemm_("N", "N", n, n, n, 1.0, tmp.data(), n, metric, n, 0.0, out->data(), n);
+  data_ = out;
 }
 
 
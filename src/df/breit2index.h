@@ -40,7 +40,8 @@ class Breit2Index {
     std::shared_ptr<const Matrix> data_;
 
   public:
-    Breit2Index(std::pair<const int, const int>, std::shared_ptr<const Matrix> breit, std::shared_ptr<const Matrix> data2);
+    // metric is the naux x naux 2-index matrix (see ParallelDF::metric)
+    Breit2Index(std::pair<const int, const int>, std::shared_ptr<const Matrix> breit, const double* metric);
     Breit2Index(std::pair<const int, const int> index, std::shared_ptr<const Matrix> data) : index_(index), data_(data) { }
 
     std::shared_ptr<const Matrix> data() const { return data_; }
@@ -0,0 +1,270 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: cholesky.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <src/df/cholesky.h>
+
+using namespace std;
+using namespace bagel;
+
+DFDist_cholesky::DFDist_cholesky(const int nbas, shared_ptr<DFBlock> block)
+ : DFDist(nbas, block->adist_now()->nele(), block, nullptr, make_shared<Matrix>(block->adist_now()->nele(), block->adist_now()->nele(), true)) {
+  data2_->unit();
+}
+
+
+shared_ptr<DFBlock> DFDist_cholesky::decompose(const vector<shared_ptr<const Atom>>& atoms, const int nbas, const double thresh) {
+  Timer time;
+#ifdef LIBINT_INTERFACE
+  using Batch = AutoERIBatch;
+#else
+  using Batch = ERIBatch;
+#endif
+
+  vector<shared_ptr<const Shell>> shells;
+  vector<int> offset;
+  for (auto& i : atoms)
+    shells.insert(shells.end(), i->shells().begin(), i->shells().end());
+  vector<int> shellof;
+  for (int i = 0; i != shells.size(); ++i) {
+    offset.push_back(shellof.size());
+    shellof.insert(shellof.end(), shells[i]->nbasis(), i);
+  }
+  const size_t n = nbas;
+  const size_t nn = n*n;
+  assert(shellof.size() == n);
+
+  const int myrank = mpi__->rank();
+  const int nproc = mpi__->size();
+
+  // shell pairs (r <= s); the rows (rs) of the vectors are distributed over processes by shell pairs in a round-robin fashion.
+  // Only the rows (rs) with r in shell r and s in shell s are stored; (sr) is recovered by symmetry when the DFBlock is formed.
+  vector<pair<int,int>> pairs;
+  vector<int> pairof(shells.size()*shells.size());
+  vector<size_t> lrows(nproc);
+  vector<size_t> loffset;
+  for (int s = 0; s != shells.size(); ++s)
+    for (int r = 0; r <= s; ++r) {
+      pairof[r+shells.size()*s] = pairof[s+shells.size()*r] = pairs.size();
+      loffset.push_back(lrows[pairs.size()%nproc]);
+      lrows[pairs.size()%nproc] += shells[r]->nbasis()*shells[s]->nbasis();
+      pairs.emplace_back(r, s);
+    }
+  const size_t nrow = lrows[myrank];
+  auto owner = [&nproc](const int p) { return p%nproc; };
+
+  // diagonal integrals (rs|rs) of the local rows
+  vector<double> diag(nrow);
+  vector<int> pairofrow(nrow);
+  vector<double> pairmax(pairs.size());
+  {
+    TaskQueue<function<void(void)>> tasks(pairs.size()/nproc+1);
+    for (int p = myrank; p < pairs.size(); p += nproc)
+      tasks.emplace_back([&, p]() {
+        const int r = pairs[p].first;
+        const int s = pairs[p].second;
+        const int nr = shells[r]->nbasis();
+        const int ns = shells[s]->nbasis();
+        Batch batch(array<shared_ptr<const Shell>,4>{{shells[s], shells[r], shells[s], shells[r]}}, 0.0);
+        batch.compute();
+        const double* data = batch.data();
+        for (int js = 0; js != ns; ++js)
+          for (int jr = 0; jr != nr; ++jr) {
+            const double d = data[js+ns*(jr+nr*(js+ns*jr))];
+            diag[loffset[p]+jr+nr*js] = d;
+            pairofrow[loffset[p]+jr+nr*js] = p;
+            pairmax[p] = max(pairmax[p], d);
+          }
+      });
+    tasks.compute();
+  }
+  if (nproc > 1)
+    mpi__->allreduce(pairmax.data(), pairmax.size());
+
+  // integral columns (rs|tu) with the pair (tu) fixed are computed only for the pairs with sqrt(max(rs|rs) max(tu|tu)) above this value
+  const double screen = thresh * 1.0e-3;
+  // vectors are only formed from the columns whose residual diagonal is larger than span times the largest one
+  const double span = 1.0e-2;
+
+  // local rows of the Cholesky vectors; each column is dimensioned by nrow
+  vector<double> lvec;
+  size_t nvec = 0;
+  while (true) {
+    // the largest residual diagonal element and its shell pair among all processes
+    array<double,2> local{{0.0, 0.0}};
+    if (nrow) {
+      const size_t imax = max_element(diag.begin(), diag.end()) - diag.begin();
+      local = {{diag[imax], static_cast<double>(pairofrow[imax])}};
+    }
+    vector<double> global(2*nproc);
+    mpi__->allgather(local.data(), 2, global.data(), 2);
+    int imax = 0;
+    for (int i = 1; i != nproc; ++i)
+      if (global[2*i] > global[2*imax])
+        imax = i;
+    const double dmax = global[2*imax];
+    if (dmax < thresh || nvec == nn) break;
+
+    // pivot shell pair (R, S) that contains the largest diagonal element
+    const int pivot = lround(global[2*imax+1]);
+    const int R = pairs[pivot].first;
+    const int S = pairs[pivot].second;
+    const int nR = shells[R]->nbasis();
+    const int nS = shells[S]->nbasis();
+    const int nq = nR*nS;
+
+    // integrals (rs|RS) for the local rows; shell pairs are distributed over threads
+    vector<double> column(nrow*nq);
+    {
+      TaskQueue<function<void(void)>> tasks(pairs.size()/nproc+1);
+      for (int p = myrank; p < pairs.size(); p += nproc) {
+        if (sqrt(pairmax[p]*pairmax[pivot]) < screen) continue;
+        tasks.emplace_back([&, p]() {
+          const int r = pairs[p].first;
+          const int s = pairs[p].second;
+          const int nr = shells[r]->nbasis();
+          const int ns = shells[s]->nbasis();
+          Batch batch(array<shared_ptr<const Shell>,4>{{shells[s], shells[r], shells[S], shells[R]}}, 0.0);
+          batch.compute();
+          const double* data = batch.data();
+          for (int jR = 0; jR != nR; ++jR)
+            for (int jS = 0; jS != nS; ++jS) {
+              double* const target = column.data() + loffset[p] + nrow*(jR+nR*jS);
+              for (int jr = 0; jr != nr; ++jr)
+                for (int js = 0; js != ns; ++js, ++data)
+                  target[jr+nr*js] = *data;
+            }
+        });
+      }
+      tasks.compute();
+    }
+
+    // the owner of the pivot rows sends the existing vectors, the integral block (RS|RS) and the residual diagonal at these rows
+    vector<double> pivotrows(nq*nvec + nq*nq + nq);
+    double* const lq = pivotrows.data();
+    double* const block = lq + nq*nvec;
+    double* const dq = block + nq*nq;
+    if (owner(pivot) == myrank) {
+      for (size_t k = 0; k != nvec; ++k)
+        copy_n(lvec.data()+loffset[pivot]+nrow*k, nq, lq+nq*k);
+      for (int q = 0; q != nq; ++q)
+        copy_n(column.data()+loffset[pivot]+nrow*q, nq, block+nq*q);
+      copy_n(diag.data()+loffset[pivot], nq, dq);
+    }
+    if (nproc > 1)
+      mpi__->broadcast(pivotrows.data(), pivotrows.size(), owner(pivot));
+
+    // residual with respect to the existing vectors
+    if (nvec) {
+      if (nrow)
+        dgemm_("N", "T", nrow, nq, nvec, -1.0, lvec.data(), nrow, lq, nq, 1.0, column.data(), nrow);
+      dgemm_("N", "T", nq, nq, nvec, -1.0, lq, nq, lq, nq, 1.0, block, nq);
+    }
+
+    // vectors from the columns of this shell pair in the order of their residual diagonals.
+    // The pivot rows are replicated in block and dq so that every process makes the same choices.
+    const double cut = max(thresh, span*dmax);
+    vector<bool> done(nq, false);
+    vector<double> vq(nq);
+    for (int iq = 0; iq != nq; ++iq) {
+      int q = -1;
+      for (int i = 0; i != nq; ++i)
+        if (!done[i] && (q < 0 || dq[i] > dq[q]))
+          q = i;
+      const double d = dq[q];
+      if (d < cut) break;
+      done[q] = true;
+
+      lvec.resize(nrow*(nvec+1));
+      double* const v = lvec.data() + nrow*nvec;
+      transform(column.data()+nrow*q, column.data()+nrow*(q+1), v, [&d](const double a) { return a/sqrt(d); });
+      transform(block+nq*q, block+nq*(q+1), vq.begin(), [&d](const double a) { return a/sqrt(d); });
+      for (int i = 0; i != nq; ++i)
+        if (!done[i]) {
+          blas::ax_plus_y_n(-vq[i], v, nrow, column.data()+nrow*i);
+          blas::ax_plus_y_n(-vq[i], vq.data(), nq, block+nq*i);
+        }
+      for (size_t i = 0; i != nrow; ++i)
+        diag[i] -= v[i]*v[i];
+      for (int i = 0; i != nq; ++i)
+        dq[i] -= vq[i]*vq[i];
+      for (int i = 0; i != nq; ++i)
+        if (done[i]) {
+          dq[i] = 0.0;
+          if (owner(pivot) == myrank)
+            diag[loffset[pivot]+i] = 0.0;
+        }
+      ++nvec;
+    }
+  }
+  if (nvec == 0)
+    throw runtime_error("No Cholesky vectors are formed. cholesky_thresh is too large.");
+  cout << "    * " << nvec << " Cholesky vectors are retained" << endl;
+  time.tick_print("Cholesky decomposition");
+
+  // the vectors are distributed evenly; each process receives the rows of its vectors from all the processes
+  auto adist = make_shared<const StaticDist>(nvec, nproc);
+  size_t astart, aend;
+  tie(astart, aend) = adist->range(myrank);
+  const size_t nloc = aend - astart;
+  auto out = make_shared<DFBlock>(adist, adist, nloc, n, n, astart, 0, 0);
+
+  vector<int> requests;
+  vector<vector<double>> recv(nproc);
+  for (int j = 0; j != nproc; ++j) {
+    if (j == myrank) continue;
+    size_t jstart, jend;
+    tie(jstart, jend) = adist->range(j);
+    if (nrow != 0 && jend != jstart)
+      requests.push_back(mpi__->request_send(lvec.data()+nrow*jstart, nrow*(jend-jstart), j, myrank));
+    if (lrows[j] != 0 && nloc != 0) {
+      recv[j].resize(lrows[j]*nloc);
+      requests.push_back(mpi__->request_recv(recv[j].data(), recv[j].size(), j, j));
+    }
+  }
+  if (nrow != 0 && nloc != 0)
+    recv[myrank].assign(lvec.begin()+nrow*astart, lvec.begin()+nrow*aend);
+  for (auto& i : requests)
+    mpi__->wait(i);
+  lvec.clear();
+  lvec.shrink_to_fit();
+
+  for (int p = 0; p != pairs.size(); ++p) {
+    const int j = owner(p);
+    if (recv[j].empty()) continue;
+    const int r = pairs[p].first;
+    const int s = pairs[p].second;
+    const int nr = shells[r]->nbasis();
+    const int ns = shells[s]->nbasis();
+    for (int js = 0; js != ns; ++js)
+      for (int jr = 0; jr != nr; ++jr) {
+        const double* source = recv[j].data() + loffset[p]+jr+nr*js;
+        double* const target0 = out->data() + nloc*(offset[r]+jr + n*(offset[s]+js));
+        double* const target1 = out->data() + nloc*(offset[s]+js + n*(offset[r]+jr));
+        for (size_t a = 0; a != nloc; ++a, source += lrows[j])
+          target0[a] = target1[a] = *source;
+      }
+  }
+  return out;
+}
@@ -0,0 +1,53 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: cholesky.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_DF_CHOLESKY_H
+#define __SRC_DF_CHOLESKY_H
+
+#include <src/df/df.h>
+
+namespace bagel {
+
+/*
+    DFDist_cholesky holds the pivoted Cholesky vectors L of the AO electron-repulsion integrals, (rs|tu) = sum_P L_P,rs L_P,tu,
+    in place of the 3-index DF integrals. The 2-index part is the unit matrix so that the rest of the DF machinery is used unchanged.
+    The decomposition is driven by the diagonal (rs|rs); the integral columns are computed for the entire shell pair of each pivot.
+*/
+
+class DFDist_cholesky : public DFDist {
+  protected:
+    // returns the local slice of the Cholesky vectors; vectors are added until the largest residual diagonal is below thresh
+    static std::shared_ptr<DFBlock> decompose(const std::vector<std::shared_ptr<const Atom>>& atoms, const int nbas, const double thresh);
+
+    DFDist_cholesky(const int nbas, std::shared_ptr<DFBlock> block);
+
+  public:
+    DFDist_cholesky(const int nbas, const std::vector<std::shared_ptr<const Atom>>& atoms, const double thresh)
+      : DFDist_cholesky(nbas, decompose(atoms, nbas, thresh)) { }
+};
+
+}
+
+#endif
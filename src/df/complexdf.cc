@@ -48,7 +48,9 @@ vector<shared_ptr<const DFDist>> ComplexDFDist::split_blocks() const {
   vector<shared_ptr<const DFDist>> out;
   for (int i = 0; i != block_.size()/2; ++i) {
     array<shared_ptr<DFBlock>,2> in = {{ block_[2*i], block_[2*i+1] }};
-    out.push_back(make_shared<const ComplexDFDist>(nindex1_, naux_, in, df_, data2_));
+    auto tmp = make_shared<ComplexDFDist>(nindex1_, naux_, in, df_);
+    tmp->set_data2(*this);
+    out.push_back(tmp);
   }
   return out;
 }
@@ -57,8 +59,10 @@ vector<shared_ptr<const DFDist>> ComplexDFDist::split_blocks() const {
 array<shared_ptr<const DFDist>,2> ComplexDFDist::split_real_imag() const {
   assert(nindex1_ == nindex2_);
   assert(block_.size() % 2 == 0);
-  auto outr = make_shared<DFDist>(nindex1_, naux_, nullptr, df_, data2_);
-  auto outi = make_shared<DFDist>(nindex1_, naux_, nullptr, df_, data2_);
+  auto outr = make_shared<DFDist>(nindex1_, naux_, nullptr, df_);
+  auto outi = make_shared<DFDist>(nindex1_, naux_, nullptr, df_);
+  outr->set_data2(*this);
+  outi->set_data2(*this);
   for (int i = 0; i != block_.size()/2; ++i) {
     outr->add_block(block_[2*i]);
     outi->add_block(block_[2*i+1]);
@@ -176,13 +180,13 @@ shared_ptr<ZMatrix> ComplexDFDist::complex_compute_Jop(const shared_ptr<const ZM
 
 shared_ptr<ZMatrix> ComplexDFDist::complex_compute_Jop(const shared_ptr<const ComplexDF_base> o, const shared_ptr<const ZMatrix> den, const bool onlyonce) const {
   // first compute |E*) = d_rs (D|rs) J^{-1}_DE
-  shared_ptr<const ZVectorB> tmp0 = o->complex_compute_cd(den, data2_, onlyonce);
+  shared_ptr<const ZVectorB> tmp0 = o->complex_compute_cd(den, metric(), onlyonce);
   // then compute J operator J_{rs} = |E*) (E|rs)
   return complex_compute_Jop_from_cd(tmp0);
 }
 
 
-shared_ptr<ComplexDFHalfDist> ComplexDFHalfDist::complex_apply_J(const shared_ptr<const Matrix> d) const {
+shared_ptr<ComplexDFHalfDist> ComplexDFHalfDist::complex_apply_J(const double* d) const {
   auto tmp = apply_J(d);
   auto out = make_shared<ComplexDFHalfDist>(tmp, nindex1_);
   out->block_ = tmp->block();
@@ -46,7 +46,7 @@ class ComplexDFDist : public DFDist, public ComplexDF_base {
 
     ComplexDFDist(const std::shared_ptr<const ParallelDF> df) : DFDist(df), ComplexDF_base() { }
 
-    bool has_2index() const { return data2_.get() != nullptr; }
+    bool has_2index() const { return has_data2(); }
     size_t nbasis0() const { return nindex2_; }
     size_t nbasis1() const { return nindex1_; }
     size_t naux() const { return naux_; }
@@ -163,8 +163,10 @@ class ComplexDFHalfDist : public DFHalfDist, public ComplexDF_base {
     ComplexDFHalfDist(const std::shared_ptr<const ParallelDF> df, const int nocc) : DFHalfDist(df, nocc), ComplexDF_base() { }
 
     std::shared_ptr<ZMatrix> complex_form_2index(std::shared_ptr<const ComplexDFHalfDist> o, const double a, const bool swap = false) const;
-    std::shared_ptr<ComplexDFHalfDist> complex_apply_J() const { return complex_apply_J(df_->data2()); }
-    std::shared_ptr<ComplexDFHalfDist> complex_apply_J(const std::shared_ptr<const Matrix> o) const;
+    std::shared_ptr<ComplexDFHalfDist> complex_apply_J() const { return complex_apply_J(df_->metric()); }
+    std::shared_ptr<ComplexDFHalfDist> complex_apply_J(const std::shared_ptr<const Matrix> o) const { return complex_apply_J(o->data()); }
+    // d is a naux x naux matrix
+    std::shared_ptr<ComplexDFHalfDist> complex_apply_J(const double* d) const;
 
     std::shared_ptr<ComplexDFFullDist> complex_compute_second_transform(const ZMatView c) const;
     template<typename T, class = typename std::enable_if<btas::is_boxtensor<T>::value>::type>
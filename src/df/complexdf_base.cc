@@ -41,9 +41,9 @@ void ComplexDF_base::assign_complex_blocks(ParallelDF& source) {
 }
 
 
-shared_ptr<ZVectorB> ComplexDF_base::complex_compute_cd(const shared_ptr<const ZMatrix> den, shared_ptr<const Matrix> dat2, const bool onlyonce) const {
+shared_ptr<ZVectorB> ComplexDF_base::complex_compute_cd(const shared_ptr<const ZMatrix> den, const double* metric, const bool onlyonce) const {
   if (real_block_.size() != 1 || imag_block_.size() !=1 ) throw logic_error("compute_Jop so far assumes block_.size() == 2 for complex integrals");
-  if (!dat2) throw logic_error("ComplexDF_base::compute_cd was called without 2-index integrals");
+  if (!metric) throw logic_error("ComplexDF_base::compute_cd was called without 2-index integrals");
 
   // D = (D|rs)*d_rs  (using zgemm3m-like algorithm for complex multiplication)
   shared_ptr<VectorB> tmpr, tmpi;
@@ -75,11 +75,10 @@ shared_ptr<ZVectorB> ComplexDF_base::complex_compute_cd(const shared_ptr<const Z
     outi->allreduce();
   }
 
-  *outr = *dat2 * *outr;
-  *outi = *dat2 * *outi;
-  if (!onlyonce) {
-    *outr = *dat2 * *outr;
-    *outi = *dat2 * *outi;
-  }
+  for (int i = 0; i != (onlyonce ? 1 : 2); ++i)
+    for (auto& out : {outr, outi}) {
+      const VectorB tmp(*out);
+      dgemv_("N", cnaux_, cnaux_, 1.0, metric, cnaux_, tmp.data(), 1, 0.0, out->data(), 1);
+    }
   return make_shared<ZVectorB>(*outr, *outi);
 }
@@ -51,7 +51,8 @@ class ComplexDF_base {
     std::shared_ptr<const DFBlock> real_block(int i) const { return real_block_[i]; }
     std::shared_ptr<const DFBlock> imag_block(int i) const { return imag_block_[i]; }
 
-    std::shared_ptr<ZVectorB> complex_compute_cd(const std::shared_ptr<const ZMatrix> den, std::shared_ptr<const Matrix> dat2, const bool onlyonce = false) const;
+    // metric is the naux x naux 2-index matrix (see ParallelDF::metric)
+    std::shared_ptr<ZVectorB> complex_compute_cd(const std::shared_ptr<const ZMatrix> den, const double* metric, const bool onlyonce = false) const;
 
     // call in constructor of derived class
     void assign_complex_blocks(ParallelDF& source);
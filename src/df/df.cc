@@ -25,8 +25,7 @@
 
 #include <src/df/df.h>
 #include <src/df/dfdistt.h>
-#include <src/integral/rys/eribatch.h>
-#include <src/integral/libint/libint.h>
+#include <src/integral/eribackend.h>
 
 using namespace std;
 using namespace bagel;
@@ -37,6 +36,8 @@ shared_ptr<DFDist> DFDist::copy() const {
   auto out = make_shared<DFDist>(df_);
   for (auto& i : block_)
     out->add_block(i->copy());
+  if (has_storage())
+    out->storage_ = storage_->copy();
   return out;
 }
 
@@ -45,6 +46,8 @@ shared_ptr<DFDist> DFDist::clone() const {
   auto out = make_shared<DFDist>(df_);
   for (auto& i : block_)
     out->add_block(i->clone());
+  if (has_storage())
+    out->storage_ = storage_->clone();
   return out;
 }
 
@@ -110,6 +113,8 @@ void DFDist::compute_2index(const vector<shared_ptr<const Shell>>& ashell, const
     data2_->inverse_half(throverlap);
     // will use data2_ within node
     data2_->localize();
+    if (!serial_)
+      share_data2();
     time.tick_print("computing inverse");
   }
 }
@@ -127,11 +132,7 @@ shared_ptr<const StaticDist> DFDist::make_table(const size_t astart) {
 
 
 pair<const double*, shared_ptr<RysInt>> DFDist::compute_batch(array<shared_ptr<const Shell>,4>& input) {
-#ifdef LIBINT_INTERFACE
-  shared_ptr<RysInt> eribatch = make_shared<Libint>(input);
-#else
-  shared_ptr<RysInt> eribatch = make_shared<ERIBatch>(input, 2.0);
-#endif
+  shared_ptr<RysInt> eribatch = make_eribatch(input, 2.0);
   eribatch->compute();
   return {eribatch->data(), eribatch};
 }
@@ -140,6 +141,8 @@ pair<const double*, shared_ptr<RysInt>> DFDist::compute_batch(array<shared_ptr<c
 shared_ptr<DFHalfDist> DFDist::compute_half_transform(const MatView c) const {
   const int nocc = c.extent(1);
   auto out = make_shared<DFHalfDist>(df_ ? df_ : shared_from_this(), nocc);
+  if (has_storage())
+    out->add_block(storage_->transform_second(c));
   for (auto& i : block_)
     out->add_block(i->transform_second(c));
   return out;
@@ -149,6 +152,9 @@ shared_ptr<DFHalfDist> DFDist::compute_half_transform(const MatView c) const {
 shared_ptr<DFHalfDist> DFDist::compute_half_transform_swap(const MatView c) const {
   const int nocc = c.extent(1);
   auto out = make_shared<DFHalfDist>(df_ ? df_ : shared_from_this(), nocc);
+  // AO integrals in DFStorage are symmetric in the last two indices
+  if (has_storage())
+    out->add_block(storage_->transform_second(c));
   for (auto& i : block_)
     out->add_block(i->transform_third(c)->swap());
   return out;
@@ -358,7 +364,7 @@ shared_ptr<DFFullDist> DFFullDist::swap() const {
 
 //////// apply J functions ////////
 
-shared_ptr<DFFullDist> DFFullDist::apply_J(const shared_ptr<const Matrix> d) const {
+shared_ptr<DFFullDist> DFFullDist::apply_J(const double* d) const {
   shared_ptr<DFFullDist> out = clone();
 #ifdef HAVE_MPI_H
   if (!serial_) {
@@ -384,7 +390,7 @@ shared_ptr<DFFullDist> DFFullDist::apply_J(const shared_ptr<const Matrix> d) con
 }
 
 
-shared_ptr<DFHalfDist> DFHalfDist::apply_J(const shared_ptr<const Matrix> d) const {
+shared_ptr<DFHalfDist> DFHalfDist::apply_J(const double* d) const {
   shared_ptr<DFHalfDist> out = clone();
 #ifdef HAVE_MPI_H
   if (!serial_) {
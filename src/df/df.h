@@ -25,8 +25,13 @@
 #ifndef __SRC_DF_DF_H
 #define __SRC_DF_DF_H
 
+#include <map>
 #include <src/df/paralleldf.h>
 #include <src/molecule/atom.h>
+#include <src/molecule/petite.h>
+#include <src/molecule/shellpair.h>
+#include <src/integral/rys/eribatch.h>
+#include <src/integral/eribackend.h>
 
 namespace bagel {
 
@@ -54,7 +59,7 @@ class DFDist : public ParallelDF {
 
     DFDist(const std::shared_ptr<const ParallelDF> df) : ParallelDF(df->naux(), df->nindex1(), df->nindex2(), df) { }
 
-    bool has_2index() const { return data2_.get() != nullptr; }
+    bool has_2index() const { return has_data2(); }
     size_t nbasis0() const { return nindex2_; }
     size_t nbasis1() const { return nindex1_; }
     size_t naux() const { return naux_; }
@@ -76,8 +81,11 @@ class DFDist : public ParallelDF {
     virtual std::vector<std::shared_ptr<const DFDist>> split_blocks() const {
       std::vector<std::shared_ptr<const DFDist>> out;
       assert(nindex1_ == nindex2_);
-      for (auto& i : block_)
-        out.push_back(std::make_shared<const DFDist>(nindex1_, naux_, i, df_, data2_));
+      for (auto& i : block_) {
+        auto tmp = std::make_shared<DFDist>(nindex1_, naux_, i, df_);
+        tmp->set_data2(*this);
+        out.push_back(tmp);
+      }
       return out;
     }
 };
@@ -93,8 +101,9 @@ class DFDist_ints : public DFDist {
                         const size_t astart, const double thresh, const bool compute_inv) {
       Timer time;
 
-      // making a task list
-      TaskQueue<DFIntTask<TBatch,TBatch::Nblocks()>> tasks(b1shell.size()*b2shell.size()*ashell.size());
+      using TaskClass = DFIntTaskClass<TBatch,TBatch::Nblocks()>;
+      // making a task list; triples of one basis shell pair are grouped by the angular momentum of the auxiliary shell
+      TaskQueue<TaskClass> tasks(b1shell.size()*b2shell.size());
 
       auto i3 = std::make_shared<const Shell>(ashell.front()->spherical());
 
@@ -107,11 +116,20 @@ class DFDist_ints : public DFDist {
         int j1 = 0;
         for (auto& i1 : b1shell) {
           if (TBatch::Nblocks() > 1 || j1 <= j2) {
+            std::map<int, TaskClass> classes;
             int j0 = 0;
             for (auto& i0 : ashell) {
-              tasks.emplace_back((std::array<std::shared_ptr<const Shell>,4>{{i3, i0, i1, i2}}), (std::array<int,3>{{j2, j1, j0}}), blk);
+              TaskClass& current = classes[i0->angular_number()];
+              current.emplace_back((std::array<std::shared_ptr<const Shell>,4>{{i3, i0, i1, i2}}), (std::array<int,3>{{j2, j1, j0}}), blk);
+              if (current.size() == TaskClass::max_size) {
+                tasks.emplace_back(std::move(current));
+                current = TaskClass();
+              }
               j0 += i0->nbasis();
             }
+            for (auto& i : classes)
+              if (i.second.size() > 0)
+                tasks.emplace_back(std::move(i.second));
           }
           j1 += i1->nbasis();
         }
@@ -123,9 +141,204 @@ class DFDist_ints : public DFDist {
 
     }
 
+    // Only the symmetry-unique triples among those whose auxiliary shell is local are computed; the rest are copied with signs.
+    // ashell is the full list of auxiliary shells, of which [aoffset, aoffset + naux_shell) are on this process.
+    void compute_3index_sym(const std::vector<std::shared_ptr<const Shell>>& ashell, const int aoffset, const int naux_shell,
+                            const std::vector<std::shared_ptr<const Shell>>& bshell, const int astart,
+                            std::shared_ptr<const Petite> plist, std::shared_ptr<const Petite> aux_plist) {
+      Timer time;
+
+      std::vector<int> aoff(ashell.size()), boff(bshell.size());
+      for (int i = 0, cnt = 0; i != ashell.size(); cnt += ashell[i++]->nbasis()) aoff[i] = cnt - astart;
+      for (int i = 0, cnt = 0; i != bshell.size(); cnt += bshell[i++]->nbasis()) boff[i] = cnt;
+
+      const int nop = plist->nsymop();
+      TaskQueue<DFIntTaskSym<TBatch>> tasks(bshell.size()*(bshell.size()+1)/2*naux_shell/nop+1);
+
+      auto i3 = std::make_shared<const Shell>(ashell.front()->spherical());
+      std::array<std::shared_ptr<DFBlock>,1> blk{{block_[0]}};
+
+      for (int i2 = 0; i2 != bshell.size(); ++i2) {
+        for (int i1 = 0; i1 <= i2; ++i1) {
+          for (int i0 = aoffset; i0 != aoffset+naux_shell; ++i0) {
+            const std::array<int,3> key{{i0, i1, i2}};
+            bool unique = true;
+            std::vector<std::array<int,4>> images;
+            for (int iop = 0; iop != nop && unique; ++iop) {
+              const int g0 = aux_plist->sym_shellmap(i0)[iop];
+              if (g0 < aoffset || g0 >= aoffset+naux_shell) continue;
+              const int g1 = plist->sym_shellmap(i1)[iop];
+              const int g2 = plist->sym_shellmap(i2)[iop];
+              const std::array<int,3> gkey{{g0, std::min(g1,g2), std::max(g1,g2)}};
+              if (gkey < key) unique = false;
+              else images.push_back({{g0, g1, g2, iop}});
+            }
+            if (!unique) continue;
+
+            std::vector<typename DFIntTaskSym<TBatch>::Image> im;
+            for (auto& g : images) {
+              // the batch is (i0|i1 i2); offsets are in the order of (b2, b1, aux) and the signs are those of (i0, i1, i2)
+              typename DFIntTaskSym<TBatch>::Image tmp;
+              tmp.offset = {{boff[g[2]], boff[g[1]], aoff[g[0]]}};
+              tmp.sign = {{&aux_plist->sym_sign(i0, g[3]), &plist->sym_sign(i1, g[3]), &plist->sym_sign(i2, g[3])}};
+              im.push_back(tmp);
+            }
+            tasks.emplace_back((std::array<std::shared_ptr<const Shell>,4>{{i3, ashell[i0], bshell[i1], bshell[i2]}}), std::move(im), blk);
+          }
+        }
+      }
+      time.tick_print("3-index ints prep");
+      tasks.compute();
+      time.tick_print("3-index ints");
+    }
+
+    // Only the shell pairs whose bound max_D |(D|rs)| exceeds thresh are computed and stored in DFSparseBlock.
+    // The bound is the Schwarz one multiplied by the distance-including (QQR) factor (see ShellPair::qqr) unless qqr is false,
+    // which is also used to skip the negligible (D|rs) of the retained pairs.
+    void compute_3index_sparse(const std::vector<std::shared_ptr<const Shell>>& ashell, const std::vector<std::shared_ptr<const Shell>>& myashell,
+                               const std::vector<std::shared_ptr<const Shell>>& bshell, const size_t asize, const int astart,
+                               std::shared_ptr<const StaticDist> adist_shell, std::shared_ptr<const StaticDist> adist, const double thresh, const bool qqr) {
+      Timer time;
+      auto i3 = std::make_shared<const Shell>(ashell.front()->spherical());
+#ifdef LIBINT_INTERFACE
+      using SchwarzBatch = AutoERIBatch;
+#else
+      using SchwarzBatch = ERIBatch;
+#endif
+      auto bound = [](const SchwarzBatch& batch) {
+        double out = 0.0;
+        for (const double* i = batch.data(); i != batch.data()+batch.data_size(); ++i)
+          out = std::max(out, std::sqrt(std::abs(*i)));
+        return out;
+      };
+
+      // Schwarz factors of the auxiliary shells and the shell pairs
+      std::vector<double> aux_schwarz(ashell.size());
+      std::vector<std::pair<int,int>> allpairs;
+      for (int i2 = 0; i2 != bshell.size(); ++i2)
+        for (int i1 = 0; i1 <= i2; ++i1)
+          allpairs.emplace_back(i1, i2);
+      std::vector<double> schwarz(allpairs.size());
+
+      TaskQueue<std::function<void(void)>> stasks(ashell.size()+allpairs.size());
+      for (int i = 0; i != ashell.size(); ++i)
+        stasks.emplace_back([&, i]() {
+          SchwarzBatch batch(std::array<std::shared_ptr<const Shell>,4>{{ashell[i], i3, ashell[i], i3}}, 2.0);
+          batch.compute();
+          aux_schwarz[i] = bound(batch);
+        });
+      for (int i = 0; i != allpairs.size(); ++i)
+        stasks.emplace_back([&, i]() {
+          std::shared_ptr<const Shell> b0 = bshell[allpairs[i].first];
+          std::shared_ptr<const Shell> b1 = bshell[allpairs[i].second];
+          SchwarzBatch batch(std::array<std::shared_ptr<const Shell>,4>{{b1, b0, b1, b0}}, 0.0);
+          batch.compute();
+          schwarz[i] = bound(batch);
+        });
+      stasks.compute();
+
+      std::vector<double> aux_extent(ashell.size());
+      std::vector<int> aux_multipole(ashell.size());
+      for (int i = 0; i != ashell.size(); ++i) {
+        aux_extent[i] = ShellPair::extent(*ashell[i]);
+        aux_multipole[i] = ashell[i]->spherical() ? ashell[i]->angular_number() : ashell[i]->angular_number()%2;
+      }
+      auto bound_qqr = [&](const int i, const ShellPair& sp) {
+        const double factor = qqr ? ShellPair::qqr(ashell[i]->position(), aux_extent[i], aux_multipole[i], sp.centre(), sp.extent(), sp.multipole()) : 1.0;
+        return aux_schwarz[i] * sp.schwarz() * factor;
+      };
+
+      const double aux_max = *std::max_element(aux_schwarz.begin(), aux_schwarz.end());
+      std::vector<std::pair<int,int>> pairs;
+      std::vector<std::shared_ptr<const ShellPair>> shellpairs;
+      for (int i = 0; i != allpairs.size(); ++i) {
+        if (schwarz[i]*aux_max < thresh) continue;
+        const int i1 = allpairs[i].first;
+        const int i2 = allpairs[i].second;
+        auto sp = std::make_shared<const ShellPair>(std::array<std::shared_ptr<const Shell>,2>{{bshell[i2], bshell[i1]}}, std::array<int,2>{{0, 0}},
+                                                    std::make_pair(i2, i1), "yang", thresh, schwarz[i]);
+        for (int j = 0; j != ashell.size(); ++j)
+          if (bound_qqr(j, *sp) >= thresh) {
+            pairs.push_back(allpairs[i]);
+            shellpairs.push_back(sp);
+            break;
+          }
+      }
+      std::cout << "    * " << pairs.size() << " of " << allpairs.size() << " shell pairs are retained in the 3-index integrals" << std::endl;
+
+      auto sparse = std::make_shared<DFSparseBlock>(adist_shell, adist, asize, astart, bshell, pairs);
+      sparse->zero();
+      storage_ = sparse;
+      time.tick_print("3-index ints prep");
+
+      const int myoffset = myashell.empty() ? 0 : std::find(ashell.begin(), ashell.end(), myashell.front()) - ashell.begin();
+      TaskQueue<DFIntTaskSparse<TBatch>> tasks(pairs.size()*myashell.size());
+      for (int p = 0; p != pairs.size(); ++p) {
+        size_t j0 = 0;
+        for (int j = 0; j != myashell.size(); ++j) {
+          if (bound_qqr(myoffset+j, *shellpairs[p]) >= thresh)
+            tasks.emplace_back((std::array<std::shared_ptr<const Shell>,4>{{i3, myashell[j], bshell[pairs[p].first], bshell[pairs[p].second]}}), j0, p, sparse);
+          j0 += myashell[j]->nbasis();
+        }
+      }
+      tasks.compute();
+      time.tick_print("3-index ints");
+    }
+
+    // The integrals are computed batch by batch and stored in a memory-mapped file in the scratch directory (see DFDiskBlock).
+    // Each auxiliary batch (at the shell boundary) holds at most batch_memory MB unless a single shell exceeds it.
+    void compute_3index_disk(const std::vector<std::shared_ptr<const Shell>>& myashell, const std::vector<std::shared_ptr<const Shell>>& bshell,
+                             const size_t asize, const int astart, std::shared_ptr<const StaticDist> adist_shell, std::shared_ptr<const StaticDist> adist,
+                             const std::string& scratch, const size_t batch_memory) {
+      Timer time;
+      const size_t nbasis = std::accumulate(bshell.begin(), bshell.end(), 0, [](const int& i, const std::shared_ptr<const Shell>& o) { return i+o->nbasis(); });
+      const size_t maxbatch = std::max(static_cast<size_t>(1LU), (batch_memory << 20) / (sizeof(double)*nbasis*nbasis));
+
+      // auxiliary batches at the shell boundary
+      std::vector<size_t> batchsize;
+      std::vector<std::vector<std::shared_ptr<const Shell>>> batchshell;
+      for (auto& i : myashell) {
+        if (batchsize.empty() || batchsize.back() + i->nbasis() > maxbatch) {
+          batchsize.push_back(0LU);
+          batchshell.emplace_back();
+        }
+        batchsize.back() += i->nbasis();
+        batchshell.back().push_back(i);
+      }
+      auto disk = std::make_shared<DFDiskBlock>(adist_shell, adist, asize, astart, nbasis, batchsize, scratch);
+      storage_ = disk;
+      std::cout << "    * 3-index integrals are stored in " << scratch << " in " << batchsize.size() << " batch" << (batchsize.size() == 1 ? "" : "es") << std::endl;
+
+      for (int b = 0; b != batchsize.size(); ++b) {
+        auto i3 = std::make_shared<const Shell>(batchshell[b].front()->spherical());
+        TaskQueue<DFIntTaskDisk<TBatch>> tasks(bshell.size()*(bshell.size()+1)/2*batchshell[b].size());
+        int j2 = 0;
+        for (int i2 = 0; i2 != bshell.size(); ++i2) {
+          int j1 = 0;
+          for (int i1 = 0; i1 <= i2; ++i1) {
+            int j0 = 0;
+            for (auto& i0 : batchshell[b]) {
+              tasks.emplace_back((std::array<std::shared_ptr<const Shell>,4>{{i3, i0, bshell[i1], bshell[i2]}}), (std::array<int,3>{{j2, j1, j0}}),
+                                 disk->batch_data(b), batchsize[b], nbasis);
+              j0 += i0->nbasis();
+            }
+            j1 += bshell[i1]->nbasis();
+          }
+          j2 += bshell[i2]->nbasis();
+        }
+        tasks.compute();
+        disk->flush(b);
+      }
+      time.tick_print("3-index ints");
+    }
+
   public:
+    // If sparse_thresh is positive, the 3-index integrals are stored only for significant shell pairs (see DFSparseBlock).
+    // If scratch is not empty, they are stored out of core in that directory (see DFDiskBlock). qqr switches the QQR screening of the sparse integrals.
     DFDist_ints(const int nbas, const int naux, const std::vector<std::shared_ptr<const Atom>>& atoms, const std::vector<std::shared_ptr<const Atom>>& aux_atoms,
-                const double thr, const bool inverse, const double dum, const bool average = false, const std::shared_ptr<Matrix> data2 = nullptr, const bool serial = false)
+                const double thr, const bool inverse, const double dum, const bool average = false, const std::shared_ptr<Matrix> data2 = nullptr, const bool serial = false,
+                std::shared_ptr<const Petite> plist = nullptr, std::shared_ptr<const Petite> aux_plist = nullptr, const double sparse_thresh = 0.0,
+                const std::string scratch = "", const size_t batch_memory = 256, const bool qqr = false)
       : DFDist(nbas, naux, nullptr, nullptr, nullptr, serial) {
 
       // 3index Integral is now made in DFBlock.
@@ -146,11 +359,25 @@ class DFDist_ints : public DFDist {
       const size_t asize  = std::accumulate(myashell.begin(),myashell.end(),0, [](const int& i, const std::shared_ptr<const Shell>& o) { return i+o->nbasis(); });
       const size_t b1size = std::accumulate(b1shell.begin(), b1shell.end(), 0, [](const int& i, const std::shared_ptr<const Shell>& o) { return i+o->nbasis(); });
       const size_t b2size = std::accumulate(b2shell.begin(), b2shell.end(), 0, [](const int& i, const std::shared_ptr<const Shell>& o) { return i+o->nbasis(); });
-      for (int i = 0; i != TBatch::Nblocks(); ++i)
-        block_.push_back(std::make_shared<DFBlock>(adist_shell, adist_averaged, asize, b1size, b2size, astart, 0, 0));
+      // the storage is chosen from the input alone so that all processes take the same (collective) path;
+      // processes without auxiliary shells take part with zero-size blocks
+      const bool sparse = sparse_thresh > 0.0 && TBatch::Nblocks() == 1;
+      const bool disk = !sparse && !scratch.empty() && TBatch::Nblocks() == 1;
+      if (!sparse && !disk)
+        for (int i = 0; i != TBatch::Nblocks(); ++i)
+          block_.push_back(std::make_shared<DFBlock>(adist_shell, adist_averaged, asize, b1size, b2size, astart, 0, 0));
 
       // 3-index integrals
-      compute_3index(myashell, b1shell, b2shell, asize, b1size, b2size, astart, thr, inverse);
+      if (sparse) {
+        compute_3index_sparse(ashell, myashell, b1shell, asize, astart, adist_shell, adist_averaged, sparse_thresh, qqr);
+      } else if (disk) {
+        compute_3index_disk(myashell, b1shell, asize, astart, adist_shell, adist_averaged, scratch, batch_memory);
+      } else if (plist && aux_plist && TBatch::Nblocks() == 1) {
+        const int aoffset = myashell.empty() ? 0 : std::find(ashell.begin(), ashell.end(), myashell.front()) - ashell.begin();
+        compute_3index_sym(ashell, aoffset, myashell.size(), b1shell, astart, plist, aux_plist);
+      } else {
+        compute_3index(myashell, b1shell, b2shell, asize, b1size, b2size, astart, thr, inverse);
+      }
 
       // 2-index integrals
       if (data2)
@@ -194,18 +421,21 @@ class DFHalfDist : public ParallelDF {
 
     std::shared_ptr<Matrix> compute_Kop_1occ(const std::shared_ptr<const Matrix> den, const double a) const;
 
-    std::shared_ptr<DFHalfDist> apply_J() const { return apply_J(df_->data2()); }
-    std::shared_ptr<DFHalfDist> apply_JJ() const { return apply_J(std::make_shared<Matrix>(*df_->data2()**df_->data2())); }
-    std::shared_ptr<DFHalfDist> apply_J(const std::shared_ptr<const DFDist> d) const { return apply_J(d->data2()); }
-    std::shared_ptr<DFHalfDist> apply_JJ(const std::shared_ptr<const DFDist> d) const { return apply_J(std::make_shared<Matrix>(*d->data2()**d->data2())); }
-    std::shared_ptr<DFHalfDist> apply_J(const std::shared_ptr<const Matrix> o) const;
+    std::shared_ptr<DFHalfDist> apply_J() const { return apply_J(df_->metric()); }
+    std::shared_ptr<DFHalfDist> apply_JJ() const { return apply_J(df_->metric_squared()); }
+    std::shared_ptr<DFHalfDist> apply_J(const std::shared_ptr<const DFDist> d) const { return apply_J(d->metric()); }
+    std::shared_ptr<DFHalfDist> apply_JJ(const std::shared_ptr<const DFDist> d) const { return apply_J(d->metric_squared()); }
+    std::shared_ptr<DFHalfDist> apply_J(const std::shared_ptr<const Matrix> o) const { return apply_J(o->data()); }
+    // d is a naux x naux matrix
+    std::shared_ptr<DFHalfDist> apply_J(const double* d) const;
 
 };
 
 
 class DFFullDist : public ParallelDF {
   protected:
-    std::shared_ptr<DFFullDist> apply_J(const std::shared_ptr<const Matrix> o) const;
+    std::shared_ptr<DFFullDist> apply_J(const std::shared_ptr<const Matrix> o) const { return apply_J(o->data()); }
+    std::shared_ptr<DFFullDist> apply_J(const double* d) const;
 
   public:
     DFFullDist(const std::shared_ptr<const ParallelDF> df, const int nocc1, const int nocc2) : ParallelDF(df->naux(), nocc1, nocc2, df) { }
@@ -244,10 +474,10 @@ class DFFullDist : public ParallelDF {
     // utility functions
     std::shared_ptr<Matrix> form_aux_2index_apply_J(const std::shared_ptr<const DFFullDist> o, const double a) const;
 
-    std::shared_ptr<DFFullDist> apply_J() const { return apply_J(df_->data2()); }
-    std::shared_ptr<DFFullDist> apply_JJ() const { return apply_J(std::make_shared<Matrix>(*df_->data2()**df_->data2())); }
-    std::shared_ptr<DFFullDist> apply_J(const std::shared_ptr<const ParallelDF> d) const { return apply_J(d->data2()); }
-    std::shared_ptr<DFFullDist> apply_JJ(const std::shared_ptr<const ParallelDF> d) const { return apply_J(std::make_shared<Matrix>(*d->data2()**d->data2())); }
+    std::shared_ptr<DFFullDist> apply_J() const { return apply_J(df_->metric()); }
+    std::shared_ptr<DFFullDist> apply_JJ() const { return apply_J(df_->metric_squared()); }
+    std::shared_ptr<DFFullDist> apply_J(const std::shared_ptr<const ParallelDF> d) const { return apply_J(d->metric()); }
+    std::shared_ptr<DFFullDist> apply_JJ(const std::shared_ptr<const ParallelDF> d) const { return apply_J(d->metric_squared()); }
 
     std::shared_ptr<DFFullDist> swap() const;
 };
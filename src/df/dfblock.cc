@@ -431,10 +431,49 @@ shared_ptr<Matrix> DFBlock::form_mat(const Tensor1<double>& fit) const {
 }
 
 
-void DFBlock::contrib_apply_J(const shared_ptr<const DFBlock> o, const shared_ptr<const Matrix> d) {
-  if (b1size() != o->b1size() || b2size() != o->b2size()) throw logic_error("illegal call of DFBlock::contrib_apply_J");
+void DFBlock::form_2index_tile(const shared_ptr<const DFBlock> o, const double a, const size_t jstart, const size_t jfence, double* out) const {
+  if (asize() != o->asize() || (b1size() != o->b1size() && b2size() != o->b2size())) throw logic_error("illegal call of DFBlock::form_2index_tile");
+  const int nj = jfence - jstart;
+  if (nj == 0) return;
+  if (b1size() == o->b1size()) {
+    dgemm_("T", "N", b2size(), nj, asize()*b1size(), a, data(), asize()*b1size(), o->data()+jstart*asize()*b1size(), asize()*b1size(),
+           0.0, out+jstart*b2size(), b2size());
+  } else {
+    for (size_t k = 0; k != b2size(); ++k)
+      dgemm_("T", "N", b1size(), nj, asize(), a, data()+k*asize()*b1size(), asize(), o->data()+(k*o->b1size()+jstart)*asize(), asize(),
+             k == 0 ? 0.0 : 1.0, out+jstart*b1size(), b1size());
+  }
+}
+
+
+void DFBlock::form_4index_tile(const shared_ptr<const DFBlock> o, const double a, const size_t jstart, const size_t jfence, double* out) const {
+  if (asize() != o->asize()) throw logic_error("illegal call of DFBlock::form_4index_tile");
+  const size_t n = b1size()*b2size();
+  if (jfence > jstart)
+    dgemm_("T", "N", n, jfence-jstart, asize(), a, data(), asize(), o->data()+jstart*asize(), asize(), 0.0, out+jstart*n, n);
+}
+
+
+void DFBlock::form_vec_tile(const shared_ptr<const Matrix> den, const size_t start, const size_t fence, double* out) const {
+  assert(den->ndim() == b1size() && den->mdim() == b2size());
+  std::fill(out+start, out+fence, 0.0);
+  const size_t lo = max(start, astart());
+  const size_t hi = min(fence, astart()+asize());
+  if (hi > lo)
+    dgemv_("N", hi-lo, b1size()*b2size(), 1.0, data()+lo-astart(), asize(), den->data(), 1, 0.0, out+lo, 1);
+}
+
+
+void DFBlock::form_mat_tile(const double* fit, const size_t start, const size_t fence, double* out) const {
+  if (fence > start)
+    dgemv_("T", asize(), fence-start, 1.0, data()+start*asize(), asize(), fit, 1, 0.0, out+start, 1);
+}
+
+
+void DFBlock::contrib_apply_J(const shared_ptr<const DFBlock> o, const double* d) {
+  if (b1size() != o->b1size() || b2size() != o->b2size() || asize() != o->asize()) throw logic_error("illegal call of DFBlock::contrib_apply_J");
   assert(astart_ == 0 && o->astart_ == 0);
-  contract(1.0, *d, {0,3}, *o, {3,1,2}, 1.0, *this, {0,1,2});
+  dgemm_("N", "N", asize(), b1size()*b2size(), asize(), 1.0, d, asize(), o->data(), asize(), 1.0, data(), asize());
 }
 
 
@@ -150,7 +150,17 @@ class DFBlock : public btas::Tensor3<double> {
     std::shared_ptr<VectorB> form_vec(const std::shared_ptr<const Matrix> den) const;
     std::shared_ptr<Matrix> form_mat(const btas::Tensor1<double>& fit) const;
 
-    void contrib_apply_J(const std::shared_ptr<const DFBlock> o, const std::shared_ptr<const Matrix> mat);
+    // Tiles of the above, used to overlap the reduction of one tile with the computation of the next.
+    // out points to the entire result; only columns [jstart, jfence) (form_2index, form_4index),
+    // elements [start, fence) (form_mat; fit is that of this block) or auxiliary indices [start, fence) (form_vec; absolute numbers) are written.
+    void form_2index_tile(const std::shared_ptr<const DFBlock> o, const double a, const size_t jstart, const size_t jfence, double* out) const;
+    void form_4index_tile(const std::shared_ptr<const DFBlock> o, const double a, const size_t jstart, const size_t jfence, double* out) const;
+    void form_vec_tile(const std::shared_ptr<const Matrix> den, const size_t start, const size_t fence, double* out) const;
+    void form_mat_tile(const double* fit, const size_t start, const size_t fence, double* out) const;
+
+    void contrib_apply_J(const std::shared_ptr<const DFBlock> o, const std::shared_ptr<const Matrix> mat) { contrib_apply_J(o, mat->data()); }
+    // mat is an asize x asize matrix
+    void contrib_apply_J(const std::shared_ptr<const DFBlock> o, const double* mat);
 
     // compute (D|ia)(ia|j) and set to the location specified by the offset
     std::shared_ptr<Matrix> form_Dj(const std::shared_ptr<const Matrix> o, const int jdim) const;
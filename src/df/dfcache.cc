@@ -0,0 +1,208 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfcache.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <src/df/dfcache.h>
+
+using namespace std;
+using namespace bagel;
+
+namespace {
+  const string prefix = "bagel_df_";
+  const char magic[8] = {'B', 'A', 'G', 'E', 'L', 'D', 'F', '1'};
+
+  // 64-bit FNV-1a hash (stable across compilers and runs, unlike std::hash)
+  string fnv1a(const string& in) {
+    uint64_t hash = 14695981039346656037LU;
+    for (auto& c : in) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211LU;
+    }
+    stringstream ss;
+    ss << hex << setw(16) << setfill('0') << hash;
+    return ss.str();
+  }
+
+  template<typename T>
+  void write(ofstream& fs, const T* data, const size_t n) { fs.write(reinterpret_cast<const char*>(data), n*sizeof(T)); }
+  template<typename T>
+  bool read(ifstream& fs, T* data, const size_t n) { return static_cast<bool>(fs.read(reinterpret_cast<char*>(data), n*sizeof(T))); }
+}
+
+
+string DFCache::describe(const vector<shared_ptr<const Atom>>& atoms, const vector<shared_ptr<const Atom>>& aux_atoms, const double thresh) {
+  stringstream ss;
+  ss << setprecision(17) << "thresh " << thresh << " nproc " << mpi__->size() << endl;
+  for (auto& set : {atoms, aux_atoms}) {
+    ss << "basis" << endl;
+    for (auto& atom : set) {
+      ss << atom->name() << " " << atom->position()[0] << " " << atom->position()[1] << " " << atom->position()[2] << endl;
+      for (auto& shell : atom->shells()) {
+        ss << shell->angular_number() << " " << shell->spherical();
+        for (auto& e : shell->exponents())
+          ss << " " << e;
+        for (auto& c : shell->contractions())
+          for (auto& d : c)
+            ss << " " << d;
+        for (auto& r : shell->contraction_ranges())
+          ss << " " << r.first << " " << r.second;
+        ss << endl;
+      }
+    }
+  }
+  return ss.str();
+}
+
+
+string DFCache::suffix() const {
+  return "." + to_string(mpi__->rank()) + "of" + to_string(mpi__->size()) + ".cache";
+}
+
+
+string DFCache::filename(const string& description) const {
+  return directory_ + "/" + prefix + fnv1a(description) + suffix();
+}
+
+
+shared_ptr<DFDist> DFCache::load(const string& description, const size_t nbasis, const size_t naux) const {
+  const string file = filename(description);
+  shared_ptr<DFDist> out;
+
+  ifstream fs(file, ios::binary);
+  if (fs.is_open()) {
+    char mg[8];
+    uint64_t len;
+    if (read(fs, mg, 8) && equal(mg, mg+8, magic) && read(fs, &len, 1) && len == description.size()) {
+      string desc(len, ' ');
+      // header: nbasis, naux, serial, nproc, astart, asize
+      array<uint64_t,6> header;
+      if (read(fs, &desc[0], len) && desc == description && read(fs, header.data(), header.size())
+          && header[0] == nbasis && header[1] == naux && header[3] == mpi__->size()) {
+        vector<uint64_t> table(header[3]+1);
+        if (read(fs, table.data(), table.size())) {
+          auto adist_shell = make_shared<const StaticDist>(vector<size_t>(table.begin(), table.end()));
+          auto adist = make_shared<const StaticDist>(naux, mpi__->size());
+          auto block = make_shared<DFBlock>(adist_shell, adist, header[5], nbasis, nbasis, header[4], 0, 0);
+          auto data2 = make_shared<Matrix>(naux, naux, true);
+          if (read(fs, block->data(), block->size()) && read(fs, data2->data(), data2->size()))
+            out = make_shared<DFDist>(nbasis, naux, block, nullptr, data2, header[2]);
+        }
+      }
+    }
+  }
+
+  // all the processes have to agree, since the integrals are otherwise computed collectively
+  int miss = out ? 0 : 1;
+  mpi__->allreduce(&miss, 1);
+  if (miss)
+    return nullptr;
+  if (!out->serial())
+    out->share_data2();
+
+  // marks the entry as recently used
+  utime(file.c_str(), nullptr);
+  cout << "    * 3-index integrals are loaded from " << file << endl;
+  return out;
+}
+
+
+void DFCache::save(const string& description, shared_ptr<const DFDist> df) const {
+  // only dense integrals are cached
+  if (df->has_storage() || df->block().size() != 1 || !df->has_data2() || df->block(0)->averaged())
+    return;
+
+  shared_ptr<const DFBlock> block = df->block(0);
+  // a copy if the 2-index integrals are held in shared memory
+  shared_ptr<const Matrix> data2 = df->data2();
+  const size_t bytes = description.size() + (block->size() + data2->size()) * sizeof(double);
+  if (bytes > max_size_)
+    return;
+  evict(bytes);
+
+  // written to a temporary file first so that an incomplete entry is never read
+  const string file = filename(description);
+  const string tmp = file + ".tmp";
+  {
+    ofstream fs(tmp, ios::binary);
+    if (!fs.is_open()) {
+      cout << "    * the DF integral cache in " << directory_ << " is not writable" << endl;
+      return;
+    }
+    const uint64_t len = description.size();
+    const array<uint64_t,6> header{{df->nbasis0(), df->naux(), df->serial(), static_cast<uint64_t>(mpi__->size()), block->astart(), block->asize()}};
+    vector<uint64_t> table;
+    for (auto& i : block->adist_now()->atable())
+      table.push_back(i.first);
+    table.push_back(df->naux());
+
+    write(fs, magic, 8);
+    write(fs, &len, 1);
+    write(fs, description.data(), len);
+    write(fs, header.data(), header.size());
+    write(fs, table.data(), table.size());
+    write(fs, block->data(), block->size());
+    write(fs, data2->data(), data2->size());
+    if (!fs.good()) {
+      fs.close();
+      remove(tmp.c_str());
+      return;
+    }
+  }
+  rename(tmp.c_str(), file.c_str());
+}
+
+
+void DFCache::evict(const size_t incoming) const {
+  DIR* dir = opendir(directory_.c_str());
+  if (!dir) return;
+
+  // entries of this process, with their last access (modification) times
+  const string suf = suffix();
+  vector<tuple<time_t, size_t, string>> entries;
+  size_t total = 0LU;
+  while (dirent* ent = readdir(dir)) {
+    const string name = ent->d_name;
+    if (name.compare(0, prefix.size(), prefix) != 0 || name.size() < suf.size() || name.compare(name.size()-suf.size(), suf.size(), suf) != 0)
+      continue;
+    struct stat st;
+    const string path = directory_ + "/" + name;
+    if (stat(path.c_str(), &st) == 0) {
+      entries.emplace_back(st.st_mtime, st.st_size, path);
+      total += st.st_size;
+    }
+  }
+  closedir(dir);
+
+  sort(entries.begin(), entries.end());
+  for (auto& i : entries) {
+    if (total + incoming <= max_size_) break;
+    if (remove(get<2>(i).c_str()) == 0)
+      total -= get<1>(i);
+  }
+}
@@ -0,0 +1,63 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfcache.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_DF_DFCACHE_H
+#define __SRC_DF_DFCACHE_H
+
+#include <src/df/df.h>
+
+namespace bagel {
+
+/*
+    DFCache stores the 3-index integrals and J^-1/2 of DFDist in a directory so that they can be reused by later jobs.
+    Entries are keyed by a hash of the atoms, basis sets, and thresholds; each process keeps its own file.
+    When the total size of the entries of a process exceeds the limit, the least recently used ones are removed.
+*/
+
+class DFCache {
+  protected:
+    const std::string directory_;
+    const size_t max_size_;
+
+    std::string filename(const std::string& description) const;
+    std::string suffix() const;
+    // removes the least recently used entries until incoming bytes can be added
+    void evict(const size_t incoming) const;
+
+  public:
+    // max_size is in MB
+    DFCache(const std::string& directory, const size_t max_size) : directory_(directory), max_size_(max_size << 20) { }
+
+    // description of the integrals that is used as a key
+    static std::string describe(const std::vector<std::shared_ptr<const Atom>>& atoms, const std::vector<std::shared_ptr<const Atom>>& aux_atoms, const double thresh);
+
+    // returns nullptr unless every process finds its entry (collective)
+    std::shared_ptr<DFDist> load(const std::string& description, const size_t nbasis, const size_t naux) const;
+    void save(const std::string& description, std::shared_ptr<const DFDist> df) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfdiskblock.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cstdlib>
+#include <cstring>
+#include <src/df/dfdiskblock.h>
+
+using namespace bagel;
+using namespace std;
+using namespace btas;
+
+DFDiskBlock::DFDiskBlock(shared_ptr<const StaticDist> adist_shell, shared_ptr<const StaticDist> adist, const size_t asize, const size_t astart, const size_t nbasis,
+                         const vector<size_t>& batchsize, const string& scratch)
+ : DFStorage(adist_shell, adist, asize, astart, nbasis), scratch_(scratch), fd_(-1), data_(nullptr) {
+
+  size_t start = 0LU;
+  for (auto& i : batchsize) {
+    batch_.emplace_back(start, i);
+    start += i;
+  }
+  if (start != asize_)
+    throw logic_error("auxiliary batches do not add up in DFDiskBlock");
+  if (size() == 0) return;
+
+  // the file is unlinked right away, so that it is removed when the process ends
+  string filename = scratch_ + "/bagel_df_XXXXXX";
+  vector<char> name(filename.begin(), filename.end());
+  name.push_back('\0');
+  fd_ = mkstemp(name.data());
+  if (fd_ < 0)
+    throw runtime_error("could not create a scratch file in " + scratch_ + " (" + strerror(errno) + ")");
+  unlink(name.data());
+
+  if (ftruncate(fd_, size()*sizeof(double)) != 0) {
+    close(fd_);
+    throw runtime_error("could not allocate " + to_string(size()*sizeof(double)) + " bytes in " + scratch_ + " (" + strerror(errno) + ")");
+  }
+  void* ptr = mmap(nullptr, size()*sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (ptr == MAP_FAILED) {
+    close(fd_);
+    throw runtime_error(string("could not map the scratch file (") + strerror(errno) + ")");
+  }
+  data_ = static_cast<double*>(ptr);
+}
+
+
+DFDiskBlock::~DFDiskBlock() {
+  if (data_)
+    munmap(data_, size()*sizeof(double));
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+
+pair<void*,size_t> DFDiskBlock::pages(const size_t i) const {
+  if (i >= batch_.size() || batch_[i].second == 0) return {nullptr, 0};
+  // madvise and msync require a page-aligned address
+  static const uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(batch_data(i)) & ~(pagesize-1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(batch_data(i) + batch_[i].second*nbasis_*nbasis_);
+  return {reinterpret_cast<void*>(begin), end-begin};
+}
+
+
+void DFDiskBlock::advise(const size_t i, const int advice) const {
+  const pair<void*,size_t> p = pages(i);
+  if (p.second)
+    madvise(p.first, p.second, advice);
+}
+
+
+void DFDiskBlock::flush(const size_t i) {
+  // MADV_DONTNEED alone only unmaps the pages; the dirty ones would stay in the page cache until the kernel writes them back
+  const pair<void*,size_t> p = pages(i);
+  if (!p.second) return;
+  if (msync(p.first, p.second, MS_SYNC) != 0)
+    throw runtime_error(string("could not write the scratch file (") + strerror(errno) + ")");
+  madvise(p.first, p.second, MADV_DONTNEED);
+}
+
+
+void DFDiskBlock::scale(const double a) {
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    blas::scale_n(a, batch_data(i), batch_[i].second*nbasis_*nbasis_);
+    flush(i);
+  }
+}
+
+
+shared_ptr<DFStorage> DFDiskBlock::clone() const {
+  vector<size_t> batchsize;
+  for (auto& i : batch_)
+    batchsize.push_back(i.second);
+  // newly allocated files are filled with zero
+  return make_shared<DFDiskBlock>(adist_shell_, adist_, asize_, astart_, nbasis_, batchsize, scratch_);
+}
+
+
+shared_ptr<DFStorage> DFDiskBlock::copy() const {
+  vector<size_t> batchsize;
+  for (auto& i : batch_)
+    batchsize.push_back(i.second);
+  auto out = make_shared<DFDiskBlock>(adist_shell_, adist_, asize_, astart_, nbasis_, batchsize, scratch_);
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    copy_n(batch_data(i), batch_[i].second*nbasis_*nbasis_, out->batch_data(i));
+    advise(i, MADV_DONTNEED);
+    out->flush(i);
+  }
+  return out;
+}
+
+
+shared_ptr<DFBlock> DFDiskBlock::transform_second(const MatView cmat) const {
+  assert(cmat.extent(0) == nbasis_);
+  assert(cmat.range().ordinal().contiguous());
+  const int nocc = cmat.extent(1);
+  auto out = make_shared<DFBlock>(adist_shell_, adist_, asize_, nocc, nbasis_, astart_, 0, 0);
+  if (nocc == 0) return out;
+
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    const size_t nb = batch_[i].second;
+    // (D|is) = (D|rs) c_ri for each s, written to the rows of this batch
+    for (size_t s = 0; s != nbasis_; ++s)
+      dgemm_("N", "N", nb, nocc, nbasis_, 1.0, batch_data(i)+s*nb*nbasis_, nb, cmat.data(), nbasis_, 0.0, out->data()+batch_[i].first+s*asize_*nocc, asize_);
+    advise(i, MADV_DONTNEED);
+  }
+  return out;
+}
+
+
+shared_ptr<Matrix> DFDiskBlock::form_2index(const shared_ptr<const DFBlock> o, const double a) const {
+  if (asize_ != o->asize() || (nbasis_ != o->b1size() && nbasis_ != o->b2size())) throw logic_error("illegal call of DFDiskBlock::form_2index");
+  // the same convention as DFBlock::form_2index; the first matching index of o is contracted
+  const bool first = nbasis_ == o->b1size();
+  const size_t nk = first ? o->b2size() : o->b1size();
+  auto target = make_shared<Matrix>(nbasis_, nk);
+  if (nk == 0) return target;
+
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    const size_t nb = batch_[i].second;
+    // gather the rows of o in this batch as [aux][r][k]
+    unique_ptr<double[]> obatch(new double[nb*nbasis_*nk]);
+    for (size_t k = 0; k != nk; ++k)
+      for (size_t r = 0; r != nbasis_; ++r)
+        copy_n(o->data()+batch_[i].first+asize_*(first ? r+nbasis_*k : k+nk*r), nb, obatch.get()+nb*(r+nbasis_*k));
+    dgemm_("T", "N", nbasis_, nk, nb*nbasis_, a, batch_data(i), nb*nbasis_, obatch.get(), nb*nbasis_, 1.0, target->data(), nbasis_);
+    advise(i, MADV_DONTNEED);
+  }
+  return target;
+}
+
+
+shared_ptr<VectorB> DFDiskBlock::form_vec(const shared_ptr<const Matrix> den) const {
+  assert(den->ndim() == nbasis_ && den->mdim() == nbasis_);
+  auto out = make_shared<VectorB>(asize_);
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    dgemv_("N", batch_[i].second, nbasis_*nbasis_, 1.0, batch_data(i), batch_[i].second, den->data(), 1, 0.0, out->data()+batch_[i].first, 1);
+    advise(i, MADV_DONTNEED);
+  }
+  return out;
+}
+
+
+shared_ptr<Matrix> DFDiskBlock::form_mat(const Tensor1<double>& fit) const {
+  assert(fit.size() == asize_);
+  auto out = make_shared<Matrix>(nbasis_, nbasis_);
+  advise(0, MADV_WILLNEED);
+  for (size_t i = 0; i != nbatch(); ++i) {
+    advise(i+1, MADV_WILLNEED);
+    dgemv_("T", batch_[i].second, nbasis_*nbasis_, 1.0, batch_data(i), batch_[i].second, fit.data()+batch_[i].first, 1, 1.0, out->data(), 1);
+    advise(i, MADV_DONTNEED);
+  }
+  return out;
+}
@@ -0,0 +1,80 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfdiskblock.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_DF_DFDISKBLOCK_H
+#define __SRC_DF_DFDISKBLOCK_H
+
+#include <src/df/dfstorage.h>
+
+namespace bagel {
+
+/*
+    DFDiskBlock keeps a slice of 3-index DF integrals (D|rs) in a memory-mapped scratch file.
+    The auxiliary index is split into batches, each of which is a contiguous [aux][r][s] block in the file.
+    Operations stream over the batches; the next batch is read ahead by the kernel (madvise) while the current one is processed.
+*/
+
+class DFDiskBlock : public DFStorage {
+  protected:
+    std::string scratch_;
+    int fd_;
+    double* data_;
+    // [start, start+size) of each auxiliary batch, relative to astart_
+    std::vector<std::pair<size_t,size_t>> batch_;
+
+    // page-aligned address and length of batch i
+    std::pair<void*,size_t> pages(const size_t i) const;
+    // hints to the kernel on the pages of batch i (MADV_WILLNEED or MADV_DONTNEED)
+    void advise(const size_t i, const int advice) const;
+
+  public:
+    DFDiskBlock(std::shared_ptr<const StaticDist> adist_shell, std::shared_ptr<const StaticDist> adist, const size_t asize, const size_t astart, const size_t nbasis,
+                const std::vector<size_t>& batchsize, const std::string& scratch);
+    DFDiskBlock(const DFDiskBlock& o) = delete;
+    ~DFDiskBlock();
+
+    size_t size() const { return asize_*nbasis_*nbasis_; }
+    size_t nbatch() const { return batch_.size(); }
+    const std::pair<size_t,size_t>& batch(const size_t i) const { return batch_[i]; }
+    double* batch_data(const size_t i) { return data_ + batch_[i].first*nbasis_*nbasis_; }
+    const double* batch_data(const size_t i) const { return data_ + batch_[i].first*nbasis_*nbasis_; }
+
+    // called after batch i is written; writes the pages back to the file (msync) and releases them
+    void flush(const size_t i);
+
+    void scale(const double a) override;
+
+    std::shared_ptr<DFStorage> clone() const override;
+    std::shared_ptr<DFStorage> copy() const override;
+
+    std::shared_ptr<DFBlock> transform_second(const MatView c) const override;
+    std::shared_ptr<Matrix> form_2index(const std::shared_ptr<const DFBlock> o, const double a) const override;
+    std::shared_ptr<VectorB> form_vec(const std::shared_ptr<const Matrix> den) const override;
+    std::shared_ptr<Matrix> form_mat(const btas::Tensor1<double>& fit) const override;
+};
+
+}
+
+#endif
@@ -79,10 +79,9 @@ DFDistT::DFDistT(shared_ptr<const ParallelDF> in, shared_ptr<const StaticDist> d
 
 
 DFDistT::DFDistT(const size_t naux, shared_ptr<const StaticDist> dist, const size_t nindex1, const size_t nindex2,
-                 const shared_ptr<const ParallelDF> p)
+                 const shared_ptr<const ParallelDF> p, const int nblock)
  : naux_(naux), nindex1_(nindex1), nindex2_(nindex2), dist_(dist), bstart_(dist->start(mpi__->rank())), bsize_(dist->size(mpi__->rank())), df_(p) {
 
-  const int nblock = p->block().size();
   for (int i = 0; i != nblock; ++i)
     data_.push_back(make_shared<Matrix>(naux_, bsize_, true));
 
@@ -90,15 +89,17 @@ DFDistT::DFDistT(const size_t naux, shared_ptr<const StaticDist> dist, const siz
 
 
 shared_ptr<DFDistT> DFDistT::clone() const {
-  return make_shared<DFDistT>(naux_, dist_, nindex1_, nindex2_, df_);
+  return make_shared<DFDistT>(naux_, dist_, nindex1_, nindex2_, df_, data_.size());
 }
 
 
-shared_ptr<DFDistT> DFDistT::apply_J(shared_ptr<const Matrix> d) const {
+shared_ptr<DFDistT> DFDistT::apply_J(const double* d) const {
   shared_ptr<DFDistT> out = clone();
   auto j = data_.begin();
-  for (auto& i : out->data_)
-    *i = *d % **j++;
+  for (auto& i : out->data_) {
+    assert(i->ndim() == naux_ && (*j)->ndim() == naux_);
+    dgemm_("T", "N", naux_, i->mdim(), naux_, 1.0, d, naux_, (*j++)->data(), naux_, 0.0, i->data(), naux_);
+  }
   return out;
 }
 
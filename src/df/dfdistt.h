@@ -57,12 +57,15 @@ class DFDistT {
     // CAUTION this constructor should be called **COLLECTIVELY**!! Otherwise the program hangs.
     DFDistT(std::shared_ptr<const ParallelDF> in, std::shared_ptr<const StaticDist> dist = nullptr);
 
+    // nblock matrices; the parent DFDist holds no blocks when its integrals are in a DFStorage
     DFDistT(const size_t naux, std::shared_ptr<const StaticDist> dist, const size_t n1, const size_t n2,
-            const std::shared_ptr<const ParallelDF>);
+            const std::shared_ptr<const ParallelDF>, const int nblock);
 
     std::shared_ptr<DFDistT> clone() const;
-    std::shared_ptr<DFDistT> apply_J(std::shared_ptr<const Matrix> d) const;
-    std::shared_ptr<DFDistT> apply_J() const { return apply_J(df_->data2()); }
+    std::shared_ptr<DFDistT> apply_J(std::shared_ptr<const Matrix> d) const { return apply_J(d->data()); }
+    // d is a naux x naux matrix
+    std::shared_ptr<DFDistT> apply_J(const double* d) const;
+    std::shared_ptr<DFDistT> apply_J() const { return apply_J(df_->metric()); }
     std::vector<std::shared_ptr<Matrix>> form_aux_2index(std::shared_ptr<const DFDistT> o, const double a) const;
 
     void get_paralleldf(std::shared_ptr<ParallelDF>) const;
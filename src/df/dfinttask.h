@@ -26,7 +26,10 @@
 #define __SRC_DF_DFINTTASK_H
 
 #include <src/df/dfblock.h>
+#include <src/df/dfsparseblock.h>
+#include <src/df/dfdiskblock.h>
 #include <src/molecule/shell.h>
+#include <src/integral/rys/classbatch.h>
 
 namespace bagel {
 
@@ -47,10 +50,24 @@ class DFIntTask {
     DFIntTask(std::array<std::shared_ptr<const Shell>,4>&& a, std::array<int,3>&& b, std::array<std::shared_ptr<DFBlock>,N>& df)
      : shell_(a), offset_(b), dfblocks_(df) { };
 
+    // rough estimate of the cost, used by TaskQueue for load balancing
+    double cost() const {
+      double out = 1.0;
+      for (auto& i : shell_)
+        out *= i->nbasis() * i->num_primitive();
+      return out;
+    }
+
+    const std::array<std::shared_ptr<const Shell>,4>& shell() const { return shell_; }
+
     void compute() {
       std::shared_ptr<TBatch> p = compute_batch(shell_);
+      slot_in(*p);
+    }
 
-      // all slot in
+    // copies a computed batch of this shell triple into the blocks
+    void slot_in(TBatch& batch) {
+      TBatch* const p = &batch;
       for (int i = 0; i != N; ++i) {
         assert(dfblocks_[i]->b1size() == dfblocks_[i]->b2size());
         const size_t nbin = dfblocks_[i]->b1size();
@@ -69,6 +86,167 @@ class DFIntTask {
 };
 
 
+// Shell triples that share the basis shell pair and the angular momentum of the auxiliary shell.
+// For ERIBatch they are evaluated with ClassBatch, i.e., with one call for the Rys roots, a shared stack and the VRR over all their primitive quartets;
+// other batch types are computed one by one.
+template <typename TBatch, int N>
+class DFIntTaskClass {
+  protected:
+    std::vector<DFIntTask<TBatch,N>> tasks_;
+
+    void compute_impl(std::true_type) {
+      std::vector<std::array<std::shared_ptr<const Shell>,4>> quartets;
+      for (auto& i : tasks_)
+        quartets.push_back(i.shell());
+      ClassBatch<TBatch> batch(quartets, 2.0);
+      batch.compute();
+      for (int i = 0; i != tasks_.size(); ++i)
+        tasks_[i].slot_in(*batch[i]);
+    }
+
+    void compute_impl(std::false_type) {
+      for (auto& i : tasks_)
+        i.compute();
+    }
+
+  public:
+    // the number of shell triples in one task; larger classes are split so that they can be distributed over threads
+    constexpr static int max_size = 16;
+
+    DFIntTaskClass() { }
+
+    template<typename ...args>
+    void emplace_back(args&&... a) { tasks_.emplace_back(std::forward<args>(a)...); }
+
+    size_t size() const { return tasks_.size(); }
+
+    double cost() const {
+      double out = 0.0;
+      for (auto& i : tasks_)
+        out += i.cost();
+      return out;
+    }
+
+    void compute() {
+      compute_impl(std::integral_constant<bool, std::is_same<TBatch, ERIBatch>::value>());
+    }
+};
+
+
+// Symmetry-unique 3-index integrals (N = 1). The batch is also written to the symmetry-equivalent blocks with the signs of the basis functions.
+template <typename TBatch>
+class DFIntTaskSym : public DFIntTask<TBatch,1> {
+  public:
+    // offsets (b2, b1, aux) and signs of the functions in the shells (aux, b1, b2) for each image
+    struct Image {
+      std::array<int,3> offset;
+      std::array<const std::vector<double>*,3> sign;
+    };
+
+  protected:
+    std::vector<Image> image_;
+
+  public:
+    DFIntTaskSym(std::array<std::shared_ptr<const Shell>,4>&& a, std::vector<Image>&& im, std::array<std::shared_ptr<DFBlock>,1>& df)
+     : DFIntTask<TBatch,1>(std::move(a), std::array<int,3>(im.front().offset), df), image_(std::move(im)) { }
+
+    void compute() {
+      std::shared_ptr<TBatch> p = this->compute_batch(this->shell_);
+      const std::array<std::shared_ptr<const Shell>,4>& shell = this->shell_;
+
+      assert(this->dfblocks_[0]->b1size() == this->dfblocks_[0]->b2size());
+      const size_t nbin = this->dfblocks_[0]->b1size();
+      const size_t naux = this->dfblocks_[0]->asize();
+      double* const data = this->dfblocks_[0]->data();
+      for (auto& im : image_) {
+        const double* ppt = p->data(0);
+        const std::vector<double>& sa = *im.sign[0];
+        const std::vector<double>& s1 = *im.sign[1];
+        const std::vector<double>& s2 = *im.sign[2];
+        for (int j0 = 0; j0 != shell[3]->nbasis(); ++j0) {
+          for (int j1 = 0; j1 != shell[2]->nbasis(); ++j1, ppt += shell[1]->nbasis()) {
+            const double fac = s2[j0] * s1[j1];
+            double* target0 = data+im.offset[2]+naux*(im.offset[1]+j1+nbin*(im.offset[0]+j0));
+            double* target1 = data+im.offset[2]+naux*(im.offset[0]+j0+nbin*(im.offset[1]+j1));
+            for (int k = 0; k != shell[1]->nbasis(); ++k)
+              target0[k] = target1[k] = ppt[k] * sa[k] * fac;
+          }
+        }
+      }
+    }
+};
+
+
+// 3-index integrals of a significant shell pair, stored in DFSparseBlock
+template <typename TBatch>
+class DFIntTaskSparse {
+  protected:
+    const std::array<std::shared_ptr<const Shell>,4> shell_;
+    const size_t aoffset_;
+    const int pair_;
+    std::shared_ptr<DFSparseBlock> block_;
+
+  public:
+    DFIntTaskSparse(std::array<std::shared_ptr<const Shell>,4>&& a, const size_t ao, const int p, std::shared_ptr<DFSparseBlock> b)
+     : shell_(a), aoffset_(ao), pair_(p), block_(b) { }
+
+    double cost() const {
+      double out = 1.0;
+      for (auto& i : shell_)
+        out *= i->nbasis() * i->num_primitive();
+      return out;
+    }
+
+    void compute() {
+      auto p = std::make_shared<TBatch>(shell_, 2.0);
+      p->compute();
+
+      const size_t naux = block_->asize();
+      const int n0 = shell_[1]->nbasis();
+      const int n12 = shell_[2]->nbasis() * shell_[3]->nbasis();
+      const double* ppt = p->data(0);
+      double* const data = block_->data(pair_) + aoffset_;
+      for (int j = 0; j != n12; ++j, ppt += n0)
+        std::copy_n(ppt, n0, data+naux*j);
+    }
+};
+
+
+// 3-index integrals written to an auxiliary batch of DFDiskBlock
+template <typename TBatch>
+class DFIntTaskDisk {
+  protected:
+    const std::array<std::shared_ptr<const Shell>,4> shell_;
+    const std::array<int,3> offset_; // (b2, b1, aux in the batch)
+    double* const data_;
+    const size_t naux_;
+    const size_t nbasis_;
+
+  public:
+    DFIntTaskDisk(std::array<std::shared_ptr<const Shell>,4>&& a, std::array<int,3>&& b, double* d, const size_t na, const size_t nb)
+     : shell_(a), offset_(b), data_(d), naux_(na), nbasis_(nb) { }
+
+    double cost() const {
+      double out = 1.0;
+      for (auto& i : shell_)
+        out *= i->nbasis() * i->num_primitive();
+      return out;
+    }
+
+    void compute() {
+      auto p = std::make_shared<TBatch>(shell_, 2.0);
+      p->compute();
+
+      const double* ppt = p->data(0);
+      for (int j0 = offset_[0]; j0 != offset_[0] + shell_[3]->nbasis(); ++j0) {
+        for (int j1 = offset_[1]; j1 != offset_[1] + shell_[2]->nbasis(); ++j1, ppt += shell_[1]->nbasis()) {
+          std::copy_n(ppt, shell_[1]->nbasis(), data_+offset_[2]+naux_*(j1+nbasis_*j0));
+          std::copy_n(ppt, shell_[1]->nbasis(), data_+offset_[2]+naux_*(j0+nbasis_*j1));
+        }
+      }
+    }
+};
+
 }
 
 #endif
@@ -0,0 +1,208 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfsparseblock.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <src/df/dfsparseblock.h>
+
+using namespace bagel;
+using namespace std;
+using namespace btas;
+
+DFSparseBlock::DFSparseBlock(shared_ptr<const StaticDist> adist_shell, shared_ptr<const StaticDist> adist, const size_t asize, const size_t astart,
+                             const vector<shared_ptr<const Shell>>& bshell, const vector<pair<int,int>>& pairs)
+ : DFStorage(adist_shell, adist, asize, astart, 0LU), pair_(pairs), npacked_(0LU), shell_pair_(bshell.size()) {
+
+  for (auto& i : bshell) {
+    offset_.push_back(nbasis_);
+    shell_size_.push_back(i->nbasis());
+    nbasis_ += i->nbasis();
+  }
+  for (int i = 0; i != pair_.size(); ++i) {
+    assert(pair_[i].first <= pair_[i].second);
+    pair_offset_.push_back(npacked_);
+    npacked_ += shell_size_[pair_[i].first] * shell_size_[pair_[i].second];
+    shell_pair_[pair_[i].first].push_back(i);
+    if (pair_[i].first != pair_[i].second)
+      shell_pair_[pair_[i].second].push_back(i);
+  }
+  data_ = unique_ptr<double[]>(new double[size()]);
+}
+
+
+DFSparseBlock::DFSparseBlock(const DFSparseBlock& o)
+ : DFStorage(o), offset_(o.offset_), shell_size_(o.shell_size_),
+   pair_(o.pair_), pair_offset_(o.pair_offset_), npacked_(o.npacked_), shell_pair_(o.shell_pair_), data_(new double[o.size()]) {
+  copy_n(o.data(), size(), data());
+}
+
+
+void DFSparseBlock::scale(const double a) {
+  blas::scale_n(a, data(), size());
+}
+
+
+shared_ptr<DFStorage> DFSparseBlock::clone() const {
+  auto out = make_shared<DFSparseBlock>(*this);
+  out->zero();
+  return out;
+}
+
+
+shared_ptr<DFStorage> DFSparseBlock::copy() const {
+  return make_shared<DFSparseBlock>(*this);
+}
+
+
+shared_ptr<DFBlock> DFSparseBlock::expand() const {
+  auto out = make_shared<DFBlock>(adist_shell_, adist_, asize_, nbasis_, nbasis_, astart_, 0, 0);
+  out->zero();
+  for (int p = 0; p != pair_.size(); ++p) {
+    const int s1 = pair_[p].first;
+    const int s2 = pair_[p].second;
+    const double* d = data(p);
+    for (int m2 = 0; m2 != shell_size_[s2]; ++m2)
+      for (int m1 = 0; m1 != shell_size_[s1]; ++m1, d += asize_) {
+        copy_n(d, asize_, out->data()+asize_*(offset_[s1]+m1+nbasis_*(offset_[s2]+m2)));
+        copy_n(d, asize_, out->data()+asize_*(offset_[s2]+m2+nbasis_*(offset_[s1]+m1)));
+      }
+  }
+  return out;
+}
+
+
+shared_ptr<DFBlock> DFSparseBlock::transform_second(const MatView cmat) const {
+  assert(cmat.extent(0) == nbasis_);
+  assert(cmat.range().ordinal().contiguous());
+  const int nocc = cmat.extent(1);
+  auto out = make_shared<DFBlock>(adist_shell_, adist_, asize_, nocc, nbasis_, astart_, 0, 0);
+  out->zero();
+  if (nocc == 0) return out;
+
+  // tasks are distributed by the shell of the untransformed index, so that each task writes to its own part of out
+  TaskQueue<function<void(void)>> tasks(shell_pair_.size());
+  for (int s = 0; s != shell_pair_.size(); ++s) {
+    tasks.emplace_back(
+      [this, s, &cmat, &out, nocc]() {
+        for (auto& p : shell_pair_[s]) {
+          const int s1 = pair_[p].first;
+          const int s2 = pair_[p].second;
+          const int n1 = shell_size_[s1];
+          const int n2 = shell_size_[s2];
+          if (s2 == s) {
+            // (D|i s2) += (D|s1 s2) c_{s1 i}
+            for (int m2 = 0; m2 != n2; ++m2)
+              dgemm_("N", "N", asize_, nocc, n1, 1.0, data(p)+m2*asize_*n1, asize_, cmat.data()+offset_[s1], nbasis_, 1.0, out->data()+(offset_[s2]+m2)*asize_*nocc, asize_);
+          }
+          if (s1 == s && s1 != s2) {
+            // (D|i s1) += (D|s1 s2) c_{s2 i}
+            for (int m1 = 0; m1 != n1; ++m1)
+              dgemm_("N", "N", asize_, nocc, n2, 1.0, data(p)+m1*asize_, asize_*n1, cmat.data()+offset_[s2], nbasis_, 1.0, out->data()+(offset_[s1]+m1)*asize_*nocc, asize_);
+          }
+        }
+      }
+    );
+  }
+  tasks.compute();
+  return out;
+}
+
+
+shared_ptr<Matrix> DFSparseBlock::form_2index(const shared_ptr<const DFBlock> o, const double a) const {
+  if (asize_ != o->asize() || (nbasis_ != o->b1size() && nbasis_ != o->b2size())) throw logic_error("illegal call of DFSparseBlock::form_2index");
+  // the same convention as DFBlock::form_2index; the first matching index of o is contracted
+  const bool first = nbasis_ == o->b1size();
+  const int nk = first ? o->b2size() : o->b1size();
+  auto target = make_shared<Matrix>(nbasis_, nk);
+  if (nk == 0) return target;
+
+  TaskQueue<function<void(void)>> tasks(shell_pair_.size());
+  for (int s = 0; s != shell_pair_.size(); ++s) {
+    tasks.emplace_back(
+      [this, s, &o, &target, first, nk, a]() {
+        const double* odata = o->data();
+        double* tdata = target->data();
+        for (auto& p : shell_pair_[s]) {
+          const int s1 = pair_[p].first;
+          const int s2 = pair_[p].second;
+          const int n1 = shell_size_[s1];
+          const int n2 = shell_size_[s2];
+          if (s2 == s) {
+            // target_{s2 k} += (D|s1 s2) o_{D s1 k}
+            if (first) {
+              dgemm_("T", "N", n2, nk, asize_*n1, a, data(p), asize_*n1, odata+offset_[s1]*asize_, asize_*nbasis_, 1.0, tdata+offset_[s2], nbasis_);
+            } else {
+              for (int m1 = 0; m1 != n1; ++m1)
+                dgemm_("T", "N", n2, nk, asize_, a, data(p)+m1*asize_, asize_*n1, odata+(offset_[s1]+m1)*asize_*nk, asize_, 1.0, tdata+offset_[s2], nbasis_);
+            }
+          }
+          if (s1 == s && s1 != s2) {
+            // target_{s1 k} += (D|s1 s2) o_{D s2 k}
+            for (int m2 = 0; m2 != n2; ++m2) {
+              const double* oblock = first ? odata+(offset_[s2]+m2)*asize_ : odata+(offset_[s2]+m2)*asize_*nk;
+              dgemm_("T", "N", n1, nk, asize_, a, data(p)+m2*asize_*n1, asize_, oblock, first ? asize_*nbasis_ : asize_, 1.0, tdata+offset_[s1], nbasis_);
+            }
+          }
+        }
+      }
+    );
+  }
+  tasks.compute();
+  return target;
+}
+
+
+shared_ptr<VectorB> DFSparseBlock::form_vec(const shared_ptr<const Matrix> den) const {
+  assert(den->ndim() == nbasis_ && den->mdim() == nbasis_);
+  // packs the density in the same order as the integrals; off-diagonal shell pairs count both (rs) and (sr)
+  VectorB dpack(npacked_);
+  for (int p = 0; p != pair_.size(); ++p) {
+    const int s1 = pair_[p].first;
+    const int s2 = pair_[p].second;
+    double* d = dpack.data() + pair_offset_[p];
+    for (int m2 = offset_[s2]; m2 != offset_[s2]+shell_size_[s2]; ++m2)
+      for (int m1 = offset_[s1]; m1 != offset_[s1]+shell_size_[s1]; ++m1, ++d)
+        *d = s1 == s2 ? den->element(m1, m2) : den->element(m1, m2) + den->element(m2, m1);
+  }
+  auto out = make_shared<VectorB>(asize_);
+  dgemv_("N", asize_, npacked_, 1.0, data(), asize_, dpack.data(), 1, 0.0, out->data(), 1);
+  return out;
+}
+
+
+shared_ptr<Matrix> DFSparseBlock::form_mat(const Tensor1<double>& fit) const {
+  assert(fit.size() == asize_);
+  VectorB vpack(npacked_);
+  dgemv_("T", asize_, npacked_, 1.0, data(), asize_, fit.data(), 1, 0.0, vpack.data(), 1);
+
+  auto out = make_shared<Matrix>(nbasis_, nbasis_);
+  for (int p = 0; p != pair_.size(); ++p) {
+    const int s1 = pair_[p].first;
+    const int s2 = pair_[p].second;
+    const double* v = vpack.data() + pair_offset_[p];
+    for (int m2 = offset_[s2]; m2 != offset_[s2]+shell_size_[s2]; ++m2)
+      for (int m1 = offset_[s1]; m1 != offset_[s1]+shell_size_[s1]; ++m1, ++v)
+        out->element(m1, m2) = out->element(m2, m1) = *v;
+  }
+  return out;
+}
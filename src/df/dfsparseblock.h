@@ -0,0 +1,85 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfsparseblock.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_DF_DFSPARSEBLOCK_H
+#define __SRC_DF_DFSPARSEBLOCK_H
+
+#include <src/df/dfstorage.h>
+#include <src/molecule/shell.h>
+
+namespace bagel {
+
+/*
+    DFSparseBlock is a slice of 3-index DF integrals (D|rs) in the AO basis, in which only significant shell pairs (r <= s) are stored.
+*/
+
+class DFSparseBlock : public DFStorage {
+  protected:
+    // offsets and sizes of the shells in the orbital basis
+    std::vector<int> offset_;
+    std::vector<int> shell_size_;
+
+    // significant shell pairs (first <= second). (D|r s) of pair i is a column-major [aux][r][s] block starting at column pair_offset_[i] of data_
+    std::vector<std::pair<int,int>> pair_;
+    std::vector<size_t> pair_offset_;
+    size_t npacked_;
+    // pairs that contain each shell, used to distribute the work by the output index
+    std::vector<std::vector<int>> shell_pair_;
+
+    std::unique_ptr<double[]> data_;
+
+  public:
+    DFSparseBlock(std::shared_ptr<const StaticDist> adist_shell, std::shared_ptr<const StaticDist> adist, const size_t asize, const size_t astart,
+                  const std::vector<std::shared_ptr<const Shell>>& bshell, const std::vector<std::pair<int,int>>& pairs);
+    DFSparseBlock(const DFSparseBlock& o);
+
+    size_t npair() const { return pair_.size(); }
+    const std::pair<int,int>& pair_shells(const size_t i) const { return pair_[i]; }
+    // number of stored (rs) elements, and the number of doubles
+    size_t npacked() const { return npacked_; }
+    size_t size() const { return asize_*npacked_; }
+
+    double* data() { return data_.get(); }
+    const double* data() const { return data_.get(); }
+    double* data(const size_t i) { return data_.get() + asize_*pair_offset_[i]; }
+    const double* data(const size_t i) const { return data_.get() + asize_*pair_offset_[i]; }
+
+    void zero() { std::fill_n(data(), size(), 0.0); }
+    void scale(const double a) override;
+
+    std::shared_ptr<DFStorage> clone() const override;
+    std::shared_ptr<DFStorage> copy() const override;
+    // returns the dense block (D|rs)
+    std::shared_ptr<DFBlock> expand() const;
+
+    std::shared_ptr<DFBlock> transform_second(const MatView c) const override;
+    std::shared_ptr<Matrix> form_2index(const std::shared_ptr<const DFBlock> o, const double a) const override;
+    std::shared_ptr<VectorB> form_vec(const std::shared_ptr<const Matrix> den) const override;
+    std::shared_ptr<Matrix> form_mat(const btas::Tensor1<double>& fit) const override;
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: dfstorage.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_DF_DFSTORAGE_H
+#define __SRC_DF_DFSTORAGE_H
+
+#include <src/df/dfblock.h>
+
+namespace bagel {
+
+/*
+    DFStorage is an alternative to the dense in-memory DFBlock for the AO 3-index integrals (D|rs) of DFDist (symmetric in r and s).
+    Distributed by the first index at the shell boundary. Only the operations used to build Fock matrices and half-transformed integrals are provided.
+*/
+
+class DFStorage {
+  protected:
+    // distribution information
+    std::shared_ptr<const StaticDist> adist_shell_;
+    std::shared_ptr<const StaticDist> adist_;
+
+    size_t asize_;
+    size_t astart_;
+    size_t nbasis_;
+
+  public:
+    DFStorage(std::shared_ptr<const StaticDist> adist_shell, std::shared_ptr<const StaticDist> adist, const size_t asize, const size_t astart, const size_t nbasis)
+     : adist_shell_(adist_shell), adist_(adist), asize_(asize), astart_(astart), nbasis_(nbasis) { }
+    virtual ~DFStorage() { }
+
+    size_t asize() const { return asize_; }
+    size_t astart() const { return astart_; }
+    size_t nbasis() const { return nbasis_; }
+
+    const std::shared_ptr<const StaticDist>& adist_now() const { return adist_shell_; }
+
+    virtual void scale(const double a) = 0;
+
+    virtual std::shared_ptr<DFStorage> clone() const = 0;
+    virtual std::shared_ptr<DFStorage> copy() const = 0;
+
+    // (D|is) = c_ri (D|rs). The result is dense.
+    virtual std::shared_ptr<DFBlock> transform_second(const MatView c) const = 0;
+
+    // Form 2-index integrals with a dense block (see DFBlock::form_2index)
+    virtual std::shared_ptr<Matrix> form_2index(const std::shared_ptr<const DFBlock> o, const double a) const = 0;
+
+    virtual std::shared_ptr<VectorB> form_vec(const std::shared_ptr<const Matrix> den) const = 0;
+    virtual std::shared_ptr<Matrix> form_mat(const btas::Tensor1<double>& fit) const = 0;
+};
+
+}
+
+#endif
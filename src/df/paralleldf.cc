@@ -24,10 +24,55 @@
 
 #include <src/df/paralleldf.h>
 #include <src/df/dfdistt.h>
+#include <src/util/parallel/scalapack.h>
 
 using namespace std;
 using namespace bagel;
 
+#ifdef HAVE_SCALAPACK
+namespace {
+// sums the matrices of all the processes and leaves the result distributed in the block-cyclic layout of DistMatrix
+shared_ptr<DistMatrix> reduce_scatter(const Matrix& o) {
+  const int n = o.ndim();
+  const int m = o.mdim();
+  const int nprow = mpi__->nprow();
+  const int npcol = mpi__->npcol();
+
+  // process-grid coordinates of the ranks in the current communicator (which may be split)
+  vector<int> grid(2*mpi__->size(), 0);
+  grid[2*mpi__->rank()] = mpi__->myprow();
+  grid[2*mpi__->rank()+1] = mpi__->mypcol();
+  mpi__->allreduce(grid.data(), grid.size());
+
+  // local sizes of the processes, and their offsets in the send buffer
+  vector<int> counts;
+  for (int r = 0; r != mpi__->size(); ++r)
+    counts.push_back(numroc_(n, blocksize__, grid[2*r], 0, nprow) * numroc_(m, blocksize__, grid[2*r+1], 0, npcol));
+
+  unique_ptr<double[]> send(new double[n*m]);
+  double* dest = send.get();
+  for (int r = 0; r != mpi__->size(); ++r) {
+    const int localrow = numroc_(n, blocksize__, grid[2*r], 0, nprow);
+    int lj = 0;
+    for (int j = grid[2*r+1]*blocksize__; j < m; j += npcol*blocksize__)
+      for (int jj = j; jj != min(m, j+blocksize__); ++jj, ++lj) {
+        int li = 0;
+        for (int i = grid[2*r]*blocksize__; i < n; i += nprow*blocksize__) {
+          const int len = min(blocksize__, n-i);
+          copy_n(o.element_ptr(i, jj), len, dest+li+localrow*lj);
+          li += len;
+        }
+      }
+    dest += localrow*lj;
+  }
+
+  auto out = make_shared<DistMatrix>(n, m);
+  mpi__->reduce_scatter(send.get(), out->local().get(), counts);
+  return out;
+}
+}
+#endif
+
 
 ParallelDF::ParallelDF(const size_t naux, const size_t nb1, const size_t nb2, shared_ptr<const ParallelDF> df, shared_ptr<Matrix> dat, const bool serial)
  : naux_(naux), nindex1_(nb1), nindex2_(nb2), df_(df), data2_(dat), serial_(df ? df->serial_ : serial) {
@@ -35,27 +80,109 @@ ParallelDF::ParallelDF(const size_t naux, const size_t nb1, const size_t nb2, sh
 }
 
 
+void ParallelDF::share_data2() {
+  assert(data2_ && data2_->ndim() == naux_ && data2_->mdim() == naux_);
+  // all the processes have to take part; processes in split communicators may not do so at the same time
+  if (mpi__->node_size() == 1 || mpi__->depth() > 0)
+    return;
+  auto shared = make_shared<RMAWindow_shared<double>>(naux_*naux_);
+  shared->sync();
+  if (shared->owner())
+    copy_n(data2_->data(), naux_*naux_, shared->data());
+  shared->sync();
+  data2_shared_ = shared;
+  data2_.reset();
+}
+
+
+shared_ptr<const Matrix> ParallelDF::data2() const {
+  if (data2_ || !data2_shared_)
+    return data2_;
+  auto out = make_shared<Matrix>(naux_, naux_, true);
+  copy_n(data2_shared_->data(), naux_*naux_, out->data());
+  return out;
+}
+
+
+const double* ParallelDF::metric() const {
+  if (!has_data2()) throw logic_error("ParallelDF::metric was called without 2-index integrals");
+  return data2_ ? data2_->data() : data2_shared_->data();
+}
+
+
+shared_ptr<Matrix> ParallelDF::metric_squared() const {
+  auto out = make_shared<Matrix>(naux_, naux_, true);
+  dgemm_("N", "N", naux_, naux_, naux_, 1.0, metric(), naux_, metric(), naux_, 0.0, out->data(), naux_);
+  return out;
+}
+
+
+void ParallelDF::tiled_allreduce(const size_t n, const size_t stride, function<void(const size_t, const size_t)> compute, double* out, const size_t cost) const {
+  // about 1M elements (times the cost of each) per step, but no more than 16 steps
+  const size_t nstep = serial_ ? 1 : max<size_t>(1, min<size_t>({n, 16, n*stride*cost >> 20}));
+  vector<int> requests;
+  for (size_t i = 0; i != nstep; ++i) {
+    const size_t start = n*i/nstep;
+    const size_t fence = n*(i+1)/nstep;
+    compute(start, fence);
+    if (!serial_ && fence > start && stride > 0) {
+      // testing the previous requests lets MPI progress them
+      for (auto& r : requests)
+        mpi__->test(r);
+      requests.push_back(mpi__->request_allreduce(out+start*stride, (fence-start)*stride));
+    }
+  }
+  for (auto& r : requests)
+    mpi__->wait(r);
+}
+
+
+shared_ptr<Matrix> ParallelDF::form_2index_local(shared_ptr<const ParallelDF> o, const double a, const bool swap) const {
+  shared_ptr<Matrix> out;
+  if (has_storage() || o->has_storage()) {
+    if ((has_storage() && o->has_storage()) || (has_storage() ? o->block_.size() : block_.size()) != 1) throw logic_error("ParallelDF::form_2index with DFStorage requires a dense partner");
+    // AO integrals in DFStorage are symmetric, so the result with the storage on the right is obtained by transposition
+    out = has_storage() ? storage_->form_2index(o->block_[0], a) : o->storage_->form_2index(block_[0], a);
+    if (has_storage() == swap)
+      out = out->transpose();
+  } else {
+    if (block_.size() != 1 || o->block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
+    out = (!swap) ? block_[0]->form_2index(o->block_[0], a) : o->block_[0]->form_2index(block_[0], a);
+  }
+  return out;
+}
+
+
 shared_ptr<Matrix> ParallelDF::form_2index(shared_ptr<const ParallelDF> o, const double a, const bool swap) const {
+  if (serial_ || has_storage() || o->has_storage()) {
+    shared_ptr<Matrix> out = form_2index_local(o, a, swap);
+    if (!serial_)
+      out->allreduce();
+    return out;
+  }
   if (block_.size() != 1 || o->block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
-  shared_ptr<Matrix> out = (!swap) ? block_[0]->form_2index(o->block_[0], a) : o->block_[0]->form_2index(block_[0], a);
-  if (!serial_)
-    out->allreduce();
+  shared_ptr<const DFBlock> left = !swap ? block_[0] : o->block_[0];
+  shared_ptr<const DFBlock> right = !swap ? o->block_[0] : block_[0];
+  const bool b1 = left->b1size() == right->b1size();
+  auto out = make_shared<Matrix>(b1 ? left->b2size() : left->b1size(), b1 ? right->b2size() : right->b1size());
+  tiled_allreduce(out->mdim(), out->ndim(), [&](const size_t s, const size_t f) { left->form_2index_tile(right, a, s, f, out->data()); }, out->data());
   return out;
 }
 
 
 shared_ptr<Matrix> ParallelDF::form_4index(shared_ptr<const ParallelDF> o, const double a, const bool swap) const {
+  if (has_storage() || o->has_storage()) throw logic_error("ParallelDF::form_4index is not implemented with DFStorage");
   if (block_.size() != 1 || o->block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
-  shared_ptr<Matrix> out = (!swap) ? block_[0]->form_4index(o->block_[0], a) : o->block_[0]->form_4index(block_[0], a);
-
-  // all reduce
-  if (!serial_)
-    out->allreduce();
+  shared_ptr<const DFBlock> left = !swap ? block_[0] : o->block_[0];
+  shared_ptr<const DFBlock> right = !swap ? o->block_[0] : block_[0];
+  auto out = make_shared<Matrix>(left->b1size()*left->b2size(), right->b1size()*right->b2size());
+  tiled_allreduce(out->mdim(), out->ndim(), [&](const size_t s, const size_t f) { left->form_4index_tile(right, a, s, f, out->data()); }, out->data());
   return out;
 }
 
 
 shared_ptr<Matrix> ParallelDF::form_aux_2index(shared_ptr<const ParallelDF> o, const double a) const {
+  if (has_storage() || o->has_storage()) throw logic_error("ParallelDF::form_aux_2index is not implemented with DFStorage");
   if (block_.size() != 1 || o->block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
 #ifdef HAVE_MPI_H
   if (!serial_) {
@@ -72,6 +199,7 @@ shared_ptr<Matrix> ParallelDF::form_aux_2index(shared_ptr<const ParallelDF> o, c
 
 
 void ParallelDF::add_direct_product(const vector<shared_ptr<const VectorB>> cd, const vector<shared_ptr<const Matrix>> dd, const double a) {
+  if (has_storage()) throw logic_error("ParallelDF::add_direct_product is not implemented with DFStorage");
   if (block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
   if (cd.size() != dd.size()) throw logic_error("Illegal call of ParallelDF::DFDist");
 
@@ -85,6 +213,7 @@ void ParallelDF::add_direct_product(const vector<shared_ptr<const VectorB>> cd,
 
 
 void ParallelDF::ax_plus_y(const double a, const shared_ptr<const ParallelDF> o) {
+  if (has_storage() || o->has_storage()) throw logic_error("ParallelDF::ax_plus_y is not implemented with DFStorage");
   assert(block_.size() == o->block_.size());
   auto j = o->block_.begin();
   for (auto& i : block_)
@@ -95,6 +224,8 @@ void ParallelDF::ax_plus_y(const double a, const shared_ptr<const ParallelDF> o)
 void ParallelDF::scale(const double a) {
   for (auto& i : block_)
     i->scale(a);
+  if (has_storage())
+    storage_->scale(a);
 }
 
 
@@ -110,6 +241,7 @@ void ParallelDF::add_block(shared_ptr<DFBlock> o) {
 
 
 shared_ptr<btas::Tensor3<double>> ParallelDF::get_block(const int i, const int id, const int j, const int jd, const int k, const int kd) const {
+  if (has_storage()) throw logic_error("ParallelDF::get_block is not implemented with DFStorage");
   if (block_.size() != 1) throw logic_error("so far assumes block_.size() == 1");
   // first thing is to find the node
   tuple<size_t, size_t> info = adist_now()->locate(i);
@@ -124,40 +256,87 @@ shared_ptr<btas::Tensor3<double>> ParallelDF::get_block(const int i, const int i
 }
 
 
+shared_ptr<Matrix> ParallelDF::compute_Jop_from_cd_local(shared_ptr<const VectorB> tmp0) const {
+  if (has_storage())
+    return storage_->form_mat(tmp0->slice(storage_->astart(), storage_->astart()+storage_->asize()));
+  if (block_.size() != 1) throw logic_error("compute_Jop so far assumes block_.size() == 1");
+  return block_[0]->form_mat(tmp0->slice(block_[0]->astart(), block_[0]->astart()+block_[0]->asize()));
+}
+
+
 shared_ptr<Matrix> ParallelDF::compute_Jop_from_cd(shared_ptr<const VectorB> tmp0) const {
+  if (serial_ || has_storage()) {
+    shared_ptr<Matrix> out = compute_Jop_from_cd_local(tmp0);
+    if (!serial_)
+      out->allreduce();
+    return out;
+  }
   if (block_.size() != 1) throw logic_error("compute_Jop so far assumes block_.size() == 1");
-  shared_ptr<Matrix> out = block_[0]->form_mat(tmp0->slice(block_[0]->astart(), block_[0]->astart()+block_[0]->asize()));
-  // all reduce
-  if (!serial_)
-    out->allreduce();
+  shared_ptr<const DFBlock> block = block_[0];
+  auto out = make_shared<Matrix>(block->b1size(), block->b2size());
+  tiled_allreduce(out->size(), 1, [&](const size_t s, const size_t f) { block->form_mat_tile(tmp0->data()+block->astart(), s, f, out->data()); }, out->data());
   return out;
 }
 
 
 shared_ptr<VectorB> ParallelDF::compute_cd(const shared_ptr<const Matrix> den, shared_ptr<const Matrix> dat2, const int number_of_j) const {
-  if (!dat2 && !data2_) throw logic_error("ParallelDF::compute_cd was called without 2-index integrals");
-  if (!dat2) dat2 = data2_;
+  if (dat2 && (dat2->ndim() != naux_ || dat2->mdim() != naux_)) throw logic_error("ParallelDF::compute_cd was called with a wrong metric");
+  return compute_cd(den, dat2 ? dat2->data() : metric(), number_of_j);
+}
 
+
+shared_ptr<VectorB> ParallelDF::compute_cd(const shared_ptr<const Matrix> den, const double* metric, const int number_of_j) const {
   auto tmp0 = make_shared<VectorB>(naux_);
 
   // D = (D|rs)*d_rs
-  if (block_.size() != 1) throw logic_error("compute_Jop so far assumes block_.size() == 1");
-  shared_ptr<VectorB> tmp = block_[0]->form_vec(den);
-  copy_n(tmp->data(), block_[0]->asize(), tmp0->data()+block_[0]->astart());
-  // All reduce
-  if (!serial_)
-    tmp0->allreduce();
-
-  if (number_of_j == 1)
-    *tmp0 = *dat2 * *tmp0;
-  else if (number_of_j == 2)
-    *tmp0 = *dat2 * (*dat2 * *tmp0);
-  else if (number_of_j != 0)
+  if (has_storage()) {
+    shared_ptr<VectorB> tmp = storage_->form_vec(den);
+    copy_n(tmp->data(), storage_->asize(), tmp0->data()+storage_->astart());
+    // All reduce
+    if (!serial_)
+      tmp0->allreduce();
+  } else {
+    if (block_.size() != 1) throw logic_error("compute_Jop so far assumes block_.size() == 1");
+    // the vector is short, but each of its elements takes a contraction over all the basis pairs
+    shared_ptr<const DFBlock> block = block_[0];
+    tiled_allreduce(naux_, 1, [&](const size_t s, const size_t f) { block->form_vec_tile(den, s, f, tmp0->data()); }, tmp0->data(), den->size());
+  }
+
+  if (number_of_j < 0 || number_of_j > 2)
     throw logic_error("wrong number of J in ParallelDF::compute_cd");
+  for (int i = 0; i != number_of_j; ++i) {
+    const VectorB tmp(*tmp0);
+    dgemv_("N", naux_, naux_, 1.0, metric, naux_, tmp.data(), 1, 0.0, tmp0->data(), 1);
+  }
   return tmp0;
 }
 
 
+shared_ptr<DistMatrix> ParallelDF::form_2index_dist(shared_ptr<const ParallelDF> o, const double a, const bool swap) const {
+#ifdef HAVE_SCALAPACK
+  shared_ptr<const Matrix> out = form_2index_local(o, a, swap);
+  return serial_ ? out->distmatrix() : reduce_scatter(*out);
+#else
+  return form_2index(o, a, swap);
+#endif
+}
+
+
+shared_ptr<DistMatrix> ParallelDF::compute_Jop_dist(const shared_ptr<const Matrix> den) const {
+  return compute_Jop_dist(this->shared_from_this(), den);
+}
+
+
+shared_ptr<DistMatrix> ParallelDF::compute_Jop_dist(const shared_ptr<const ParallelDF> o, const shared_ptr<const Matrix> den, const bool onlyonce) const {
+#ifdef HAVE_SCALAPACK
+  shared_ptr<const Matrix> out = compute_Jop_from_cd_local(o->compute_cd(den, metric(), onlyonce ? 1 : 2));
+  return serial_ ? out->distmatrix() : reduce_scatter(*out);
+#else
+  return compute_Jop(o, den, onlyonce);
+#endif
+}
+
+
 shared_ptr<Matrix> ParallelDF::compute_Jop(const shared_ptr<const Matrix> den) const {
   return compute_Jop(this->shared_from_this(), den);
 }
@@ -165,7 +344,7 @@ shared_ptr<Matrix> ParallelDF::compute_Jop(const shared_ptr<const Matrix> den) c
 
 shared_ptr<Matrix> ParallelDF::compute_Jop(const shared_ptr<const ParallelDF> o, const shared_ptr<const Matrix> den, const bool onlyonce) const {
   // first compute |E*) = d_rs (D|rs) J^{-1}_DE
-  shared_ptr<const VectorB> tmp0 = o->compute_cd(den, data2_, onlyonce ? 1 : 2);
+  shared_ptr<const VectorB> tmp0 = o->compute_cd(den, metric(), onlyonce ? 1 : 2);
   // then compute J operator J_{rs} = |E*) (E|rs)
   return compute_Jop_from_cd(tmp0);
 }
@@ -26,9 +26,11 @@
 #ifndef __SRC_DF_PARALLELDF_H
 #define __SRC_DF_PARALLELDF_H
 
+#include <functional>
 #include <src/df/dfinttask_old.h>
 #include <src/df/dfinttask.h>
 #include <src/df/dfblock.h>
+#include <src/util/parallel/rmawindow.h>
 
 namespace bagel {
 
@@ -36,6 +38,8 @@ class ParallelDF : public std::enable_shared_from_this<ParallelDF> {
   protected:
     // blocks that this process has
     std::vector<std::shared_ptr<DFBlock>> block_;
+    // AO integrals held in an alternative storage (sparse or out-of-core), used instead of block_
+    std::shared_ptr<DFStorage> storage_;
 
     // naux runs fastest, nindex2 runs slowest
     const size_t naux_;
@@ -46,9 +50,19 @@ class ParallelDF : public std::enable_shared_from_this<ParallelDF> {
     // data2_ is usually empty (except for the original DFDist)
     // AO two-index integrals ^ -1/2
     std::shared_ptr<Matrix> data2_;
+    // the same held once per node in shared memory (data2_ is then empty)
+    std::shared_ptr<const RMAWindow_shared<double>> data2_shared_;
 
     bool serial_;
 
+    // Evaluates a result of n tiles of stride elements with compute(start, fence) in several steps and sums it over
+    // the processes. The reduction of each step is issued without blocking, so that it overlaps with the computation of the next.
+    // cost is the relative work per element, by which the number of steps is increased.
+    void tiled_allreduce(const size_t n, const size_t stride, std::function<void(const size_t, const size_t)> compute, double* out, const size_t cost = 1) const;
+    // parts of form_2index and compute_Jop_from_cd that are computed on each process before the reduction
+    std::shared_ptr<Matrix> form_2index_local(std::shared_ptr<const ParallelDF> o, const double a, const bool swap) const;
+    std::shared_ptr<Matrix> compute_Jop_from_cd_local(std::shared_ptr<const VectorB> cd) const;
+
   public:
     ParallelDF(const size_t, const size_t, const size_t, std::shared_ptr<const ParallelDF> = nullptr, std::shared_ptr<Matrix> = nullptr, const bool serial = false);
     virtual ~ParallelDF() { }
@@ -65,7 +79,14 @@ class ParallelDF : public std::enable_shared_from_this<ParallelDF> {
     std::shared_ptr<DFBlock> block(const size_t i) { return block_[i]; }
     std::shared_ptr<const DFBlock> block(const size_t i) const { return block_[i]; }
 
-    std::shared_ptr<const StaticDist> adist_now() const { return block_[0]->adist_now(); }
+    bool has_storage() const { return storage_.get() != nullptr; }
+    std::shared_ptr<DFStorage> storage() { return storage_; }
+    std::shared_ptr<const DFStorage> storage() const { return storage_; }
+
+    std::shared_ptr<const StaticDist> adist_now() const { return has_storage() ? storage_->adist_now() : block_[0]->adist_now(); }
+    // the auxiliary functions held by this process
+    size_t astart() const { return has_storage() ? storage_->astart() : block_[0]->astart(); }
+    size_t asize() const { return has_storage() ? storage_->asize() : block_[0]->asize(); }
 
     void add_block(std::shared_ptr<DFBlock> o);
 
@@ -84,7 +105,16 @@ class ParallelDF : public std::enable_shared_from_this<ParallelDF> {
     std::shared_ptr<btas::Tensor3<double>> get_block(const int i, const int id, const int j, const int jd, const int k, const int kd) const;
 
     const std::shared_ptr<const ParallelDF> df() const { return df_; }
-    std::shared_ptr<const Matrix> data2() const { return data2_; }
+    // data2() returns a copy when the matrix is in shared memory; metric() does not copy
+    std::shared_ptr<const Matrix> data2() const;
+    bool has_data2() const { return data2_ || data2_shared_; }
+    const double* metric() const;
+    // J^-1, the square of the metric, formed without copying the metric
+    std::shared_ptr<Matrix> metric_squared() const;
+    // use the 2-index integrals of o
+    void set_data2(const ParallelDF& o) { data2_ = o.data2_; data2_shared_ = o.data2_shared_; }
+    // moves data2_ to memory shared by the processes on a node, if there are more than one. Collective.
+    void share_data2();
 
     // compute a J operator, given density matrices in AO basis
     std::shared_ptr<Matrix> compute_Jop(const std::shared_ptr<const Matrix> den) const;
@@ -92,6 +122,13 @@ class ParallelDF : public std::enable_shared_from_this<ParallelDF> {
     std::shared_ptr<Matrix> compute_Jop_from_cd(std::shared_ptr<const VectorB> cd) const;
     std::shared_ptr<VectorB> compute_cd(const std::shared_ptr<const Matrix> den, std::shared_ptr<const Matrix> dat2 = nullptr, const int number_of_j = 2) const;
 
+    // same as form_2index and compute_Jop, but the results are reduce-scattered to a distributed matrix (with ScaLAPACK)
+    std::shared_ptr<DistMatrix> form_2index_dist(std::shared_ptr<const ParallelDF> o, const double a, const bool swap = false) const;
+    std::shared_ptr<DistMatrix> compute_Jop_dist(const std::shared_ptr<const Matrix> den) const;
+    std::shared_ptr<DistMatrix> compute_Jop_dist(const std::shared_ptr<const ParallelDF> o, const std::shared_ptr<const Matrix> den, const bool onlyonce = false) const;
+    // the same with a metric (naux x naux) given by a pointer
+    std::shared_ptr<VectorB> compute_cd(const std::shared_ptr<const Matrix> den, const double* metric, const int number_of_j) const;
+
     void average_3index() {
       Timer time;
       if (!serial_)
@@ -29,6 +29,7 @@
 #include <src/util/parallel/resources.h>
 #include <src/util/parallel/mpi_interface.h>
 #include <array>
+#include <map>
 
 using namespace std;
 using namespace bagel;
@@ -213,6 +214,8 @@ vector<shared_ptr<GradTask>> GradEval_base::contract_gradsmall1e(array<shared_pt
 
 vector<shared_ptr<GradTask>> GradEval_base::contract_grad2e(const array<shared_ptr<const DFDist>,6> o, const shared_ptr<const Geometry> geom) {
   shared_ptr<const Geometry> cgeom = geom ? geom : geom_;
+  if (cgeom->cholesky_thresh() > 0.0)
+    throw runtime_error("cholesky_thresh is not implemented for gradients");
   vector<shared_ptr<GradTask>> out;
   const size_t nshell  = std::accumulate(cgeom->atoms().begin(), cgeom->atoms().end(), 0,
                                           [](const int& i, const shared_ptr<const Atom>& o) { return i+o->shells().size(); });
@@ -310,6 +313,8 @@ vector<shared_ptr<GradTask>> GradEval_base::contract_grad1e_fnai(const array<sha
 
 vector<shared_ptr<GradTask>> GradEval_base::contract_grad2e(const shared_ptr<const DFDist> o, const shared_ptr<const Geometry> geom) {
   shared_ptr<const Geometry> cgeom = geom ? geom : geom_;
+  if (cgeom->cholesky_thresh() > 0.0)
+    throw runtime_error("cholesky_thresh is not implemented for gradients");
   vector<shared_ptr<GradTask>> out;
   const size_t nshell  = std::accumulate(cgeom->atoms().begin(), cgeom->atoms().end(), 0,
                                           [](const int& i, const shared_ptr<const Atom>& o) { return i+o->shells().size(); });
@@ -336,6 +341,8 @@ vector<shared_ptr<GradTask>> GradEval_base::contract_grad2e(const shared_ptr<con
         for (auto b0 = (*a0)->shells().begin(); b0 != (*a0)->shells().end(); ++b0, ++o0) {
           auto o1 = a0!=a1 ? oa1->begin() : o0;
           for (auto b1 = (a0!=a1 ? (*a1)->shells().begin() : b0); b1 != (*a1)->shells().end(); ++b1, ++o1) {
+            // auxiliary shells are grouped by angular momentum so that the integrals are computed by class
+            map<int, shared_ptr<GradTask3Class>> classes;
             auto o2 = oa2->begin();
             for (auto b2 = (*a2)->shells().begin(); b2 != (*a2)->shells().end(); ++b2, ++o2) {
               tuple<size_t, size_t> info = o->adist_now()->locate(*o2);
@@ -345,8 +352,18 @@ vector<shared_ptr<GradTask>> GradEval_base::contract_grad2e(const shared_ptr<con
               vector<int> atoms = {iatom0, iatom1, iatom2};
               vector<int> offs = {*o0, *o1, *o2};
 
-              out.push_back(make_shared<GradTask3>(input, atoms, offs, o, this));
+              shared_ptr<GradTask3Class>& current = classes[(*b2)->angular_number()];
+              if (!current)
+                current = make_shared<GradTask3Class>(this);
+              current->emplace_back(GradTask3(input, atoms, offs, o, this));
+              if (current->size() == GradTask3Class::max_size) {
+                out.push_back(current);
+                current.reset();
+              }
             }
+            for (auto& i : classes)
+              if (i.second)
+                out.push_back(i.second);
           }
         }
 
@@ -84,6 +84,7 @@ class GradEval_base {
     friend class GradTask1s;
     friend class GradTask2;
     friend class GradTask3;
+    friend class GradTask3Class;
     friend class GradTask1r;
     friend class GradTask1f;
     friend class GradTask3r;
@@ -31,21 +31,22 @@
 #include <src/integral/os/goverlapbatch.h>
 #include <src/integral/os/gkineticbatch.h>
 #include <src/util/prim_op.h>
-#ifdef LIBINT_INTERFACE
-  #include <src/integral/libint/glibint.h>
-#endif
+#include <src/integral/eribackend.h>
 
 using namespace std;
 using namespace bagel;
 
 
 void GradTask3::compute() {
-#ifdef LIBINT_INTERFACE
-  GLibint gradbatch(shell_);
-#else
-  GradBatch gradbatch(shell_, 0.0);
-#endif
+  AutoGradBatch batch(shell_, 0.0);
+  RysInt& gradbatch = *batch;
   gradbatch.compute();
+  contract(gradbatch);
+}
+
+
+template<typename TBatch>
+void GradTask3::contract(TBatch& gradbatch) {
   const size_t sblock = shell_[1]->nbasis()*shell_[2]->nbasis()*shell_[3]->nbasis();
   assert(sblock <= gradbatch.size_block());
 
@@ -73,15 +74,34 @@ void GradTask3::compute() {
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GradTask3Class::compute() {
+  // the quartets for which libint is chosen are computed one by one; the rest are batched over the class
+  vector<array<shared_ptr<const Shell>,4>> quartets;
+  vector<GradTask3*> rys;
+  for (auto& i : tasks_)
+    if (eri_use_libint(ERIBackend::Kernel::Gradient, i.shell_)) {
+      i.compute();
+    } else {
+      quartets.push_back(i.shell_);
+      rys.push_back(&i);
+    }
+  if (quartets.empty())
+    return;
+  ClassBatch<GradBatch> batch(quartets, 0.0);
+  batch.compute();
+  for (int i = 0; i != rys.size(); ++i)
+    rys[i]->contract(*batch[i]);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // significant repetition, but not sure how to nicely eliminate them
 void GradTask1f::compute() {
-#ifdef LIBINT_INTERFACE
-  GLibint gradbatch(shell_);
-#else
-  GradBatch gradbatch(shell_, 0.0);
-#endif
+  AutoGradBatch batch(shell_, 0.0);
+  RysInt& gradbatch = *batch;
   gradbatch.compute();
   const size_t sblock = shell_[2]->nbasis()*shell_[3]->nbasis();
   assert(sblock <= gradbatch.size_block() && shell_[1]->nbasis() == 1);
@@ -111,11 +131,8 @@ void GradTask1f::compute() {
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void GradTask2::compute() {
-#ifdef LIBINT_INTERFACE
-  GLibint gradbatch(shell_);
-#else
-  GradBatch gradbatch(shell_, 0.0);
-#endif
+  AutoGradBatch batch(shell_, 0.0);
+  RysInt& gradbatch = *batch;
   gradbatch.compute();
 
   // unfortunately the convention is different...
@@ -45,22 +45,60 @@ class GradTask {
       }
     }
 
+    // rough estimate of the cost, used by TaskQueue for load balancing
+    template<size_t N>
+    static double shell_cost(const std::array<std::shared_ptr<const Shell>,N>& s) {
+      double out = 1.0;
+      for (auto& i : s)
+        out *= i->nbasis() * i->num_primitive();
+      return out;
+    }
+
   public:
     GradTask(const std::vector<int>& a, const std::vector<int>& o, GradEval_base* p) : ge_(p) { common_init(a,o); }
     virtual void compute() = 0;
+    virtual double cost() const { return 1.0; }
 };
 
 
 /// 3-index 2-electron gradient integrals
 class GradTask3 : public GradTask {
+  friend class GradTask3Class;
   private:
     std::array<std::shared_ptr<const Shell>, 4> shell_;
     std::shared_ptr<const DFDist> den_;
+
+    // contracts a computed batch with the 3-index density
+    template<typename TBatch>
+    void contract(TBatch& gradbatch);
+
   public:
     GradTask3(const std::array<std::shared_ptr<const Shell>,4>& s, const std::vector<int>& a, const std::vector<int>& o,
               const std::shared_ptr<const DFDist> d, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den_(d) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
+};
+
+
+/// 3-index gradient integrals of one basis shell pair whose auxiliary shells have the same angular momentum (see ClassBatch)
+class GradTask3Class : public GradTask {
+  private:
+    std::vector<GradTask3> tasks_;
+  public:
+    // the number of shell triples in one task; larger classes are split so that they can be distributed over threads
+    constexpr static int max_size = 16;
+
+    GradTask3Class(GradEval_base* p) : GradTask(std::vector<int>(), std::vector<int>(), p) { }
+    void emplace_back(GradTask3&& t) { tasks_.push_back(std::move(t)); }
+    size_t size() const { return tasks_.size(); }
+    void compute();
+    double cost() const override {
+      double out = 0.0;
+      for (auto& i : tasks_)
+        out += i.cost();
+      return out;
+    }
 };
 
 
@@ -74,6 +112,7 @@ class GradTask2 : public GradTask {
               const std::shared_ptr<const Matrix> d, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den2_(d) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -95,6 +134,7 @@ class GradTask1 : public GradTask {
               const std::shared_ptr<const Matrix> nmat, const std::shared_ptr<const Matrix> kmat, const std::shared_ptr<const Matrix> omat, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den2_(nmat), den3_(kmat), eden_(omat) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 /// 2-index 1-electron derivative overlap
@@ -114,6 +154,7 @@ class GradTask1s : public GradTask {
                const std::shared_ptr<const Matrix> vmat, const std::shared_ptr<const Matrix> kmat, const std::shared_ptr<const Matrix> omat, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den2_(omat), den3_(kmat), eden_(vmat) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 /// 2-index 1-electron finite-nucleus NAI gradient integrals
@@ -126,6 +167,7 @@ class GradTask1f : public GradTask {
                const std::shared_ptr<const Matrix> d, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den_(d) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -141,6 +183,7 @@ class GradTask3r : public GradTask {
                const std::array<std::shared_ptr<const DFDist>,6> rmat, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), rden3_(rmat) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -156,6 +199,7 @@ class GradTask1r : public GradTask {
                const std::array<std::shared_ptr<const Matrix>,6> rmat, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), rden_(rmat) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -171,6 +215,7 @@ class GradTask1rf : public GradTask {
                 const std::array<std::shared_ptr<const Matrix>,6> d, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), rden_(d) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -191,6 +236,7 @@ class GradTask1d : public GradTask {
               const std::array<std::shared_ptr<const Matrix>, 4> den, GradEval_base* p)
       : GradTask(a, o, p), shell_(s), den_(den) { }
     void compute();
+    double cost() const override { return shell_cost(shell_); }
 };
 
 
@@ -23,7 +23,6 @@
 //
 
 
-#include <src/util/math/bessel.h>
 #include <src/util/math/algo.h>
 #include <src/integral/ecp/wigner3j.h>
 #include <src/integral/ecp/angularbatch.h>
@@ -80,24 +79,8 @@ void AngularBatch::map_angular_number() {
 
 }
 
-vector<double> AngularBatch::project_AB(const int l, const vector<double> usp, const vector<double> r) {
-  const static MSphBesselI msbessel;
-
-  vector<vector<double>> rbessel(r.size());
-
-  const int begin0 = basisinfo_[0]->contraction_ranges(cont0_).first;
-  const int end0   = basisinfo_[0]->contraction_ranges(cont0_).second;
-  for (int ir = 0; ir != r.size(); ++ir) {
-    vector<double> bessel(l0_+l+1);
-    for (int i0 = begin0; i0 != end0; ++i0) {
-      const double coef0 = basisinfo_[0]->contractions()[cont0_][i0];
-      const double exp0  = basisinfo_[0]->exponents(i0);
-      const double fac = coef0 * exp(-exp0 * pow(dAB_-r[ir], 2));
-      for (int i = 0; i <= l0_+l; ++i)
-        bessel[i] += fac * msbessel.compute(i, 2.0 * exp0 * dAB_ * r[ir]);
-    }
-    rbessel[ir] = bessel;
-  }
+vector<double> AngularBatch::project_AB(const int l, const vector<double>& usp, const vector<double>& r, const vector<double>& rbessel, const int lmax) {
+  assert(rbessel.size() == r.size()*(lmax+1) && l0_+l <= lmax);
 
   vector<double> out(r.size(), 0.0);
   for (int j = 0; j != usp.size(); ++j) {
@@ -134,7 +117,8 @@ vector<double> AngularBatch::project_AB(const int l, const vector<double> usp, c
                 }
                 smu += zAB_[ld][mu] * sAB;
               }
-              for (int ir = 0; ir != r.size(); ++ir) out[ir] += smu * rbessel[ir][ld] * coeff * pow(r[ir], lk);
+              const double fac = smu * coeff;
+              for (int ir = 0; ir != r.size(); ++ir) out[ir] += fac * rbessel[ir*(lmax+1)+ld] * rpow_[lk*r.size()+ir];
             }
           }
         }
@@ -146,24 +130,8 @@ vector<double> AngularBatch::project_AB(const int l, const vector<double> usp, c
 
 }
 
-vector<double> AngularBatch::project_CB(const int l, const vector<double> usp, const vector<double> r) {
-  const static MSphBesselI msbessel;
-
-  vector<vector<double>> rbessel(r.size());
-
-  const int begin1 = basisinfo_[1]->contraction_ranges(cont1_).first;
-  const int end1   = basisinfo_[1]->contraction_ranges(cont1_).second;
-  for (int ir = 0; ir != r.size(); ++ir) {
-    vector<double> bessel(l1_+l+1);
-    for (int i1 = begin1; i1 != end1; ++i1) {
-      const double coef1 = basisinfo_[1]->contractions()[cont1_][i1];
-      const double exp1  = basisinfo_[1]->exponents(i1);
-      const double fac = coef1 * exp(-exp1 * pow(dCB_-r[ir], 2));
-      for (int i = 0; i <= l1_+l; ++i)
-        bessel[i] += fac * msbessel.compute(i, 2.0 * exp1 * dCB_ * r[ir]);
-    }
-    rbessel[ir] = bessel;
-  }
+vector<double> AngularBatch::project_CB(const int l, const vector<double>& usp, const vector<double>& r, const vector<double>& rbessel, const int lmax) {
+  assert(rbessel.size() == r.size()*(lmax+1) && l1_+l <= lmax);
 
   vector<double> out(r.size(), 0.0);
   for (int j = 0; j != usp.size(); ++j) {
@@ -200,7 +168,8 @@ vector<double> AngularBatch::project_CB(const int l, const vector<double> usp, c
                 }
                 smu += zCB_[ld][mu] * sCB;
               }
-              for (int ir = 0; ir != r.size(); ++ir) out[ir] += smu * rbessel[ir][ld] * coeff * pow(r[ir], lk);
+              const double fac = smu * coeff;
+              for (int ir = 0; ir != r.size(); ++ir) out[ir] += fac * rbessel[ir*(lmax+1)+ld] * rpow_[lk*r.size()+ir];
             }
           }
         }
@@ -217,13 +186,29 @@ vector<double> AngularBatch::compute(const vector<double> r) {
   vector<shared_ptr<const Shell_ECP>> shells_ecp = ecp_->shells_ecp();
   vector<double> out(r.size(), 0.0);
 
+  // the Bessel functions and powers of r are shared by all the channels
+  int lecp = 0;
+  for (auto& ishecp : shells_ecp)
+    if (ishecp->angular_number() != ecp_->ecp_maxl())
+      lecp = max(lecp, ishecp->angular_number());
+  const int lmaxA = l0_ + lecp;
+  const int lmaxC = l1_ + lecp;
+  const vector<double> besselA = contracted_bessel(basisinfo_[0], cont0_, dAB_, lmaxA, r);
+  const vector<double> besselC = contracted_bessel(basisinfo_[1], cont1_, dCB_, lmaxC, r);
+  rpow_.resize((max(l0_, l1_)+1) * r.size());
+  for (int ir = 0; ir != r.size(); ++ir) {
+    rpow_[ir] = 1.0;
+    for (int k = 1; k <= max(l0_, l1_); ++k)
+      rpow_[k*r.size()+ir] = rpow_[(k-1)*r.size()+ir] * r[ir];
+  }
+
   for (auto& ishecp : shells_ecp) {
     const int l = ishecp->angular_number();
     if (l != ecp_->ecp_maxl()) {
       for (int m = 0; m <= 2*l; ++m) {
         const vector<double> usp = sphusplist.sphuspfunc_call(l, m-l);
-        vector<double> pA = project_AB(l, usp, r);
-        vector<double> pC = project_CB(l, usp, r);
+        vector<double> pA = project_AB(l, usp, r, besselA, lmaxA);
+        vector<double> pC = project_CB(l, usp, r, besselC, lmaxC);
         for (int i = 0; i != ishecp->ecp_exponents().size(); ++i)
           if (ishecp->ecp_coefficients(i) != 0) {
             const double coeff = 16.0 * pi__ * pi__ * ishecp->ecp_coefficients(i);
@@ -47,12 +47,15 @@ class AngularBatch : public RadialInt {
 
     int l0_, l1_;
     std::vector<std::vector<double>> zAB_, zCB_;
+    // powers of r on the current grid, [k][r]
+    std::vector<double> rpow_;
 
     void map_angular_number();
 
     double integrate3SHs(std::array<std::pair<int, int>, 3> lm) const;
-    std::vector<double> project_AB(const int l, const std::vector<double> usp, const std::vector<double> r);
-    std::vector<double> project_CB(const int l, const std::vector<double> usp, const std::vector<double> r);
+    // rbessel is the output of contracted_bessel, which is computed once for all the ECP channels
+    std::vector<double> project_AB(const int l, const std::vector<double>& usp, const std::vector<double>& r, const std::vector<double>& rbessel, const int lmax);
+    std::vector<double> project_CB(const int l, const std::vector<double>& usp, const std::vector<double>& r, const std::vector<double>& rbessel, const int lmax);
 
   public:
     AngularBatch(const std::shared_ptr<const ECP> _ecp, const std::array<std::shared_ptr<const Shell>,2>& _info,
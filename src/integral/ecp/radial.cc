@@ -23,6 +23,7 @@
 //
 
 
+#include <src/util/math/bessel.h>
 #include <src/integral/ecp/radial.h>
 
 using namespace bagel;
@@ -33,49 +34,23 @@ void RadialInt::integrate() {
 
   integral_.resize(nc_);
 
-  int n0 = 31;
-  vector<int> sigma1(n0);
-//transform_Becke(n0);
-  transform_Ahlrichs(n0);
-  assert(r_.size() == n0);
+  // the error is estimated with the embedded grid, whose points are the odd ones of the current grid
+  int n = 63;
+  transform_Ahlrichs(n);
+  const vector<double> wprev = w_;
+  n = 2*n+1;
+  transform_Ahlrichs(n);
   vector<double> f = compute(r_);
-  assert(f.size() == n0*nc_);
-  for (int i = 0; i != n0; ++i) sigma1[i] = i;
+  assert(f.size() == n*nc_);
 
   vector<double> previous(nc_, 0.0);
   for (int ic = 0; ic != nc_; ++ic)
-    for (int i = 0; i != n0; ++i) previous[ic] = f[ic*n0+i] * w_[i];
-    //previous[ic] = inner_product(f.begin()+ic*n0, f.begin()+(ic+1)*n0-1, w_.begin(), 0);
-
-  int n1 = n0*2+1;
+    for (int i = 0; i != n/2; ++i) previous[ic] += f[ic*n+2*i+1] * wprev[i];
 
   for (int iter = 1; iter != max_iter_; ++iter) {
-//  transform_Becke(n1); // Very slow!
-//  transform_Log(n1, 3); //TODO: to be checked
-    transform_Ahlrichs(n1);
-
-    vector<int> sigma0(sigma1);
-    sigma1.resize(n1);
-    f.resize(n1*nc_);
-    for (int ic = nc_-1; ic > 0; --ic)
-      for (int i = 0; i < n0; ++i) f[ic*n1+i] = f[ic*n0+i];
-
-    vector<double> rr(n0+1);
-    for (int i = 0; i != n0; ++i) {
-      sigma1[i] = sigma0[i]*2+1;
-      sigma1[n0+i] = 2*i;
-      rr[i] = r_[2*i];
-    }
-    sigma1[2*n0] = 2*n0;
-    rr[n0] = r_[2*n0];
-
-    vector<double> tmp = compute(rr);
-    for (int ic = 0; ic != nc_; ++ic)
-      for (int i = 0; i <= n0; ++i) f[ic*n1+n0+i] = tmp[ic*(n0+1)+i];
-
     vector<double> ans(nc_, 0.0);
     for (int ic = 0; ic != nc_; ++ic)
-      for (int i = 0; i != n1; ++i) ans[ic] += f[ic*n1+i] * w_[sigma1[i]];
+      for (int i = 0; i != n; ++i) ans[ic] += f[ic*n+i] * w_[i];
 
     vector<double> error(nc_, 0.0);
     double maxerror = 0.0;
@@ -84,7 +59,7 @@ void RadialInt::integrate() {
       if (error[ic] > maxerror) maxerror = error[ic];
     }
     if (print_intermediate_) {
-       cout << "Iter = " << setw(5) << iter << setw(10) << "npts = " << setw(10) << n1 << endl;
+       cout << "Iter = " << setw(5) << iter << setw(10) << "npts = " << setw(10) << n << endl;
        for (int ic = 0; ic != nc_; ++ic)
          cout << setw(10) << "ans[" << ic << "] = " << setw(20) << setprecision(12) << ans[ic]
               << setw(10) << "err[" << ic << "] = " << setw(20) << setprecision(12) << error[ic] << endl;
@@ -104,13 +79,44 @@ void RadialInt::integrate() {
     } else if (iter == max_iter_-1) {
       throw runtime_error("Max iteration exceeded in ecp/radial...");
     }
-    for (int ic = 0; ic != nc_; ++ic) previous[ic] = ans[ic];
-    x_.clear();
-    w_.clear();
-    r_.clear();
-    n0 = n1;
-    n1 = 2*n1+1;
+    previous = ans;
+
+    // the new points are the even ones of the refined grid
+    const int n1 = 2*n+1;
+    transform_Ahlrichs(n1);
+    vector<double> rr(n+1);
+    for (int i = 0; i <= n; ++i) rr[i] = r_[2*i];
+    const vector<double> tmp = compute(rr);
+
+    vector<double> f1(n1*nc_);
+    for (int ic = 0; ic != nc_; ++ic) {
+      for (int i = 0; i != n; ++i) f1[ic*n1+2*i+1] = f[ic*n+i];
+      for (int i = 0; i <= n; ++i) f1[ic*n1+2*i] = tmp[ic*(n+1)+i];
+    }
+    f = move(f1);
+    n = n1;
+  }
+}
+
+
+vector<double> RadialInt::contracted_bessel(shared_ptr<const Shell> shell, const int cont, const double d, const int lmax, const vector<double>& r) {
+  const static MSphBesselITable msbessel;
+
+  const int begin = shell->contraction_ranges(cont).first;
+  const int end   = shell->contraction_ranges(cont).second;
+  vector<double> out(r.size()*(lmax+1), 0.0);
+  vector<double> tmp(lmax+1);
+  for (int ir = 0; ir != r.size(); ++ir) {
+    double* const target = out.data() + ir*(lmax+1);
+    for (int i = begin; i != end; ++i) {
+      const double expi = shell->exponents(i);
+      const double fac = shell->contractions()[cont][i] * exp(-expi * (d-r[ir]) * (d-r[ir]));
+      msbessel.compute(lmax, 2.0 * expi * d * r[ir], tmp.data());
+      for (int l = 0; l <= lmax; ++l)
+        target[l] += fac * tmp[l];
+    }
   }
+  return out;
 }
 
 void RadialInt::transform_Log(const int ngrid, const int m) { // Mura and Knowles JCP, 104, 9848.
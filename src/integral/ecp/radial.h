@@ -32,6 +32,7 @@
 #include <iomanip>
 #include <src/util/constants.h>
 #include <src/util/timer.h>
+#include <src/molecule/shell.h>
 
 namespace bagel {
 
@@ -45,6 +46,10 @@ class RadialInt {
     std::vector<double> x_, w_, r_;
     std::vector<double> integral_;
 
+    // sum over the primitives of a contracted function, c exp(-a(d-r)^2) e^{-2adr} i_l(2adr), for all l <= lmax; stored as [r][l]
+    static std::vector<double> contracted_bessel(std::shared_ptr<const Shell> shell, const int cont, const double d, const int lmax,
+                                                 const std::vector<double>& r);
+
   public:
     RadialInt(const int nc = 1, const bool print = false, const int max_iter = 100, const double thresh_int = PRIM_SCREEN_THRESH) :
       nc_(nc),
@@ -55,6 +60,8 @@ class RadialInt {
 
     ~RadialInt() {}
 
+    // The integrand is evaluated on a 127-point grid at once, and the error is estimated from the embedded 63-point grid.
+    // Only when it is not converged, the grid is refined by adding points between the existing ones.
     void integrate();
     std::vector<double> integral() const { return integral_; }
     double integral(const int ic = 0) const { return integral_.at(ic); }
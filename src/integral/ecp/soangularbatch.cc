@@ -23,7 +23,6 @@
 //
 
 
-#include <src/util/math/bessel.h>
 #include <src/util/math/algo.h>
 #include <src/integral/ecp/soangularbatch.h>
 #include <src/integral/ecp/sphusplist.h>
@@ -192,38 +191,10 @@ double SOBatch::angularC(const int h, const int ld, const vector<double> usp) {
 
 }
 
-vector<double> SOBatch::project(const int l, const vector<double> r) {
-
-  const static MSphBesselI msbessel;
-  vector<vector<double>> rbessel0(r.size()), rbessel1(r.size());
-
-  const int begin0 = basisinfo_[0]->contraction_ranges(cont0_).first;
-  const int end0   = basisinfo_[0]->contraction_ranges(cont0_).second;
-
-  const int begin1 = basisinfo_[1]->contraction_ranges(cont1_).first;
-  const int end1   = basisinfo_[1]->contraction_ranges(cont1_).second;
-
-  for (int ir = 0; ir != r.size(); ++ir) {
-    vector<double> b0(l0_+l+1, 0.0);
-    for (int i0 = begin0; i0 != end0; ++i0) {
-      const double coef0 = basisinfo_[0]->contractions()[cont0_][i0];
-      const double exp0 = basisinfo_[0]->exponents(i0);
-      const double fac0 = coef0 * exp(-exp0 * pow(dAB_-r[ir], 2));
-      for (int i = 0; i <= l0_+l; ++i)
-        b0[i] += fac0 * msbessel.compute(i, 2.0*exp0*dAB_*r[ir]);
-    }
-    rbessel0[ir] = b0;
-
-    vector<double> b1(l1_+l+1, 0.0);
-    for (int i1 = begin1; i1 != end1; ++i1) {
-      const double coef1 = basisinfo_[1]->contractions()[cont1_][i1];
-      const double exp1 = basisinfo_[1]->exponents(i1);
-      const double fac1 = coef1 * exp(-exp1 * pow(dCB_-r[ir], 2));
-      for (int i = 0; i <= l1_+l; ++i)
-        b1[i] += fac1 * msbessel.compute(i, 2.0*exp1*dCB_*r[ir]);
-    }
-    rbessel1[ir] = b1;
-  }
+vector<double> SOBatch::project(const int l, const vector<double>& r, const vector<double>& rbessel0, const vector<double>& rbessel1, const int lmax) {
+  assert(rbessel0.size() == r.size()*(l0_+lmax+1) && rbessel1.size() == r.size()*(l1_+lmax+1) && l <= lmax);
+  const int stride0 = l0_+lmax+1;
+  const int stride1 = l1_+lmax+1;
 
   vector<vector<double>> usp(2*l+1);
   for (int m = 0; m <= 2*l; ++m) usp[m] = sphusplist.sphuspfunc_call(l, m-l);
@@ -252,7 +223,7 @@ vector<double> SOBatch::project(const int l, const vector<double> r) {
             sum[id] += (angularA(h, ld0, usp[m0]) * angularC(g-h, ld1, usp[m1]) - angularA(h, ld0, usp[m1]) * angularC(g-h, ld1, usp[m0]))*f;
         }
         for (int ir = 0; ir != r.size(); ++ir) {
-          const double p = rbessel0[ir][ld0] * rbessel1[ir][ld1] * pow(r[ir], g);
+          const double p = rbessel0[ir*stride0+ld0] * rbessel1[ir*stride1+ld1] * pow(r[ir], g);
           for (int id = 0; id != 3; ++id) {
             const int index = id*r.size() + ir;
             out[index] += sum[id] * p;
@@ -272,9 +243,16 @@ vector<double> SOBatch::compute(const vector<double> r) {
   vector<shared_ptr<const Shell_ECP>> shells_so = so_->shells_so();
   vector<double> out(3*r.size(), 0.0);
 
+  // the Bessel functions are shared by all the channels
+  int lmax = 0;
+  for (auto& ishso : shells_so)
+    lmax = max(lmax, ishso->angular_number());
+  const vector<double> bessel0 = contracted_bessel(basisinfo_[0], cont0_, dAB_, l0_+lmax, r);
+  const vector<double> bessel1 = contracted_bessel(basisinfo_[1], cont1_, dCB_, l1_+lmax, r);
+
   for (auto& ishso : shells_so) {
     const int l = ishso->angular_number();
-    vector<double> p = project(l, r);
+    vector<double> p = project(l, r, bessel0, bessel1, lmax);
     for (int i = 0; i != ishso->ecp_exponents().size(); ++i)
       if (ishso->ecp_coefficients(i) != 0) {
         const double ecpcoeff = 16.0 * pi__ * pi__ * ishso->ecp_coefficients(i); // 2/(2l+1) not needed for Stuggart basis sets
@@ -53,7 +53,9 @@ class SOBatch : public RadialInt {
     std::complex<double> theta(const int m) const;
 
     std::array<double, 3> fm0lm1(const int l, const int m0, const int m1) const;
-    std::vector<double> project(const int l, const std::vector<double> r);
+    // rbessel0 and rbessel1 are the outputs of contracted_bessel up to l0_+lmax and l1_+lmax, computed once for all the channels
+    std::vector<double> project(const int l, const std::vector<double>& r, const std::vector<double>& rbessel0, const std::vector<double>& rbessel1,
+                                const int lmax);
     double angularA(const int h, const int ld, const std::vector<double> usp);
     double angularC(const int h, const int ld, const std::vector<double> usp);
 
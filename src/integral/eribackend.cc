@@ -0,0 +1,195 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: eribackend.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <src/global.h>
+#include <src/integral/eribackend.h>
+#include <src/util/constants.h>
+#include <src/util/parallel/mpi_interface.h>
+
+using namespace std;
+using namespace bagel;
+
+namespace {
+  // angular momenta run from -1 (dummy shell) to ANG_HRR_END; contractions are bucketed by log2 of the number of primitive quartets
+  constexpr int nang = ANG_HRR_END + 2;
+  constexpr int ndepth = 16;
+  const string kernel_name[2] = {"eri", "grad"};
+}
+
+
+ERIBackend::ERIBackend() : table_(new atomic<signed char>[size()]), file_(getenv_multiple("BAGEL_INTEGRAL_TABLE")),
+                           calibrate_(!getenv_multiple("BAGEL_INTEGRAL_CALIBRATE").empty()) {
+  // timings differ among processes, which would then use different kernels for the same class
+  if (calibrate_ && mpi__->size() > 1) {
+    cout << "  * BAGEL_INTEGRAL_CALIBRATE is ignored in runs with more than one process" << endl;
+    calibrate_ = false;
+  }
+  for (size_t i = 0; i != size(); ++i)
+    table_[i] = calibrate_ ? -1 : 1;
+  load();
+}
+
+
+size_t ERIBackend::size() {
+  return 2 * nang * nang * nang * nang * ndepth;
+}
+
+
+size_t ERIBackend::index(const Kernel k, const array<int,4>& angular, const int depth) {
+  size_t out = static_cast<int>(k);
+  for (auto& i : angular) {
+    if (i < -1 || i > ANG_HRR_END)
+      throw runtime_error("angular momentum out of range in ERIBackend");
+    out = out * nang + i + 1;
+  }
+  return out * ndepth + min(max(depth, 0), ndepth-1);
+}
+
+
+size_t ERIBackend::index(const Kernel k, const array<shared_ptr<const Shell>,4>& shells) {
+  array<int,4> angular;
+  size_t nprim = 1;
+  for (int i = 0; i != 4; ++i) {
+    angular[i] = shells[i]->dummy() ? -1 : shells[i]->angular_number();
+    nprim *= shells[i]->num_primitive();
+  }
+  int depth = 0;
+  while (nprim >>= 1)
+    ++depth;
+  return index(k, angular, depth);
+}
+
+
+bool ERIBackend::use_libint(const Kernel k, const array<shared_ptr<const Shell>,4>& shells) {
+  const size_t key = index(k, shells);
+  const signed char choice = table_[key].load(memory_order_relaxed);
+  if (choice >= 0)
+    return choice;
+
+  // threads may time the same class concurrently; the first result is kept
+  signed char expected = -1;
+  if (table_[key].compare_exchange_strong(expected, calibrate(k, shells)))
+    save(key);
+  return table_[key].load();
+}
+
+
+bool ERIBackend::calibrate(const Kernel k, const array<shared_ptr<const Shell>,4>& shells) const {
+#ifdef LIBINT_INTERFACE
+  auto time = [](function<void()> f) {
+    auto best = chrono::duration<double>::max();
+    for (int i = 0; i != 3; ++i) {
+      auto start = chrono::steady_clock::now();
+      f();
+      best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start));
+    }
+    return best.count();
+  };
+  double rys, libint;
+  if (k == Kernel::ERI) {
+    rys    = time([&]() { ERIBatch eri(shells, 2.0); eri.compute(); });
+    libint = time([&]() { Libint eri(shells); eri.compute(); });
+  } else {
+    rys    = time([&]() { GradBatch eri(shells, 0.0); eri.compute(); });
+    libint = time([&]() { GLibint eri(shells); eri.compute(); });
+  }
+  return libint < rys;
+#else
+  return false;
+#endif
+}
+
+
+void ERIBackend::load() {
+  if (file_.empty())
+    return;
+  ifstream fs(file_);
+  string line;
+  while (getline(fs, line)) {
+    istringstream ss(line);
+    string kernel, backend;
+    array<int,4> angular;
+    int depth;
+    if (!(ss >> kernel >> angular[0] >> angular[1] >> angular[2] >> angular[3] >> depth >> backend))
+      continue;
+    if (kernel != kernel_name[0] && kernel != kernel_name[1])
+      throw runtime_error("unknown kernel " + kernel + " in " + file_);
+    if (backend != "rys" && backend != "libint")
+      throw runtime_error("unknown integral backend " + backend + " in " + file_);
+#ifdef LIBINT_INTERFACE
+    table_[index(kernel == kernel_name[0] ? Kernel::ERI : Kernel::Gradient, angular, depth)] = backend == "libint";
+#else
+    table_[index(kernel == kernel_name[0] ? Kernel::ERI : Kernel::Gradient, angular, depth)] = 0;
+#endif
+  }
+}
+
+
+void ERIBackend::save(const size_t key) {
+  if (file_.empty())
+    return;
+  size_t rest = key;
+  const int depth = rest % ndepth;
+  rest /= ndepth;
+  array<int,4> angular;
+  for (int i = 3; i >= 0; --i) {
+    angular[i] = rest % nang - 1;
+    rest /= nang;
+  }
+  lock_guard<mutex> lock(mutex_);
+  ofstream fs(file_, ios::app);
+  fs << kernel_name[rest] << " " << angular[0] << " " << angular[1] << " " << angular[2] << " " << angular[3] << " " << depth
+     << " " << (table_[key] ? "libint" : "rys") << endl;
+}
+
+
+bool bagel::eri_use_libint(const ERIBackend::Kernel k, const array<shared_ptr<const Shell>,4>& shells) {
+#ifdef LIBINT_INTERFACE
+  static ERIBackend backend;
+  return backend.use_libint(k, shells);
+#else
+  return false;
+#endif
+}
+
+
+shared_ptr<RysInt> bagel::make_eribatch(const array<shared_ptr<const Shell>,4>& shells, const double max_density, shared_ptr<StackMem> stack) {
+#ifdef LIBINT_INTERFACE
+  if (eri_use_libint(ERIBackend::Kernel::ERI, shells))
+    return make_shared<Libint>(shells, max_density, stack);
+#endif
+  return make_shared<ERIBatch>(shells, max_density, 0.0, true, stack);
+}
+
+
+shared_ptr<RysInt> bagel::make_gradbatch(const array<shared_ptr<const Shell>,4>& shells, const double max_density, shared_ptr<StackMem> stack) {
+#ifdef LIBINT_INTERFACE
+  if (eri_use_libint(ERIBackend::Kernel::Gradient, shells))
+    return make_shared<GLibint>(shells, stack);
+#endif
+  return make_shared<GradBatch>(shells, max_density, 0.0, true, stack);
+}
@@ -0,0 +1,148 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: eribackend.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __SRC_INTEGRAL_ERIBACKEND_H
+#define __SRC_INTEGRAL_ERIBACKEND_H
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <bagel_config.h>
+#include <src/integral/rys/eribatch.h>
+#include <src/integral/rys/gradbatch.h>
+#ifdef LIBINT_INTERFACE
+  #include <src/integral/libint/libint.h>
+  #include <src/integral/libint/glibint.h>
+#endif
+
+namespace bagel {
+
+// Runtime choice between the Rys quadrature (ERIBatch, GradBatch) and libint (Libint, GLibint).
+// Without LIBINT_INTERFACE the Rys quadrature is always used. Otherwise libint is used unless the file named by
+// BAGEL_INTEGRAL_TABLE selects the Rys quadrature for a class (la lb|lc ld) with a given contraction depth, so that
+// all processes make the same choice. If BAGEL_INTEGRAL_CALIBRATE is set in a single-process run, the classes that are
+// not in the table are timed with both kernels the first time they are requested, and the faster one is used and appended to the table.
+class ERIBackend {
+  public:
+    enum class Kernel { ERI = 0, Gradient = 1 };
+
+  protected:
+    // -1: to be calibrated; 0: Rys; 1: libint
+    std::unique_ptr<std::atomic<signed char>[]> table_;
+    std::string file_;
+    bool calibrate_;
+    // serializes the appends to file_
+    std::mutex mutex_;
+
+    static size_t index(const Kernel k, const std::array<int,4>& angular, const int depth);
+    static size_t index(const Kernel k, const std::array<std::shared_ptr<const Shell>,4>& shells);
+    static size_t size();
+
+    bool calibrate(const Kernel k, const std::array<std::shared_ptr<const Shell>,4>& shells) const;
+    void load();
+    void save(const size_t key);
+
+  public:
+    ERIBackend();
+
+    bool use_libint(const Kernel k, const std::array<std::shared_ptr<const Shell>,4>& shells);
+};
+
+// true if libint is chosen for the class of these shells; always false without LIBINT_INTERFACE
+bool eri_use_libint(const ERIBackend::Kernel k, const std::array<std::shared_ptr<const Shell>,4>& shells);
+
+// batches of ERIs and their nuclear derivatives computed with the backend that is chosen for the class, for callers that keep the batch.
+// The dummy arguments of ERIBatch and GradBatch are not needed here.
+std::shared_ptr<RysInt> make_eribatch(const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density,
+                                      std::shared_ptr<StackMem> stack = nullptr);
+std::shared_ptr<RysInt> make_gradbatch(const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density,
+                                       std::shared_ptr<StackMem> stack = nullptr);
+
+
+inline RysInt* construct_batch(void* p, ERIBatch*, const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density, std::shared_ptr<StackMem> stack) {
+  return new (p) ERIBatch(shells, max_density, 0.0, true, stack);
+}
+inline RysInt* construct_batch(void* p, GradBatch*, const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density, std::shared_ptr<StackMem> stack) {
+  return new (p) GradBatch(shells, max_density, 0.0, true, stack);
+}
+#ifdef LIBINT_INTERFACE
+inline RysInt* construct_batch(void* p, Libint*, const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density, std::shared_ptr<StackMem> stack) {
+  return new (p) Libint(shells, max_density, stack);
+}
+inline RysInt* construct_batch(void* p, GLibint*, const std::array<std::shared_ptr<const Shell>,4>& shells, const double, std::shared_ptr<StackMem> stack) {
+  return new (p) GLibint(shells, stack);
+}
+#endif
+
+// Batch computed with the backend chosen for its class. It is constructed in place, so that no heap allocation is made per quartet.
+// Drop-in replacement of ERIBatch in the templated DF code (e.g., DFDist_ints<AutoERIBatch>); the underlying batch is accessed with ->.
+template<class RysType, class LibintType, ERIBackend::Kernel K>
+class AutoBatch_ {
+  protected:
+    typename std::aligned_storage<(sizeof(RysType) > sizeof(LibintType) ? sizeof(RysType) : sizeof(LibintType)),
+                                  (alignof(RysType) > alignof(LibintType) ? alignof(RysType) : alignof(LibintType))>::type storage_;
+    const bool libint_;
+    RysInt* batch_;
+
+  public:
+    AutoBatch_(const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density, std::shared_ptr<StackMem> stack = nullptr)
+      : libint_(!std::is_same<RysType, LibintType>::value && eri_use_libint(K, shells)) {
+      batch_ = libint_ ? construct_batch(&storage_, static_cast<LibintType*>(nullptr), shells, max_density, stack)
+                       : construct_batch(&storage_, static_cast<RysType*>(nullptr), shells, max_density, stack);
+    }
+    AutoBatch_(const AutoBatch_&) = delete;
+    AutoBatch_& operator=(const AutoBatch_&) = delete;
+
+    ~AutoBatch_() {
+      if (libint_)
+        static_cast<LibintType*>(batch_)->~LibintType();
+      else
+        static_cast<RysType*>(batch_)->~RysType();
+    }
+
+    void compute() { batch_->compute(); }
+
+    double* data(const int i) { return batch_->data(i); }
+    const double* data() const { return batch_->data(); }
+    size_t data_size() const { return batch_->data_size(); }
+
+    RysInt* operator->() { return batch_; }
+    RysInt& operator*() { return *batch_; }
+
+    constexpr static int Nblocks() { return 1; }
+};
+
+#ifdef LIBINT_INTERFACE
+using AutoERIBatch  = AutoBatch_<ERIBatch, Libint, ERIBackend::Kernel::ERI>;
+using AutoGradBatch = AutoBatch_<GradBatch, GLibint, ERIBackend::Kernel::Gradient>;
+#else
+using AutoERIBatch  = AutoBatch_<ERIBatch, ERIBatch, ERIBackend::Kernel::ERI>;
+using AutoGradBatch = AutoBatch_<GradBatch, GradBatch, ERIBackend::Kernel::Gradient>;
+#endif
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: classbatch.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <src/integral/rys/classbatch.h>
+#include <src/integral/rys/erirootlist.h>
+
+using namespace std;
+using namespace bagel;
+
+template <typename TBatch>
+ClassBatch<TBatch>::ClassBatch(const vector<array<shared_ptr<const Shell>,4>>& quartets, const double max_density) : stack_(resources__->get()) {
+  batch_.reserve(quartets.size());
+  for (auto& i : quartets)
+    batch_.push_back(make_shared<TBatch>(i, max_density, 0.0, true, stack_, true));
+  if (!batch_.empty())
+    root_weight();
+}
+
+
+template <typename TBatch>
+ClassBatch<TBatch>::~ClassBatch() {
+  // the batches have to be released from the stack in the reverse order
+  while (!batch_.empty())
+    batch_.pop_back();
+  resources__->release(stack_);
+}
+
+
+template <typename TBatch>
+void ClassBatch<TBatch>::root_weight() {
+  // members are accessed through the base class, of which this class is a friend
+  vector<RysIntegral<double>*> base;
+  for (auto& b : batch_)
+    base.push_back(b.get());
+
+  const int rank = base.front()->rank_;
+  // (ss|ss) does not use the root list
+  if (base.front()->amax_ + base.front()->cmax_ == 0) {
+    for (auto& b : base)
+      b->root_weight(b->primsize_);
+    return;
+  }
+
+  size_t nprim = 0lu;
+  for (auto& b : base) {
+    if (b->rank_ != rank)
+      throw logic_error("ClassBatch requires shell quartets of the same angular-momentum class");
+    nprim += b->screening_size_;
+  }
+  if (nprim == 0) return;
+
+  // only the screened primitive quartets are gathered
+  double* const tt = stack_->get(nprim*(2*rank+1));
+  double* const roots = tt + nprim;
+  double* const weights = roots + nprim*rank;
+  size_t offset = 0lu;
+  for (auto& b : base)
+    for (int j = 0; j != b->screening_size_; ++j)
+      tt[offset++] = b->T_[b->screening_[j]];
+
+  eriroot__.root(rank, tt, roots, weights, static_cast<int>(nprim));
+
+  offset = 0lu;
+  for (auto& b : base)
+    for (int j = 0; j != b->screening_size_; ++j, ++offset) {
+      const int ii = b->screening_[j];
+      copy_n(roots+offset*rank, rank, b->roots_+ii*rank);
+      copy_n(weights+offset*rank, rank, b->weights_+ii*rank);
+    }
+  stack_->release(nprim*(2*rank+1), tt);
+}
+
+
+template <typename TBatch>
+void ClassBatch<TBatch>::compute() {
+  for (auto& b : batch_)
+    b->compute();
+}
+
+
+template <>
+void ClassBatch<ERIBatch>::compute() {
+  if (batch_.empty()) return;
+  // the hand-written kernels for ranks up to 3 are used quartet by quartet
+  const ERIBatch& b0 = *batch_.front();
+  bool same = b0.rank_ >= 4;
+  for (auto& b : batch_)
+    for (int i = 0; i != 4; ++i)
+      same &= b->basisinfo_[i]->angular_number() == b0.basisinfo_[i]->angular_number();
+  if (!same) {
+    for (auto& b : batch_)
+      b->compute();
+    return;
+  }
+
+  vector<ERIBatch*> batch;
+  for (auto& b : batch_) {
+    fill_n(b->data_, b->size_alloc_, 0.0);
+    batch.push_back(b.get());
+  }
+  ERIBatch::perform_VRR_simd(batch);
+  for (auto& b : batch_)
+    b->compute_from_VRR();
+}
+
+
+template class bagel::ClassBatch<ERIBatch>;
+template class bagel::ClassBatch<GradBatch>;
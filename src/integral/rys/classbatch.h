@@ -0,0 +1,62 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: classbatch.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_INTEGRAL_RYS_CLASSBATCH_H
+#define __SRC_INTEGRAL_RYS_CLASSBATCH_H
+
+#include <src/integral/rys/eribatch.h>
+#include <src/integral/rys/gradbatch.h>
+
+namespace bagel {
+
+// Shell quartets of one angular-momentum class evaluated together: the batches share a StackMem,
+// and the Rys roots and weights of all their screened primitive quartets are computed in a single call.
+// For ERIBatch the vectorized VRR also runs over the primitive quartets of all the batches; the contraction and HRR
+// remain per quartet. TBatch is ERIBatch or GradBatch (whose VRR is per quartet).
+template <typename TBatch>
+class ClassBatch {
+  protected:
+    std::shared_ptr<StackMem> stack_;
+    std::vector<std::shared_ptr<TBatch>> batch_;
+
+    void root_weight();
+
+  public:
+    ClassBatch(const std::vector<std::array<std::shared_ptr<const Shell>,4>>& quartets, const double max_density);
+    ~ClassBatch();
+
+    void compute();
+
+    size_t size() const { return batch_.size(); }
+    std::shared_ptr<TBatch> operator[](const size_t i) const { return batch_[i]; }
+};
+
+template <> void ClassBatch<ERIBatch>::compute();
+extern template class ClassBatch<ERIBatch>;
+extern template class ClassBatch<GradBatch>;
+
+}
+
+#endif
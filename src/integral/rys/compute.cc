@@ -34,10 +34,6 @@ static const CarSphList carsphlist;
 static const HRRList hrr;
 
 void ERIBatch::compute() {
-  bool swapped = false;
-
-  double* const stack_save = stack_->get(size_alloc_);
-  bkup_ = stack_save;
   fill_n(data_, size_alloc_, 0.0);
 
   // perform VRR
@@ -49,6 +45,16 @@ void ERIBatch::compute() {
     default: perform_VRR(); break;
   }
 
+  compute_from_VRR();
+}
+
+
+void ERIBatch::compute_from_VRR() {
+  bool swapped = false;
+
+  double* const stack_save = stack_->get(size_alloc_);
+  bkup_ = stack_save;
+
   // contract indices 01
   // data will be stored in bkup_: cont01{ prim23{ xyz{ } } }
   {
@@ -30,16 +30,13 @@ using namespace std;
 using namespace bagel;
 
 ERIBatch::ERIBatch(const array<shared_ptr<const Shell>,4>& _info, const double max_density, const double dummy, const bool dum,
-                   shared_ptr<StackMem> stack) :  ERIBatch_base(_info, 0, 0, stack) {
+                   shared_ptr<StackMem> stack, const bool defer_roots) :  ERIBatch_base(_info, 0, 0, stack) {
 
   const double integral_thresh = (max_density != 0.0) ? (PRIM_SCREEN_THRESH / max_density) : 0.0;
   compute_ssss(integral_thresh);
 
-#ifdef LIBINT_INTERFACE
-  assert(false);
-#endif
-
-  root_weight(this->primsize_);
+  if (!defer_roots)
+    root_weight(this->primsize_);
 }
 
 void ERIBatch::root_weight(const int ps) {
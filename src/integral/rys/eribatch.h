@@ -29,25 +29,39 @@
 
 namespace bagel {
 
+template <typename TBatch> class ClassBatch;
+
 class ERIBatch : public ERIBatch_base {
+  template <typename TBatch> friend class ClassBatch;
 
   protected:
     void perform_VRR();
     void perform_VRR1();
     void perform_VRR2();
     void perform_VRR3();
+    // computes the first multiple of nlane_VRR screened quartets with the vectorized VRR and returns their number
+    int perform_VRR_simd();
+    // the same for all the screened quartets of batches of one class, which are packed into the lanes together
+    static void perform_VRR_simd(const std::vector<ERIBatch*>& batches);
+    // the vectorized VRR for the primitive quartets prim[l] of batch[l], with the results written to out[l]
+    static void perform_VRR_lanes(const ERIBatch* const* batch, const int* prim, double* const* out, double* buff);
+    size_t simd_buffer_size() const;
+    // contraction, HRR and sorting of the VRR intermediates in data_
+    void compute_from_VRR();
     void root_weight(const int ps) override;
 
   public:
 
-    // dummy will never be used.
+    // dummy will never be used. If defer_roots is true, the roots and weights are left to the caller (see ClassBatch).
     ERIBatch(const std::array<std::shared_ptr<const Shell>,4>&, const double max_density, const double dummy = 0.0, const bool dum = true,
-             std::shared_ptr<StackMem> stack = nullptr);
+             std::shared_ptr<StackMem> stack = nullptr, const bool defer_roots = false);
 
     /// compute a batch of integrals
     void compute() override;
 
     constexpr static int Nblocks() { return 1; }
+    // number of primitive quartets processed together by perform_VRR_simd
+    constexpr static int nlane_VRR = 8;
 };
 
 }
@@ -40,7 +40,7 @@ using namespace std;
 using namespace bagel;
 
 GradBatch::GradBatch(const array<shared_ptr<const Shell>,4>& shells, const double max_density, const double dummy, const bool dum,
-                     shared_ptr<StackMem> stack)
+                     shared_ptr<StackMem> stack, const bool defer_roots)
  : ERIBatch_base(shells, 1, 0, stack) {
 
   const double integral_thresh = (max_density != 0.0) ? (PRIM_SCREEN_THRESH / max_density) : 0.0;
@@ -51,7 +51,8 @@ GradBatch::GradBatch(const array<shared_ptr<const Shell>,4>& shells, const doubl
 
   set_exponents();
 
-  root_weight(this->primsize_);
+  if (!defer_roots)
+    root_weight(this->primsize_);
 }
 
 
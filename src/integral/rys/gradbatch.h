@@ -45,7 +45,7 @@ class GradBatch : public ERIBatch_base {
 
   public:
     GradBatch(const std::array<std::shared_ptr<const Shell>,4>& shells, const double max_density, const double dummy = 0.0, const bool dum = true,
-              std::shared_ptr<StackMem> stack = nullptr);
+              std::shared_ptr<StackMem> stack = nullptr, const bool defer_roots = false);
 
     void compute() override;
 
@@ -23,8 +23,7 @@
 //
 
 #include <src/util/alpha.h>
-#include <src/integral/rys/gradbatch.h>
-#include <src/integral/libint/glibint.h>
+#include <src/integral/eribackend.h>
 #include <src/integral/rys/gsmalleribatch.h>
 
 using namespace std;
@@ -109,11 +108,7 @@ void GSmallERIBatch::compute() {
   auto m = [&s0size, &a1](const size_t& i, const size_t& j, const size_t k){ return i+s0size*(j+a1*k); };
 
   {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<GradBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<GLibint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, stack_);
-#endif
+    AutoGradBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, 2.0, stack_);
     eric->compute();
 
     array<int,4> jatom = {{-1, 2, 1, 0}};
@@ -131,11 +126,7 @@ void GSmallERIBatch::compute() {
     }
   }
   if (shells_[1]->aux_decrement() && shells_[2]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<GradBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<GLibint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, stack_);
-#endif
+    AutoGradBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, 2.0, stack_);
     eric->compute();
 
     array<int,4> jatom = {{-1, 2, 1, 0}};
@@ -153,11 +144,7 @@ void GSmallERIBatch::compute() {
     }
   }
   if (shells_[1]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<GradBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<GLibint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, stack_);
-#endif
+    AutoGradBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, 2.0, stack_);
     eric->compute();
 
     array<int,4> jatom = {{-1, 2, 1, 0}};
@@ -175,11 +162,7 @@ void GSmallERIBatch::compute() {
     }
   }
   if (shells_[2]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<GradBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<GLibint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, stack_);
-#endif
+    AutoGradBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, 2.0, stack_);
     eric->compute();
 
     array<int,4> jatom = {{-1, 2, 1, 0}};
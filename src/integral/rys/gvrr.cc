@@ -34,7 +34,6 @@ static const Comb comb;
 
 
 void GradBatch::perform_VRR() {
-#ifndef LIBINT_INTERFACE
   const int a = basisinfo_[0]->angular_number();
   const int b = basisinfo_[1]->angular_number();
   const int c = basisinfo_[2]->angular_number();
@@ -12815,5 +12814,4 @@ void GradBatch::perform_VRR() {
   stack_->release((amax_+1)*a2*b2, transx);
   stack_->release(rank_*isize*3, workx);
 
-#endif
 }
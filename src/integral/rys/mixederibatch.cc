@@ -26,7 +26,7 @@
 #include <iomanip>
 #include <src/integral/carsphlist.h>
 #include <src/integral/rys/mixederibatch.h>
-#include <src/integral/libint/libint.h>
+#include <src/integral/eribackend.h>
 
 using namespace std;
 using namespace bagel;
@@ -97,11 +97,7 @@ void MixedERIBatch::eri_compute(double* eri) const {
   {
     shared_ptr<const Shell> cart2 = shells_[2]->cartesian_shell();
     const int s2cart = cart2->nbasis();
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), cart2}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), cart2}}, 2.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), cart2}}, 2.0, stack_);
     eric->compute();
 
     double* tmp = stack_->get(s0size*a1size_inc*s2cart);
@@ -127,12 +123,7 @@ void MixedERIBatch::eri_compute(double* eri) const {
   if (shells_[1]->aux_decrement()) {
     shared_ptr<const Shell> cart2 = shells_[2]->cartesian_shell();
     const int s2cart = cart2->nbasis();
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), cart2}},
-                                      2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), cart2}}, 2.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), cart2}}, 2.0, stack_);
     eric->compute();
 
     double* tmp = stack_->get(s0size*a1size_dec*s2cart);
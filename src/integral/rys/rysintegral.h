@@ -36,8 +36,12 @@
 
 namespace bagel {
 
+template <typename TBatch> class ClassBatch;
+
 template <typename DataType, Int_t IntType = Int_t::Standard>
 class RysIntegral : public Integral_base<DataType> {
+  template <typename TBatch> friend class ClassBatch;
+
   protected:
     // some basic info for integral evaluations
     bool swap01_, swap23_;
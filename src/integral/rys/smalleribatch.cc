@@ -23,7 +23,7 @@
 //
 
 
-#include <src/integral/libint/libint.h>
+#include <src/integral/eribackend.h>
 #include <src/integral/rys/smalleribatch.h>
 
 using namespace std;
@@ -98,41 +98,25 @@ void SmallERIBatch::eri_compute(double* eri) const {
   auto m = [&s0size, &a1](const size_t& i, const size_t& j, const size_t k){ return i+s0size*(j+a1*k); };
 
   {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, 0.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_increment()}}, 2.0, stack_);
     eric->compute();
     for (int i = 0; i != a2size_inc; ++i)
       copy_n(eric->data() + i * s0size * a1size_inc, s0size * a1size_inc, eri + m(0,0,i));
   }
   if (shells_[1]->aux_decrement() && shells_[2]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, 0.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_decrement()}}, 2.0, stack_);
     eric->compute();
     for (int i = 0; i != a2size_dec; ++i)
       copy_n(eric->data() + i * s0size * a1size_dec, s0size * a1size_dec, eri + m(0,a1size_inc,a2size_inc+i));
   }
   if (shells_[1]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, 0.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_decrement(), shells_[2]->aux_increment()}}, 2.0, stack_);
     eric->compute();
     for (int i = 0; i != a2size_inc; ++i)
       copy_n(eric->data() + i * s0size * a1size_dec, s0size * a1size_dec, eri + m(0,a1size_inc, i));
   }
   if (shells_[2]->aux_decrement()) {
-#ifndef LIBINT_INTERFACE
-    auto eric = make_shared<ERIBatch>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, 2.0, 0.0, true, stack_);
-#else
-    auto eric = make_shared<Libint>(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, 0.0, stack_);
-#endif
+    AutoERIBatch eric(array<shared_ptr<const Shell>,4>{{dummy, shells_[0], shells_[1]->aux_increment(), shells_[2]->aux_decrement()}}, 2.0, stack_);
     eric->compute();
     for (int i = 0; i != a2size_dec; ++i)
       copy_n(eric->data() + i * s0size * a1size_inc, s0size * a1size_inc, eri + m(0,0,a2size_inc+i));
@@ -37,7 +37,6 @@ using namespace bagel;\n\
 \n\
 \n\
 void ERIBatch::perform_VRR() {\n\
-#ifndef LIBINT_INTERFACE\n\
   const int acsize = asize_ * csize_;\n\
   const int a = basisinfo_[0]->angular_number();\n\
   const int b = basisinfo_[1]->angular_number();\n\
@@ -47,7 +46,9 @@ void ERIBatch::perform_VRR() {\n\
   double* const workx = stack_->get(isize*rank_*3);\n\
   double* const worky = workx + isize*rank_;\n\
   double* const workz = worky + isize*rank_;\n\
-  const int hashkey = (a << 24) + (b << 16) + (c << 8) + d;\n"
+  const int hashkey = (a << 24) + (b << 16) + (c << 8) + d;\n\
+  // groups of primitive quartets are computed by the vectorized kernel; the remainder below\n\
+  const int nvec = perform_VRR_simd();\n"
 
 for a in range(0,8):
  for b in range(0,8):
@@ -67,7 +68,7 @@ for a in range(0,8):
 #ifdef COMPILE_J_ORB\n"
     ss += "\
   case " + str(key) + " :\n\
-    for (int j = 0; j != screening_size_; ++j) {\n\
+    for (int j = nvec; j != screening_size_; ++j) {\n\
       int ii = screening_[j];\n\
       vrr_driver<" + str(a) + "," + str(b) + "," + str(c) + "," +  str(d) + "," + str(rank) + ",double>(data_+ii*acsize, roots_+ii*rank_, weights_+ii*rank_, coeff_[ii],\n\
                     basisinfo_[0]->position(), basisinfo_[1]->position(), basisinfo_[2]->position(), basisinfo_[3]->position(),\n\
@@ -82,7 +83,6 @@ ss += "\
   }\n\
   stack_->release(rank_*isize*3, workx);\n\
 \n\
-#endif\n\
 }"
 
 f = open(filename, "w")
@@ -0,0 +1,260 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: vrr_simd.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <src/integral/rys/eribatch.h>
+
+using namespace std;
+using namespace bagel;
+
+// The kernel below is compiled for AVX-512, AVX2 and the baseline ISA; the loader picks the clone for the running CPU.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__INTEL_COMPILER) && !defined(__clang__)
+#define VRR_TARGET_CLONES __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#else
+#define VRR_TARGET_CLONES
+#endif
+
+namespace {
+
+constexpr int nlane = ERIBatch::nlane_VRR;
+
+// one value per primitive quartet; the compiler maps it onto one AVX-512, two AVX2 or four SSE2 registers.
+// Alignment is lowered so that the buffers from StackMem can be accessed directly.
+typedef double vdouble __attribute__((vector_size(nlane*sizeof(double)), aligned(sizeof(double))));
+
+// VRR for nlane primitive quartets at once. Every array is laid out as [...][root][lane], i.e., as vectors over lanes.
+// Angular momenta are runtime arguments, since the vector width comes from the lanes. The lanes may belong to different
+// shell quartets of the same class, hence the centers A and C are given per lane as well.
+VRR_TARGET_CLONES
+void vrr_lanes(const int amax, const int cmax, const int amin, const int cmin, const int rank,
+               const double* const roots, const double* const weights, const double* const coeff,
+               const double* const A, const double* const C,
+               const double* const P, const double* const Q, const double* const xp, const double* const xq,
+               const int* const amap, const int* const cmap, const int asize, double* const* const out, double* const work) {
+
+  const int amax1 = amax+1;
+  const int cmax1 = cmax+1;
+  const int isize = amax1 * cmax1;
+
+  const vdouble* const vroots = reinterpret_cast<const vdouble*>(roots);
+  vdouble* const workx = reinterpret_cast<vdouble*>(work);
+  vdouble* const worky = workx + isize*rank;
+  vdouble* const workz = worky + isize*rank;
+  vdouble* const C00 = workz + isize*rank;
+  vdouble* const D00 = C00 + rank;
+  vdouble* const B00 = D00 + rank;
+  vdouble* const B10 = B00 + rank;
+  vdouble* const B01 = B10 + rank;
+  vdouble* const iyiz = B01 + rank;
+
+  const vdouble vxp = *reinterpret_cast<const vdouble*>(xp);
+  const vdouble vxq = *reinterpret_cast<const vdouble*>(xq);
+  const vdouble opq = 1.0 / (vxp + vxq);
+  const vdouble oxp2 = 0.5 / vxp;
+  const vdouble oxq2 = 0.5 / vxq;
+  const vdouble xqopq = vxq * opq;
+  const vdouble xpopq = vxp * opq;
+  for (int i = 0; i != rank; ++i) {
+    B00[i] = 0.5 * opq * vroots[i];
+    B10[i] = oxp2 - xqopq * oxp2 * vroots[i];
+    B01[i] = oxq2 - xpopq * oxq2 * vroots[i];
+  }
+
+  vdouble* const work2d[3] = {workx, worky, workz};
+  for (int k = 0; k != 3; ++k) {
+    const vdouble Pk = reinterpret_cast<const vdouble*>(P)[k];
+    const vdouble Qk = reinterpret_cast<const vdouble*>(Q)[k];
+    const vdouble Ak = reinterpret_cast<const vdouble*>(A)[k];
+    const vdouble Ck = reinterpret_cast<const vdouble*>(C)[k];
+    for (int i = 0; i != rank; ++i) {
+      C00[i] = (Pk - Ak) - (Pk - Qk) * xqopq * vroots[i];
+      D00[i] = (Qk - Ck) + (Pk - Qk) * xpopq * vroots[i];
+    }
+
+    // I(a,c) = C00 I(a-1,c) + (a-1) B10 I(a-2,c) + c B00 I(a-1,c-1); I(0,c) = D00 I(0,c-1) + (c-1) B01 I(0,c-2)
+    vdouble* const data = work2d[k];
+    for (int c = 0; c <= cmax; ++c) {
+      vdouble* const cur = data + amax1*c*rank;
+      const vdouble* const prev = data + amax1*(c-1)*rank;
+      const vdouble* const prev2 = data + amax1*(c-2)*rank;
+      for (int i = 0; i != rank; ++i)
+        cur[i] = c == 0 ? vdouble{} + 1.0 : (c == 1 ? D00[i] : D00[i] * prev[i] + (c-1) * B01[i] * prev2[i]);
+      for (int a = 1; a <= amax; ++a) {
+        vdouble* const ca = cur + a*rank;
+        for (int i = 0; i != rank; ++i) {
+          vdouble tmp = C00[i] * ca[i-rank];
+          if (a > 1)
+            tmp += (a-1) * B10[i] * ca[i-2*rank];
+          if (c > 0)
+            tmp += c * B00[i] * prev[(a-1)*rank+i];
+          ca[i] = tmp;
+        }
+      }
+    }
+  }
+
+  // weights and the prefactors are folded into the x component
+  const vdouble vcoeff = *reinterpret_cast<const vdouble*>(coeff);
+  for (int i = 0; i != rank; ++i)
+    iyiz[i] = reinterpret_cast<const vdouble*>(weights)[i] * vcoeff;
+  for (int j = 0; j != isize; ++j)
+    for (int i = 0; i != rank; ++i)
+      workx[j*rank+i] *= iyiz[i];
+
+  for (int iz = 0; iz <= cmax; ++iz) {
+    for (int iy = 0; iy <= cmax - iz; ++iy) {
+      const int iyz = cmax1 * (iy + cmax1 * iz);
+      for (int jz = 0; jz <= amax; ++jz) {
+        const int offsetz = rank * (amax1 * iz + jz);
+        for (int jy = 0; jy <= amax - jz; ++jy) {
+          const int offsety = rank * (amax1 * iy + jy);
+          const int jyz = amax1 * (jy + amax1 * jz);
+          for (int i = 0; i != rank; ++i)
+            iyiz[i] = worky[offsety + i] * workz[offsetz + i];
+          for (int ix = max(0, cmin - iy - iz); ix <= cmax - iy - iz; ++ix) {
+            const int ipos_asize = cmap[ix + iyz] * asize;
+            for (int jx = max(0, amin - jy - jz); jx <= amax - jy - jz; ++jx) {
+              const vdouble* const x = workx + rank * (amax1 * ix + jx);
+              vdouble sum = x[0] * iyiz[0];
+              for (int i = 1; i != rank; ++i)
+                sum += x[i] * iyiz[i];
+              const int ijposition = amap[jx + jyz] + ipos_asize;
+              for (int l = 0; l != nlane; ++l)
+                out[l][ijposition] = sum[l];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+}
+
+
+size_t ERIBatch::simd_buffer_size() const {
+  const int n = rank_ * nlane;
+  const int isize = (amax_+1) * (cmax_+1);
+  // SoA buffers for one group of quartets, followed by the work area of the kernel
+  return 2*n + 15*nlane + 3*isize*n + 6*n;
+}
+
+
+void ERIBatch::perform_VRR_lanes(const ERIBatch* const* batch, const int* prim, double* const* out, double* buff) {
+  const ERIBatch* const b0 = batch[0];
+  const int rank = b0->rank_;
+  const int n = rank * nlane;
+  double* const roots = buff;
+  double* const weights = roots + n;
+  double* const coeff = weights + n;
+  double* const P = coeff + nlane;
+  double* const Q = P + 3*nlane;
+  double* const A = Q + 3*nlane;
+  double* const C = A + 3*nlane;
+  double* const xp = C + 3*nlane;
+  double* const xq = xp + nlane;
+  double* const work = xq + nlane;
+
+  for (int l = 0; l != nlane; ++l) {
+    const ERIBatch* const b = batch[l];
+    const int ii = prim[l];
+    for (int i = 0; i != rank; ++i) {
+      roots[i*nlane+l] = b->roots_[ii*rank+i];
+      weights[i*nlane+l] = b->weights_[ii*rank+i];
+    }
+    for (int k = 0; k != 3; ++k) {
+      P[k*nlane+l] = b->P_[ii*3+k];
+      Q[k*nlane+l] = b->Q_[ii*3+k];
+      A[k*nlane+l] = b->basisinfo_[0]->position(k);
+      C[k*nlane+l] = b->basisinfo_[2]->position(k);
+    }
+    coeff[l] = b->coeff_[ii];
+    xp[l] = b->xp_[ii];
+    xq[l] = b->xq_[ii];
+  }
+  vrr_lanes(b0->amax_, b0->cmax_, b0->amin_, b0->cmin_, rank, roots, weights, coeff, A, C, P, Q, xp, xq,
+            b0->amapping_, b0->cmapping_, b0->asize_, out, work);
+}
+
+
+int ERIBatch::perform_VRR_simd() {
+  const int nvec = screening_size_ - screening_size_ % nlane;
+  if (nvec == 0)
+    return 0;
+
+  const int acsize = asize_ * csize_;
+  const size_t size = simd_buffer_size();
+  double* const buff = stack_->get(size);
+  const ERIBatch* batch[nlane];
+  int prim[nlane];
+  double* out[nlane];
+  fill_n(batch, nlane, this);
+
+  for (int j = 0; j != nvec; j += nlane) {
+    for (int l = 0; l != nlane; ++l) {
+      prim[l] = screening_[j+l];
+      out[l] = data_ + prim[l]*acsize;
+    }
+    perform_VRR_lanes(batch, prim, out, buff);
+  }
+
+  stack_->release(size, buff);
+  return nvec;
+}
+
+
+void ERIBatch::perform_VRR_simd(const vector<ERIBatch*>& batches) {
+  const ERIBatch* const b0 = batches.front();
+  const int acsize = b0->asize_ * b0->csize_;
+  const size_t size = b0->simd_buffer_size();
+  double* const buff = b0->stack_->get(size + acsize);
+  // the last group is padded with copies of its last quartet, whose results are discarded
+  double* const dummy = buff + size;
+
+  const ERIBatch* batch[nlane];
+  int prim[nlane];
+  double* out[nlane];
+  int l = 0;
+  for (auto& b : batches) {
+    for (int j = 0; j != b->screening_size_; ++j) {
+      batch[l] = b;
+      prim[l] = b->screening_[j];
+      out[l] = b->data_ + prim[l]*acsize;
+      if (++l == nlane) {
+        perform_VRR_lanes(batch, prim, out, buff);
+        l = 0;
+      }
+    }
+  }
+  if (l != 0) {
+    for (int k = l; k != nlane; ++k) {
+      batch[k] = batch[l-1];
+      prim[k] = prim[l-1];
+      out[k] = dummy;
+    }
+    perform_VRR_lanes(batch, prim, out, buff);
+  }
+
+  b0->stack_->release(size + acsize, buff);
+}
@@ -219,8 +219,10 @@ Atom::Atom(const Atom& old, const array<double, 3>& displacement)
 }
 
 Atom::Atom(const string nm, const string bas, const vector<shared_ptr<const Shell>> shell,
-                                              const vector<shared_ptr<const Shell_ECP>> shell_ECP, const int ncore, const int maxl)
-: name_(nm), shells_(shell), use_ecp_basis_(true), ecp_parameters_(make_shared<const ECP>(ncore, maxl, shell_ECP)), atom_number_(atommap.atom_number(nm)), basis_(bas) {
+                                              const vector<shared_ptr<const Shell_ECP>> shell_ECP, const int ncore, const int maxl,
+                                              const vector<shared_ptr<const Shell_ECP>> shell_SO)
+: name_(nm), shells_(shell), use_ecp_basis_(true), ecp_parameters_(make_shared<const ECP>(ncore, maxl, shell_ECP)),
+  so_parameters_(shell_SO.empty() ? make_shared<const SOECP>() : make_shared<const SOECP>(shell_SO)), atom_number_(atommap.atom_number(nm)), basis_(bas) {
   spherical_ = shells_.front()->spherical();
   position_ = shells_.front()->position();
 
@@ -230,7 +232,8 @@ Atom::Atom(const string nm, const string bas, const vector<shared_ptr<const Shel
 }
 
 Atom::Atom(const string nm, const string bas, const vector<shared_ptr<const Shell>> shell, const shared_ptr<const ECP> ecp_param)
-: name_(nm), shells_(shell), use_ecp_basis_(true), ecp_parameters_(ecp_param), atom_number_(atommap.atom_number(nm)), basis_(bas) {
+: name_(nm), shells_(shell), use_ecp_basis_(true), ecp_parameters_(ecp_param), so_parameters_(make_shared<const SOECP>()),
+  atom_number_(atommap.atom_number(nm)), basis_(bas) {
   spherical_ = shells_.front()->spherical();
   position_ = shells_.front()->position();
 
@@ -92,7 +92,8 @@ class Atom {
          const std::vector<std::tuple<std::string, std::vector<double>, std::vector<double>>>, const std::string bas = "custom_basis");
     Atom(const std::string name, const std::string bas, const std::vector<std::shared_ptr<const Shell>> shell);
     Atom(const std::string name, const std::string bas, const std::vector<std::shared_ptr<const Shell>> shell,
-                                                        const std::vector<std::shared_ptr<const Shell_ECP>> shell_ECP, const int ncore, const int maxl);
+                                                        const std::vector<std::shared_ptr<const Shell_ECP>> shell_ECP, const int ncore, const int maxl,
+                                                        const std::vector<std::shared_ptr<const Shell_ECP>> shell_SO = std::vector<std::shared_ptr<const Shell_ECP>>());
     Atom(const std::string name, const std::string bas, const std::vector<std::shared_ptr<const Shell>> shell,
                                                         const std::shared_ptr<const ECP> ecp_param);
 
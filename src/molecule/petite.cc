@@ -69,6 +69,7 @@ Petite::Petite(const vector<shared_ptr<const Atom>>& atoms, const string sym) :
 
   if (sym == c1) {
     nirrep_ = 1;
+    nsymop_ = 1;
   } else {
     if (sym == c2v){
       SymC2v datc2v;
@@ -99,7 +100,7 @@ Petite::Petite(const vector<shared_ptr<const Atom>>& atoms, const string sym) :
       symop_ = datc2h.symop();
       nirrep_ = datc2h.nirrep();
     } else {
-      assert(false);
+      throw runtime_error("unknown point group " + sym + " (c1, cs, ci, c2, d2, c2h, c2v, and d2h are supported)");
     }
     nsymop_ = symop_.size();
 
@@ -113,7 +114,7 @@ Petite::Petite(const vector<shared_ptr<const Atom>>& atoms, const string sym) :
         bool found = false;
         for (int jatom = 0; jatom != natom_; ++jatom) {
           const array<double,3> current = atoms[jatom]->position();
-          if (current == target) {
+          if (atoms[jatom]->name() == atoms[iatom]->name() && fabs(current[0]-target[0]) < 1.0e-8 && fabs(current[1]-target[1]) < 1.0e-8 && fabs(current[2]-target[2]) < 1.0e-8) {
             found = true;
             tmp[iop] = jatom;
             break;
@@ -156,7 +157,7 @@ Petite::Petite(const vector<shared_ptr<const Atom>>& atoms, const string sym) :
         for (int iop = 0; iop != nsymop_; ++iop) {
           const int ci = sym_shellmap_[i][iop];
           const int cj = sym_shellmap_[j][iop];
-          const int cij = ci * nshell_ + cj;
+          const int cij = min(ci, cj) * nshell_ + max(ci, cj);
           if (ij == cij) ++nij;
           else if (cij < ij) skipp2 = true;
         }
@@ -165,11 +166,90 @@ Petite::Petite(const vector<shared_ptr<const Atom>>& atoms, const string sym) :
       }
     } // end of shell loop
 
+    init_sign(vbb);
   } // end of if_c1
+  offset_.resize(nshell_);
+  for (int i = 0, cnt = 0; i != nshell_; cnt += vbb[i++]->nbasis())
+    offset_[i] = cnt;
 
 }
 
 
+void Petite::init_sign(const vector<shared_ptr<const Shell>>& shells) {
+  // the radial part is invariant; the sign of the angular part is evaluated at a generic point
+  const array<double,3> direction = {{0.3713, 0.5279, 0.7639}};
+  sym_sign_.resize(nshell_);
+  for (int i = 0; i != nshell_; ++i) {
+    const int n = shells[i]->nbasis();
+    // within the range of the tightest primitive, so that no contraction underflows
+    const double rmax = *max_element(shells[i]->exponents().begin(), shells[i]->exponents().end());
+    const double r = 0.5 / std::sqrt(max(rmax, 1.0e-3));
+    const array<double,3> d = {{direction[0]*r, direction[1]*r, direction[2]*r}};
+    vector<double> value(n);
+    shells[i]->compute_grid_value(value.data(), nullptr, nullptr, nullptr, d[0], d[1], d[2]);
+
+    for (int iop = 0; iop != nsymop_; ++iop) {
+      const array<double,3> gd = matmul33(symop_[iop], d);
+      vector<double> gvalue(n);
+      shells[i]->compute_grid_value(gvalue.data(), nullptr, nullptr, nullptr, gd[0], gd[1], gd[2]);
+      vector<double> sign(n);
+      for (int k = 0; k != n; ++k) {
+        if (fabs(value[k]) < 1.0e-100)
+          throw logic_error("Petite::init_sign failed to determine the parity of a basis function");
+        sign[k] = gvalue[k] / value[k] > 0.0 ? 1.0 : -1.0;
+        assert(fabs(fabs(gvalue[k] / value[k]) - 1.0) < 1.0e-8);
+      }
+      sym_sign_[i].push_back(sign);
+    }
+  }
+}
+
+
+shared_ptr<Matrix> Petite::symmetrize(const Matrix& skeleton) const {
+  auto out = make_shared<Matrix>(skeleton.ndim(), skeleton.mdim());
+  if (nirrep_ == 1) {
+    *out = skeleton;
+    return out;
+  }
+  // F = 1/|G| sum_R R G R^T
+  for (int iop = 0; iop != nsymop_; ++iop) {
+    for (int j = 0; j != nshell_; ++j) {
+      const int gj = sym_shellmap_[j][iop];
+      const vector<double>& sj = sym_sign_[j][iop];
+      for (int i = 0; i != nshell_; ++i) {
+        const int gi = sym_shellmap_[i][iop];
+        const vector<double>& si = sym_sign_[i][iop];
+        for (int jj = 0; jj != sj.size(); ++jj)
+          for (int ii = 0; ii != si.size(); ++ii)
+            out->element(offset_[gi]+ii, offset_[gj]+jj) += si[ii] * sj[jj] * skeleton(offset_[i]+ii, offset_[j]+jj);
+      }
+    }
+  }
+  out->scale(1.0/nsymop_);
+  return out;
+}
+
+
+bool Petite::is_symmetric(const Matrix& m, const double thresh) const {
+  // the identity is always the first operation
+  for (int iop = 1; iop != nsymop_; ++iop) {
+    for (int j = 0; j != nshell_; ++j) {
+      const int gj = sym_shellmap_[j][iop];
+      const vector<double>& sj = sym_sign_[j][iop];
+      for (int i = 0; i != nshell_; ++i) {
+        const int gi = sym_shellmap_[i][iop];
+        const vector<double>& si = sym_sign_[i][iop];
+        for (int jj = 0; jj != sj.size(); ++jj)
+          for (int ii = 0; ii != si.size(); ++ii)
+            if (fabs(m(offset_[gi]+ii, offset_[gj]+jj) - si[ii] * sj[jj] * m(offset_[i]+ii, offset_[j]+jj)) > thresh)
+              return false;
+      }
+    }
+  }
+  return true;
+}
+
+
 Petite::~Petite() {
 
 }
@@ -28,6 +28,7 @@
 
 #include <tuple>
 #include <src/molecule/atom.h>
+#include <src/util/math/matrix.h>
 #include <src/util/serialization.h>
 
 namespace bagel {
@@ -46,6 +47,11 @@ class Petite {
     std::vector<std::vector<int>> sym_shellmap_;
     std::vector<int> p1_;
     std::vector<int> lambda_;
+    // sign of each basis function in a shell under symmetry operations [shell][op][function]
+    std::vector<std::vector<std::vector<double>>> sym_sign_;
+    std::vector<int> offset_;
+
+    void init_sign(const std::vector<std::shared_ptr<const Shell>>& shells);
 
   private:
     // serialization
@@ -54,7 +60,7 @@ class Petite {
     template<class Archive>
     void serialize(Archive& ar, const unsigned int) {
       ar & natom_ & nshell_ & nirrep_ & nsymop_ & sym_ & symop_
-         & sym_atommap_ & sym_shellmap_ & p1_ & lambda_;
+         & sym_atommap_ & sym_shellmap_ & p1_ & lambda_ & sym_sign_ & offset_;
     }
 
   public:
@@ -67,24 +73,28 @@ class Petite {
     std::vector<int> sym_shellmap(const int i) const { return sym_shellmap_[i]; };
     std::vector<int> sym_atommap(const int i) const { return sym_atommap_[i]; };
 
+    // sign of the basis functions in shell i when mapped to shell sym_shellmap(i)[iop]
+    const std::vector<double>& sym_sign(const int i, const int iop) const { return sym_sign_[i][iop]; }
+
     int nirrep() const { return nirrep_; };
     int nsymop() const { return nsymop_; };
+    int nshell() const { return nshell_; };
 
     bool in_p1(int i) const { return (nirrep_ == 1 || p1_[i]); };
     bool in_p2(int ij) const { return (nirrep_ == 1 || lambda_[ij]); };
     int  in_p4(int ij, int kl, int i, int j, int k, int l) const {
       if (nirrep_ == 1) return 1;
-      const int shift = sizeof(int) * 4;
-      const int ijkl = ij < kl ? (ij << shift) + kl : (kl << shift) + ij;
+      const int shift = sizeof(size_t) * 4;
+      const size_t ijkl = ij < kl ? (static_cast<size_t>(ij) << shift) + kl : (static_cast<size_t>(kl) << shift) + ij;
       int nijkl = 1;
       for (int iop = 1; iop != nsymop_; ++iop) {
         const int gi = sym_shellmap_[i][iop];
         const int gj = sym_shellmap_[j][iop];
         const int gk = sym_shellmap_[k][iop];
         const int gl = sym_shellmap_[l][iop];
-        const int gij = std::min(gi, gj) * nshell_ + std::max(gi, gj);
-        const int gkl = std::min(gk, gl) * nshell_ + std::max(gk, gl);
-        const int gijkl =  gij < gkl ? (gij << shift) + gkl : (gkl << shift) + gij;
+        const size_t gij = std::min(gi, gj) * nshell_ + std::max(gi, gj);
+        const size_t gkl = std::min(gk, gl) * nshell_ + std::max(gk, gl);
+        const size_t gijkl =  gij < gkl ? (gij << shift) + gkl : (gkl << shift) + gij;
 
         if (gijkl < ijkl) return 0;
         else if (gijkl == ijkl) ++nijkl;
@@ -92,6 +102,11 @@ class Petite {
       return nsymop_ / nijkl;
     };
 
+    // symmetrizes a skeleton matrix (built from the unique quartets weighted by in_p4) in the AO basis
+    std::shared_ptr<Matrix> symmetrize(const Matrix& skeleton) const;
+    // whether a matrix in the AO basis is totally symmetric, i.e., R M R^T = M for all operations (elementwise within thresh)
+    bool is_symmetric(const Matrix& m, const double thresh) const;
+
 };
 
 
@@ -25,17 +25,35 @@
 
 #include <src/molecule/shellpair.h>
 #include <src/integral/os/multipolebatch.h>
-#include <src/integral/rys/eribatch.h>
-#include <src/integral/libint/libint.h>
+#include <src/integral/eribackend.h>
 
 using namespace std;
 using namespace bagel;
 
 const static double pisq__ = pi__ * pi__;
 
-ShellPair::ShellPair(const array<shared_ptr<const Shell>, 2>& sh, const array<int, 2>& ofs, const pair<int, int>& ind, const string ext, const double thr)
+ShellPair::ShellPair(const array<shared_ptr<const Shell>, 2>& sh, const array<int, 2>& ofs, const pair<int, int>& ind, const string ext, const double thr,
+                     const double schwarz)
  : shells_(sh), offset_(ofs), shell_ind_(ind), extent_type_(ext), thresh_(thr) {
-  init();
+  init(schwarz);
+}
+
+
+double ShellPair::qqr(const array<double, 3>& c0, const double e0, const int l0, const array<double, 3>& c1, const double e1, const int l1) {
+  const double r = sqrt((c0[0]-c1[0])*(c0[0]-c1[0]) + (c0[1]-c1[1])*(c0[1]-c1[1]) + (c0[2]-c1[2])*(c0[2]-c1[2])) - e0 - e1;
+  if (r <= 1.0)
+    return 1.0;
+  // higher multipoles are scaled by the extents, so that the estimate does not drop faster than the monopole one for diffuse pairs
+  return min(1.0, pow(max(e0, 1.0)/r, l0) * pow(max(e1, 1.0)/r, l1) / r);
+}
+
+
+double ShellPair::extent(const Shell& shell) {
+  const double lntau = log(1.0e-6);
+  double out = 0.0;
+  for (auto& expi : shell.exponents())
+    out = max(out, sqrt(max(0.0, (-lntau + 0.75*log(2.0*expi/pi__)) / expi)));
+  return out;
 }
 
 
@@ -72,7 +90,7 @@ bool ShellPair::is_neighbour(shared_ptr<const ShellPair> sp, const double ws) co
 }
 
 
-void ShellPair::init() {
+void ShellPair::init(const double schwarz) {
 
   shared_ptr<const Shell> b0 = shells_[0];
   shared_ptr<const Shell> b1 = shells_[1];
@@ -167,16 +185,21 @@ void ShellPair::init() {
   }
 //  extent_ *= scale[b0->angular_number()] * scale[b1->angular_number()];
 
+  // the lowest multipole of a one-centre pair is of order |la-lb| for spherical functions; it is determined by the parity for Cartesian ones
+  const int la = b0->angular_number();
+  const int lb = b1->angular_number();
+  multipole_ = rsq > 0.0 ? 0 : (b0->spherical() ? abs(la-lb) : (la+lb)%2);
+
   // schwarz
+  if (schwarz >= 0.0) {
+    schwarz_ = schwarz;
+    return;
+  }
   array<shared_ptr<const Shell>,4> input = {{b1, b0, b1, b0}};
-#ifdef LIBINT_INTERFACE
-  Libint eribatch(input);
-#else
-  ERIBatch eribatch(input, 0.0);
-#endif
-  eribatch.compute();
-  const double* eridata = eribatch.data();
-  const int datasize = eribatch.data_size();
+  shared_ptr<RysInt> eribatch = make_eribatch(input, 0.0);
+  eribatch->compute();
+  const double* eridata = eribatch->data();
+  const int datasize = eribatch->data_size();
   schwarz_ = 0.0;
   for (int xi = 0; xi != datasize; ++xi, ++eridata) {
     const double absed = sqrt(abs(*eridata));
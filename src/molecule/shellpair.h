@@ -44,22 +44,33 @@ class ShellPair {
     double schwarz_;
     std::array<double, 3> centre_;
     double extent_;
-    void init();
+    // order of the lowest multipole of the charge distribution (nonzero only for one-centre pairs)
+    int multipole_;
+    void init(const double schwarz);
 
   private:
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive& ar, const unsigned int) {
       ar & shells_ & offset_ & shell_ind_ & extent_type_ & nbasis0_ & nbasis1_
-         & thresh_ & schwarz_ & centre_ & extent_;
+         & thresh_ & schwarz_ & centre_ & extent_ & multipole_;
     }
 
   public:
     ShellPair() { }
+    // if schwarz is not negative, it is used as the Schwarz factor instead of computing (ab|ab)
     ShellPair(const std::array<std::shared_ptr<const Shell>, 2>& shells, const std::array<int, 2>& offset,
-              const std::pair<int, int>& shell_ind, const std::string extent_type = "yang", const double thresh = 1e-10);
+              const std::pair<int, int>& shell_ind, const std::string extent_type = "yang", const double thresh = 1e-10, const double schwarz = -1.0);
     bool is_neighbour(std::shared_ptr<const ShellPair> sp, const double ws) const;
 
+    // Distance-including (QQR) screening. |(ab|cd)| is estimated by Q_ab Q_cd times this factor, which decays as 1/R^(1+l_ab+l_cd)
+    // once the two charge distributions are separated (R is the distance between the centres minus the extents, in bohr,
+    // and l the order of the lowest multipole). It is 1 (i.e., the Schwarz bound) for nearby pairs.
+    static double qqr(const std::array<double, 3>& c0, const double e0, const int l0, const std::array<double, 3>& c1, const double e1, const int l1);
+    double qqr(const ShellPair& sp) const { return qqr(centre_, extent_, multipole_, sp.centre_, sp.extent_, sp.multipole_); }
+    // extent of a single shell (e.g., auxiliary functions in 3-index integrals), defined as in the "yang" extents of shell pairs
+    static double extent(const Shell& shell);
+
     const std::array<std::shared_ptr<const Shell>, 2>& shells() const { return shells_; }
     std::shared_ptr<const Shell> shell(const int i) const { assert(i==0 || i==1); return shells_[i]; }
     const std::array<int, 2>& offset() const { return offset_; }
@@ -70,6 +81,7 @@ class ShellPair {
     const std::array<double, 3>& centre() const { return centre_; }
     double centre(const int i) const { return centre_[i]; }
     double extent() const { return extent_; }
+    int multipole() const { return multipole_; }
     int nbasis0() const { return nbasis0_; }
     int nbasis1() const { return nbasis1_; }
 
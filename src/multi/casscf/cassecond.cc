@@ -239,19 +239,25 @@ shared_ptr<RotFile> CASSecond::compute_denom(shared_ptr<const DFHalfDist> half,
       for (int j = 0; j != nvirt_; ++j)
         denom->ele_va(j, i) += 2.0 * (*cfock)(j+nocc_, j+nocc_) * rdm1(i, i) - 2.0 * fcd(i, i);
 
-    const int nao = coeff_->ndim();
+    // J_rs = (D|rs) v_D summed over the processes, where v points to the local part of a fitted vector.
+    // geom_->df() may keep the AO integrals in DFStorage, so this goes through compute_Jop_from_cd.
+    shared_ptr<const DFDist> df = geom_->df();
+    auto contract_ao = [&df](const double* v) {
+      auto cd = make_shared<VectorB>(df->naux());
+      copy_n(v, df->asize(), cd->data()+df->astart());
+      return df->compute_Jop_from_cd(cd);
+    };
+
     if (nclosed_) {
       auto vvc = half_1j->compute_second_transform(vcoeff)->form_4index_diagonal()->transpose();
       denom->ax_plus_y_vc(12.0, *vvc);
 
       shared_ptr<const DFFullDist> vgcc = half->compute_second_transform(ccoeff);
       const int nri = vgcc->block(0)->asize();
-      Matrix tmp(nao, nao);
+      assert(nri == df->asize());
       for (int i = 0; i != nclosed_; ++i) {
-        dgemv_("T", nri, nao*nao, 1.0, geom_->df()->block(0)->data(), nri, vgcc->block(0)->data()+nri*(i+nclosed_*i), 1, 0.0, tmp.data(), 1);
-        if (!vgcc->serial())
-          tmp.allreduce();
-        Matrix tmp0 = vcoeff % tmp * vcoeff;
+        shared_ptr<const Matrix> tmp = contract_ao(vgcc->block(0)->data()+nri*(i+nclosed_*i));
+        Matrix tmp0 = vcoeff % *tmp * vcoeff;
         blas::ax_plus_y_n(-4.0, tmp0.diag().data(), nvirt_, denom->ptr_vc()+nvirt_*i);
       }
     }
@@ -259,15 +265,12 @@ shared_ptr<RotFile> CASSecond::compute_denom(shared_ptr<const DFHalfDist> half,
     const int nri = vaa->block(0)->asize();
     {
       shared_ptr<const DFFullDist> vgaa = vaa->apply_2rdm(*fci_->rdm2_av());
-      Matrix tmp(nao, nao);
       for (int i = 0; i != nact_; ++i) {
-        dgemv_("T", nri, nao*nao, 1.0, geom_->df()->block(0)->data(), nri, vgaa->block(0)->data()+nri*(i+nact_*i), 1, 0.0, tmp.data(), 1);
-        if (!vgaa->serial())
-          tmp.allreduce();
-        Matrix tmp0 = vcoeff % tmp * vcoeff;
+        shared_ptr<const Matrix> tmp = contract_ao(vgaa->block(0)->data()+nri*(i+nact_*i));
+        Matrix tmp0 = vcoeff % *tmp * vcoeff;
         blas::ax_plus_y_n(2.0, tmp0.diag().data(), nvirt_, denom->ptr_va()+nvirt_*i);
         if (nclosed_) {
-          Matrix tmp1 = ccoeff % tmp * ccoeff;
+          Matrix tmp1 = ccoeff % *tmp * ccoeff;
           blas::ax_plus_y_n(2.0, tmp1.diag().data(), nclosed_, denom->ptr_ca()+nclosed_*i);
         }
       }
@@ -299,15 +302,12 @@ shared_ptr<RotFile> CASSecond::compute_denom(shared_ptr<const DFHalfDist> half,
       }
     }
     if (nclosed_) {
-      Matrix tmp(nao, nao);
       shared_ptr<DFFullDist> vgaa = vaa->copy();
       vgaa = vgaa->transform_occ1(make_shared<Matrix>(rdm1));
       vgaa->ax_plus_y(-1.0, vaa);
       for (int i = 0; i != nact_; ++i) {
-        dgemv_("T", nri, nao*nao, 1.0, geom_->df()->block(0)->data(), nri, vgaa->block(0)->data()+nri*(i+nact_*i), 1, 0.0, tmp.data(), 1);
-        if (!vgaa->serial())
-          tmp.allreduce();
-        Matrix tmp0 = ccoeff % tmp * ccoeff;
+        shared_ptr<const Matrix> tmp = contract_ao(vgaa->block(0)->data()+nri*(i+nact_*i));
+        Matrix tmp0 = ccoeff % *tmp * ccoeff;
         blas::ax_plus_y_n(4.0, tmp0.diag().data(), nclosed_, denom->ptr_ca()+nclosed_*i);
       }
     }
@@ -87,7 +87,7 @@ void MP2::compute() {
       auto cgeom = make_shared<Geometry>(*geom_, info, false);
       half = cgeom->df()->compute_half_transform(ocoeff);
       // used later to determine the cache size
-      memory_size = cgeom->df()->block(0)->size();
+      memory_size = cgeom->df()->asize() * cgeom->df()->nindex1() * cgeom->df()->nindex2();
       mpi__->broadcast(&memory_size, 1, 0);
     }
 
@@ -535,7 +535,7 @@ void NEVPT2<DataType>::compute() {
   // compute transformed integrals
 
   // used later to determine the cache size
-  size_t memory_size = cgeom->df()->block(0)->size(); // TODO make it robust
+  size_t memory_size = cgeom->df()->asize() * cgeom->df()->nindex1() * cgeom->df()->nindex2(); // TODO make it robust
   mpi__->broadcast(&memory_size, 1, 0);
 
   // this will be used in MP2Cache
@@ -37,6 +37,7 @@
 #include <src/asd/multisite/multisite.h>
 #include <src/util/archive.h>
 #include <src/util/io/moldenout.h>
+#include <src/util/math/bufferpool.h>
 
 using namespace std;
 using namespace bagel;
@@ -232,6 +233,7 @@ void bagel::impl::run_bagel_(shared_ptr<const PTree> idata) {
 
   }
 
+  cout << BufferPool::get().statistics() << endl;
   print_footer();
 }
 
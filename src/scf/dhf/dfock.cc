@@ -30,12 +30,28 @@ using namespace bagel;
 // TODO batch size should be automatically determined by the memory size etc.
 const static int batchsize = 250;
 
+namespace {
+// Dirac--Coulomb DF objects and half-transformed integrals are either LL or SS (basis 2 and 3 are S+ and S-)
+bool small_component(const RelDFBase& o) { return o.basis().front()->basis(0) > 1; }
+}
+
 DFock::DFock(shared_ptr<const Geometry> a,  shared_ptr<const ZMatrix> hc, const ZMatView coeff, const bool gaunt, const bool breit,
-             const bool store_half, const bool robust, const double scale_exch, const double scale_coulomb, const bool store_half_gaunt)
-  : ZMatrix(*hc), geom_(a), gaunt_(gaunt), breit_(breit), store_half_(store_half), store_half_gaunt_(store_half_gaunt), robust_(robust) {
+             const bool store_half, const bool robust, const double scale_exch, const double scale_coulomb, const bool store_half_gaunt, const bool kramers,
+             const bool ssss)
+  : ZMatrix(*hc), geom_(a), gaunt_(gaunt), breit_(breit), store_half_(store_half), store_half_gaunt_(store_half_gaunt), robust_(robust), ssss_(ssss) {
 
   assert(breit ? gaunt : true);
-  two_electron_part(coeff, scale_exch, scale_coulomb);
+  if (!kramers) {
+    two_electron_part(coeff, scale_exch, scale_coulomb);
+  } else {
+    // half-transformed integrals would lack the Kramers partners
+    if (store_half) throw logic_error("half-transformed integrals cannot be stored in the Kramers-restricted Fock build");
+    if (geom_->magnetism()) throw logic_error("Kramers symmetry is broken by a magnetic field");
+    zero();
+    two_electron_part(coeff, scale_exch, scale_coulomb);
+    add_kramers_partners();
+    ax_plus_y(1.0, *hc);
+  }
 }
 
 
@@ -44,7 +60,7 @@ DFock::DFock(shared_ptr<const Geometry> a,  shared_ptr<const ZMatrix> hc, const
 DFock::DFock(shared_ptr<const Geometry> a, shared_ptr<const ZMatrix> hc, shared_ptr<const ZMatrix> coeff, shared_ptr<const ZMatrix> tcoeff,
              list<shared_ptr<const RelDFHalf>> int1c, list<shared_ptr<const RelDFHalf>> int2c,
              const double scale_exch, const double scale_coulomb)
-  : ZMatrix(*hc), geom_(a), gaunt_(false), breit_(false), store_half_(false), store_half_gaunt_(false), robust_(false) {
+  : ZMatrix(*hc), geom_(a), gaunt_(false), breit_(false), store_half_(false), store_half_gaunt_(false), robust_(false), ssss_(true) {
 
   // will use the zgemm3m-like algorithm
   for (auto& i : int1c)
@@ -85,6 +101,22 @@ void DFock::two_electron_part(const ZMatView coeff, const double scale_exchange,
 }
 
 
+void DFock::add_kramers_partners() {
+  // The two-electron operators commute with time reversal K, so that the orbitals K|i> contribute K G K^-1.
+  // For each pair of L and S components, 2x2 spin blocks [[A, B], [C, D]] are mapped to [[D*, -C*], [-B*, A*]].
+  const int n = geom_->nbasis();
+  assert(ndim() == 4*n && mdim() == 4*n);
+  const ZMatrix g(*this);
+  for (int x = 0; x != 4*n; x += 2*n)
+    for (int y = 0; y != 4*n; y += 2*n) {
+      add_block( 1.0, x,   y,   n, n, g.get_submatrix(x+n, y+n, n, n)->get_conjg());
+      add_block(-1.0, x,   y+n, n, n, g.get_submatrix(x+n, y,   n, n)->get_conjg());
+      add_block(-1.0, x+n, y,   n, n, g.get_submatrix(x,   y+n, n, n)->get_conjg());
+      add_block( 1.0, x+n, y+n, n, n, g.get_submatrix(x,   y,   n, n)->get_conjg());
+    }
+}
+
+
 void DFock::add_Jop_block(shared_ptr<const RelDF> dfdata, list<shared_ptr<const RelCDMatrix>> cd, const double scale) {
 
   const int n = geom_->nbasis();
@@ -249,7 +281,7 @@ void DFock::driver(shared_ptr<const ZMatrix> coeff, bool gaunt, bool breit, cons
     auto breitint = make_shared<BreitInt>(geom_);
     list<shared_ptr<Breit2Index>> breit_2index;
     for (int i = 0; i != breitint->Nblocks(); ++i) {
-      breit_2index.push_back(make_shared<Breit2Index>(breitint->index(i), breitint->data(i), geom_->df()->data2()));
+      breit_2index.push_back(make_shared<Breit2Index>(breitint->index(i), breitint->data(i), geom_->df()->metric()));
 
       // if breit index is xy, xz, yz, get yx, zx, zy (which is the exact same with reversed index)
       if (breitint->not_diagonal(i))
@@ -343,7 +375,8 @@ void DFock::build_k(list<shared_ptr<const RelDFHalf>> half_complex_exch, list<sh
     for (auto& i : half_complex_exch) {
       int jcnt = 0;
       for (auto& j : half_complex_exch2) {
-        if (i->alpha_matches(j) && ((!robust_ && icnt <= jcnt) || robust_))
+        const bool skip = !gaunt && !ssss_ && small_component(*i) && small_component(*j);
+        if (i->alpha_matches(j) && ((!robust_ && icnt <= jcnt) || robust_) && !skip)
           add_Exop_block(i, j, gscale*scale_exchange, icnt == jcnt);
         ++jcnt;
       }
@@ -378,13 +411,18 @@ void DFock::build_j(list<shared_ptr<const RelDFHalf>> dummy, list<shared_ptr<con
     }
     list<shared_ptr<RelDF>> dfdists = make_dfdists(dfs, gaunt);
 
-    list<shared_ptr<const RelCDMatrix>> cd;
+    list<shared_ptr<const RelCDMatrix>> cd, cd_large;
+    const double* metric = geom_->df()->metric();
     // compute J operators
     for (auto& j : half_complex_exch2)
-      for (auto& i : j->basis())
-        cd.push_back(make_shared<RelCDMatrix>(j, i, trocoeff, tiocoeff, geom_->df()->data2(), number_of_j));
+      for (auto& i : j->basis()) {
+        cd.push_back(make_shared<RelCDMatrix>(j, i, trocoeff, tiocoeff, metric, number_of_j));
+        if (gaunt || !small_component(*j))
+          cd_large.push_back(cd.back());
+      }
+    // without (SS|SS), the SS blocks only see the LL density
     for (auto& i : dfdists)
-      add_Jop_block(i, cd, gscale);
+      add_Jop_block(i, gaunt || ssss_ || !small_component(*i) ? cd : cd_large, gscale);
     timer.tick_print(printtag + ": J operator");
   }
 }
@@ -37,6 +37,8 @@ class DFock : public ZMatrix {
     const bool breit_;
 
     void two_electron_part(const ZMatView coeff, const double scale_ex, const double scale_coulomb);
+    // adds the time-reversed image of this matrix, i.e., the contribution of the Kramers partners of the orbitals used
+    void add_kramers_partners();
 
 
     void add_Jop_block(std::shared_ptr<const RelDF>, std::list<std::shared_ptr<const RelCDMatrix>>, const double scale);
@@ -54,13 +56,19 @@ class DFock : public ZMatrix {
     // if true, do not use bra-ket symmetry in the exchange build (only useful for breit when accurate orbitals are needed).
     bool robust_;
 
+    // if false, the (SS|SS) contributions to the Dirac--Coulomb part are skipped (used in the early iterations of tiered SCF)
+    bool ssss_;
+
   public:
+    // When kramers is true, coeff contains one orbital of each Kramers pair and the partners are included by time-reversal symmetry.
     DFock(std::shared_ptr<const Geometry> a,  std::shared_ptr<const ZMatrix> hc, const ZMatView coeff, const bool gaunt, const bool breit,
-          const bool store_half, const bool robust = false, const double scale_exch = 1.0, const double scale_coulomb = 1.0, const bool store_half_gaunt = false);
+          const bool store_half, const bool robust = false, const double scale_exch = 1.0, const double scale_coulomb = 1.0, const bool store_half_gaunt = false,
+          const bool kramers = false, const bool ssss = true);
     // same as above
     DFock(std::shared_ptr<const Geometry> a, std::shared_ptr<const ZMatrix> hc, std::shared_ptr<const ZMatrix> coeff, const bool gaunt, const bool breit,
-          const bool store_half, const bool robust = false, const double scale_exch = 1.0, const double scale_coulomb = 1.0, const bool store_half_gaunt = false)
-     : DFock(a, hc, *coeff, gaunt, breit, store_half, robust, scale_exch, scale_coulomb, store_half_gaunt) {
+          const bool store_half, const bool robust = false, const double scale_exch = 1.0, const double scale_coulomb = 1.0, const bool store_half_gaunt = false,
+          const bool kramers = false, const bool ssss = true)
+     : DFock(a, hc, *coeff, gaunt, breit, store_half, robust, scale_exch, scale_coulomb, store_half_gaunt, kramers, ssss) {
     }
     // DFock from half-transformed integrals
     DFock(std::shared_ptr<const Geometry> a, std::shared_ptr<const ZMatrix> hc, std::shared_ptr<const ZMatrix> coeff, std::shared_ptr<const ZMatrix> tcoeff,
@@ -35,6 +35,7 @@
 #include <src/util/constants.h>
 #include <src/util/math/zmatrix.h>
 #include <src/util/math/matrix.h>
+#include <src/util/math/quatmatrix.h>
 #include <src/util/math/diis.h>
 #include <src/util/muffle.h>
 #include <src/util/io/dfpcmo.h>
@@ -52,6 +53,7 @@ Dirac::Dirac(const shared_ptr<const PTree> idata, const shared_ptr<const Geometr
   // when computing gradient, we store half-transform integrals
   do_grad_ = idata->get<bool>("_gradient", false);
   if (do_grad_ && geom_->magnetism()) throw runtime_error("Gradient integrals have not been implemented for a GIAO basis.");
+  if (geom_->cholesky_thresh() > 0.0) throw runtime_error("cholesky_thresh is not implemented for Dirac--Hartree--Fock");
 
   // MO printout option
   dfpcmo_ = idata->get<bool>("dfpcmo", false);
@@ -102,6 +104,79 @@ void Dirac::common_init(const shared_ptr<const PTree> idata) {
   assert(s12_->mdim() % 2 == 0);
 
   if (breit_ && !gaunt_) throw runtime_error("Breit cannot be turned on if Gaunt is off");
+
+  tiered_ = idata->get<bool>("tiered", false);
+  thresh_tiered_ = idata->get<double>("thresh_tiered", 1.0e-5);
+
+  kramers_ = idata->get<bool>("kramers", false);
+  if (kramers_) {
+    if (geom_->magnetism()) throw runtime_error("Kramers-restricted Dirac--Hartree--Fock cannot be used with a magnetic field");
+    if (do_grad_) throw runtime_error("Kramers-restricted Dirac--Hartree--Fock has not been implemented for gradients");
+    // tildex is [La Lb Sa Sb]; the Kramers partners of the La and Sa columns are the Lb and Sb columns
+    const int m = s12_->mdim()/4;
+    auto s12 = make_shared<ZMatrix>(*s12_);
+    s12->copy_block(0, 1*m, s12->ndim(), m, s12_->slice(2*m, 3*m));
+    s12->copy_block(0, 2*m, s12->ndim(), m, s12_->slice(1*m, 2*m));
+    s12_ = s12;
+  }
+}
+
+
+namespace {
+// Kramers pairs are adjacent (2i, 2i+1) in the striped order and are (i, m+i) in the Kramers order, where 2m is the number of orbitals
+shared_ptr<ZMatrix> kramers_order(const ZMatrix& striped) {
+  const int n = striped.ndim();
+  const int m = striped.mdim()/2;
+  auto out = striped.clone();
+  for (int i = 0; i != m; ++i) {
+    out->copy_block(0, i,   n, 1, striped.slice(2*i,   2*i+1));
+    out->copy_block(0, m+i, n, 1, striped.slice(2*i+1, 2*i+2));
+  }
+  return out;
+}
+
+shared_ptr<ZMatrix> striped_order(const ZMatrix& kramers) {
+  const int n = kramers.ndim();
+  const int m = kramers.mdim()/2;
+  auto out = kramers.clone();
+  for (int i = 0; i != m; ++i) {
+    out->copy_block(0, 2*i,   n, 1, kramers.slice(i,   i+1));
+    out->copy_block(0, 2*i+1, n, 1, kramers.slice(m+i, m+i+1));
+  }
+  return out;
+}
+}
+
+
+shared_ptr<const DistZMatrix> Dirac::diagonalize(const DistZMatrix& c, const DistZMatrix& fock, VectorB& eig) const {
+  if (!kramers_) {
+    DistZMatrix interm = c % fock * c;
+    interm.diagonalize(eig);
+    return make_shared<const DistZMatrix>(c * interm);
+  }
+  // c^+ F c is a quaternion matrix; numerical noise (and a guess Fock matrix without time-reversal symmetry) is averaged out
+  QuatMatrix interm(ZMatrix(c % fock * c));
+  interm.t_symmetrize();
+  interm.diagonalize(eig);
+  const int m = eig.size()/2;
+  for (int i = m-1; i >= 0; --i)
+    eig(2*i) = eig(2*i+1) = eig(i);
+  return make_shared<const DistZMatrix>(*striped_order(ZMatrix(c) * interm));
+}
+
+
+shared_ptr<DFock> Dirac::form_fock(const ZMatrix& coeff, const bool full) const {
+  const bool gaunt = full && gaunt_;
+  const bool breit = full && breit_;
+  if (!kramers_)
+    return make_shared<DFock>(geom_, hcore_, coeff.slice_copy(nneg_, nele_+nneg_), gaunt, breit, do_grad_, robust_, 1.0, 1.0, false, false, /*ssss*/full);
+  // one orbital of each (striped) Kramers pair
+  auto ocoeff = make_shared<ZMatrix>(coeff.ndim(), nele_/2);
+  for (int i = 0; i != nele_/2; ++i)
+    ocoeff->copy_block(0, i, coeff.ndim(), 1, coeff.slice(nneg_+2*i, nneg_+2*i+1));
+  // The Breit exchange skips half of the bra-ket pairs, which is exact only for the sum over both spinors of each Kramers pair
+  // (about 2e-8 in the energy of HF/svp otherwise). All pairs over one spinor of each pair cost the same as the skipped form over both.
+  return make_shared<DFock>(geom_, hcore_, ocoeff, gaunt, breit, /*store_half*/false, robust_ || breit, 1.0, 1.0, false, /*kramers*/true, /*ssss*/full);
 }
 
 
@@ -123,14 +198,26 @@ void Dirac::compute() {
   cout << indent << "    * DIIS with orbital gradients will be used." << endl << endl;
   scftime.tick_print("SCF startup");
   cout << endl;
+  if (kramers_)
+    cout << indent << "    * Kramers-restricted Fock build and quaternion diagonalization will be used." << endl << endl;
+  const string tiered_terms = string("(SS|SS)") + (gaunt_ ? (breit_ ? ", Gaunt and Breit" : " and Gaunt") : "");
+  if (tiered_)
+    cout << indent << "    * " << tiered_terms << " will be included when the error is below " << scientific << setprecision(1) << thresh_tiered_ << "." << endl << endl;
   cout << indent << "=== Dirac RHF iteration (" + geom_->basisfile() + ", " << (geom_->magnetism() ? "RMB" : "RKB") << ") ===" << endl << indent << endl;
 
   DIIS<DistZMatrix, ZMatrix> diis(5);
+  bool full = !tiered_;
 
   for (int iter = 0; iter != max_iter_; ++iter) {
     Timer ptime(1);
 
-    auto fock = make_shared<DFock>(geom_, hcore_, coeff->matrix()->slice_copy(nneg_, nele_+nneg_), gaunt_, breit_, do_grad_, robust_);
+    // the last iteration always includes all the terms, so that the reported energy is never that of the reduced Hamiltonian
+    if (!full && iter == max_iter_-1) {
+      full = true;
+      cout << indent << endl << indent << "  * " << tiered_terms << " switched on for the last iteration." << endl << indent << endl;
+    }
+
+    shared_ptr<const DFock> fock = form_fock(*coeff->matrix(), full);
     shared_ptr<const DistZMatrix> distfock = fock->distmatrix();
 
     // compute energy here
@@ -148,7 +235,15 @@ void Dirac::compute() {
     cout << indent << setw(5) << iter << setw(20) << fixed << setprecision(8) << energy_
          << "   " << setw(17) << error << setw(15) << setprecision(2) << scftime.tick() << endl;
 
-    if (error < thresh_scf_ && iter > 0) {
+    if (!full && error < max(thresh_tiered_, thresh_scf_)) {
+      // the next Fock matrix is built from the same orbitals; DIIS is restarted since the Hamiltonian has changed
+      full = true;
+      diis = DIIS<DistZMatrix, ZMatrix>(5);
+      cout << indent << endl << indent << "  * " << tiered_terms << " switched on." << endl << indent << endl;
+      continue;
+    }
+
+    if (full && error < thresh_scf_ && iter > 0) {
       cout << indent << endl << indent << "  * SCF iteration converged." << endl << endl;
       // when computing gradient, we store half-transform integrals to avoid recomputation
       if (do_grad_) {
@@ -173,9 +268,7 @@ void Dirac::compute() {
       ptime.tick_print("DIIS");
     }
 
-    DistZMatrix intermediate(*coeff % *distfock * *coeff);
-    intermediate.diagonalize(eig_);
-    coeff = make_shared<DistZMatrix>(*coeff * intermediate);
+    coeff = diagonalize(kramers_ ? DistZMatrix(*kramers_order(*coeff->matrix())) : *coeff, *distfock, eig_);
 
     aodensity = coeff->form_density_rhf(nele_, nneg_);
 
@@ -248,17 +341,13 @@ shared_ptr<const DistZMatrix> Dirac::initial_guess(const shared_ptr<const DistZM
   shared_ptr<const DistZMatrix> coeff;
   if (!ref_) {
     // No reference; starting from hcore
-    DistZMatrix interm = *s12 % *hcore * *s12;
-    interm.diagonalize(eig);
-    coeff = make_shared<const DistZMatrix>(*s12 * interm);
+    coeff = diagonalize(*s12, *hcore, eig);
 
   } else if (dynamic_pointer_cast<const RelReference>(ref_)) {
     // Relativistic (4-component) reference
     auto relref = dynamic_pointer_cast<const RelReference>(ref_);
     shared_ptr<ZMatrix> fock = make_shared<DFock>(geom_, hcore_, relref->relcoeff()->slice_copy(0, nele_), gaunt_, breit_, /*store_half*/false, robust_);
-    DistZMatrix interm = *s12 % *fock->distmatrix() * *s12;
-    interm.diagonalize(eig);
-    coeff = make_shared<const DistZMatrix>(*s12 * interm);
+    coeff = diagonalize(*s12, *fock->distmatrix(), eig);
 
   } else if (dynamic_pointer_cast<const ZReference>(ref_)) {
     // Non-relativistic, GIAO-based reference
@@ -270,9 +359,7 @@ shared_ptr<const DistZMatrix> Dirac::initial_guess(const shared_ptr<const DistZM
     ocoeff->add_block(1.0, 0,    0, n, nocc, zref->zcoeff()->slice(0,nocc));
     ocoeff->add_block(1.0, n, nocc, n, nocc, zref->zcoeff()->slice(0,nocc));
     auto fock = make_shared<DFock>(geom_, hcore_, ocoeff, gaunt_, breit_, /*store_half*/false, robust_);
-    DistZMatrix interm = *s12 % *fock->distmatrix() * *s12;
-    interm.diagonalize(eig);
-    coeff = make_shared<const DistZMatrix>(*s12 * interm);
+    coeff = diagonalize(*s12, *fock->distmatrix(), eig);
 
   } else if (ref_->coeff()->ndim() == n) {
     // Non-relativistic, real reference
@@ -301,9 +388,7 @@ shared_ptr<const DistZMatrix> Dirac::initial_guess(const shared_ptr<const DistZM
       ocoeff->add_real_block(1.0, n, nele_, n, nele_, ref_->coeff()->slice(0,nele_));
       fock = make_shared<DFock>(geom_, hcore_, ocoeff, gaunt_, breit_, /*store_half*/false, robust_);
     }
-    DistZMatrix interm = *s12 % *fock->distmatrix() * *s12;
-    interm.diagonalize(eig);
-    coeff = make_shared<const DistZMatrix>(*s12 * interm);
+    coeff = diagonalize(*s12, *fock->distmatrix(), eig);
   } else {
     assert(ref_->coeff()->ndim() == n*4);
     throw logic_error("Invalid Reference provided for Dirac.  (Initial guess not implemented.)");
@@ -28,6 +28,7 @@
 
 #include <src/wfn/method.h>
 #include <src/df/reldfhalf.h>
+#include <src/scf/dhf/dfock.h>
 
 namespace bagel {
 
@@ -51,6 +52,11 @@ class Dirac : public Method {
 
     // for Fock build
     bool robust_;
+    // Kramers-restricted SCF (Fock build from one orbital of each Kramers pair and quaternion diagonalization)
+    bool kramers_;
+    // tiered SCF: (SS|SS), Gaunt and Breit are switched on when the error falls below thresh_tiered_
+    bool tiered_;
+    double thresh_tiered_;
 
     int multipole_print_;
     bool conv_ignore_;
@@ -63,6 +69,10 @@ class Dirac : public Method {
 
     void common_init(const std::shared_ptr<const PTree>);
     std::shared_ptr<const DistZMatrix> initial_guess(const std::shared_ptr<const DistZMatrix> s12, const std::shared_ptr<const DistZMatrix> hcore) const;
+    // returns the eigenvectors of c^+ F c transformed back by c. If kramers_, c has to be in the Kramers order (see kramers_order)
+    std::shared_ptr<const DistZMatrix> diagonalize(const DistZMatrix& c, const DistZMatrix& fock, VectorB& eig) const;
+    // Fock matrix from the occupied orbitals in coeff (offset nneg_); unless full, without (SS|SS), Gaunt and Breit
+    std::shared_ptr<DFock> form_fock(const ZMatrix& coeff, const bool full = true) const;
 
     // if gradient is requested, half-transformed integrals will be reused
     bool do_grad_;
@@ -182,9 +182,9 @@ shared_ptr<GradFile> GradEval<Dirac>::compute(const string jobtitle, shared_ptr<
     for (auto& j : half_complex_exch) {
       for (auto& i : j->basis()) {
         if (cd) {
-          *cd += RelCDMatrix(j, i, trocoeff, tiocoeff, geom_->df()->data2(), external_half ? 1 : 2);
+          *cd += RelCDMatrix(j, i, trocoeff, tiocoeff, geom_->df()->metric(), external_half ? 1 : 2);
         } else {
-          cd = make_shared<RelCDMatrix>(j, i, trocoeff, tiocoeff, geom_->df()->data2(), external_half ? 1 : 2);
+          cd = make_shared<RelCDMatrix>(j, i, trocoeff, tiocoeff, geom_->df()->metric(), external_half ? 1 : 2);
         }
       }
     }
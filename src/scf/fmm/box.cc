@@ -353,19 +353,28 @@ void Box::compute_M2L_X() {
 }
 
 
+void Box::init_m2l(shared_ptr<const M2LRotation> m2l) {
+
+  assert(m2l->lmax() == lmax_);
+  m2l_ = m2l;
+  m2l_trans_.clear();
+  m2l_trans_.reserve(ninter_);
+  for (int i = 0; i != ninter_; ++i) {
+    shared_ptr<const Box> it = inter_[i].lock();
+    const array<double, 3> r12 = {{centre_[0] - it->centre(0), centre_[1] - it->centre(1), centre_[2] - it->centre(2)}};
+    m2l_trans_.push_back(m2l_->translation(r12));
+  }
+}
+
+
 void Box::compute_M2L() {
 
   mlm_->fill(0.0);
+  assert(m2l_trans_.size() == ninter_);
   // from interaction list
   for (int i = 0; i != ninter_; ++i) {
     shared_ptr<const Box> it = inter_[i].lock();
-    const array<double, 3> r12 = {{centre_[0] - it->centre(0), centre_[1] - it->centre(1), centre_[2] - it->centre(2)}};
-    auto imultipole = make_shared<ZMatrix>(1, nmult_);
-    copy_n(it->olm()->data(), nmult_, imultipole->data());
-    shared_ptr<const ZMatrix> tmp = shift_localMX(lmax_, imultipole, r12);
-    auto slocal = make_shared<ZVectorB>(nmult_);
-    copy_n(tmp->data(), nmult_, slocal->data());
-    blas::ax_plus_y_n(1.0, slocal->data(), nmult_, mlm_->data());
+    m2l_->compute(m2l_trans_[i], it->olm()->data(), mlm_->data());
   }
 }
 
@@ -413,7 +422,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf(shared_ptr<const Matrix> density,
         const double mulfactor = max(max(max(density_01, density_02),
                                          max(density_03, density_12)),
                                          max(density_13, density_23));
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
         ++ntask;
@@ -468,7 +477,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf(shared_ptr<const Matrix> density,
         const double mulfactor = max(max(max(density_01, density_02),
                                          max(density_03, density_12)),
                                          max(density_13, density_23));
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
 
@@ -877,7 +886,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf_J(shared_ptr<const Matrix> density
         const double density_23 = (*max_den)(i23) * 4.0;
 
         const double mulfactor = max(density_01, density_23);
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
         ++ntask;
@@ -926,7 +935,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf_J(shared_ptr<const Matrix> density
         const double density_23 = (*max_den)(i23) * 4.0;
 
         const double mulfactor = max(density_01, density_23);
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
 
@@ -1020,7 +1029,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf_K(shared_ptr<const Matrix> density
 
         const double mulfactor = max(max(density_13, density_02),
                                      max(density_03, density_12));
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
         ++ntask;
@@ -1071,7 +1080,7 @@ shared_ptr<const Matrix> Box::compute_Fock_nf_K(shared_ptr<const Matrix> density
 
         const double mulfactor = max(max(density_13, density_02),
                                      max(density_03, density_12));
-        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz();
+        const double integral_bound = mulfactor * v01->schwarz() * v23->schwarz() * (qqr_ ? v01->qqr(*v23) : 1.0);
         const bool skip_schwarz = integral_bound < schwarz_thresh_;
         if (skip_schwarz) continue;
 
@@ -28,6 +28,7 @@
 #define __SRC_SCF_FMM_BOX_H
 
 #include <src/molecule/shellpair.h>
+#include <src/scf/fmm/m2lrotation.h>
 
 namespace bagel {
 
@@ -50,6 +51,7 @@ class Box {
     int nchild_, ninter_, nneigh_;
 
     double extent_, schwarz_thresh_;
+    bool qqr_;
     int nmult_;
     int nsp_;
     int nshell0_;
@@ -58,6 +60,10 @@ class Box {
     std::shared_ptr<ZMatrix> olm_ji_;
     std::shared_ptr<ZMatrix> mlm_ji_;
 
+    // M2L translations for the interaction list, computed once in FMM::init
+    std::shared_ptr<const M2LRotation> m2l_;
+    std::vector<M2LRotation::Translation> m2l_trans_;
+
     void init();
     void insert_sp(const std::vector<std::shared_ptr<const ShellPair>>&);
     void insert_child(std::weak_ptr<const Box>);
@@ -66,6 +72,7 @@ class Box {
     void get_neigh(const std::vector<std::weak_ptr<Box>>& box, const double ws);
     void get_inter(const std::vector<std::weak_ptr<Box>>& box, const double ws);
     void sort_sp();
+    void init_m2l(std::shared_ptr<const M2LRotation> m2l);
 
     std::shared_ptr<ZVectorB> olm_;
     std::shared_ptr<ZVectorB> mlm_;
@@ -92,8 +99,8 @@ class Box {
     Box() { }
     Box(int n, double size, const std::array<double, 3>& c, const int id, const std::array<int, 3>& v, const int lmax = 10,
         const int lmax_k = 10, const std::vector<std::shared_ptr<const ShellPair>>& sp = std::vector<std::shared_ptr<const ShellPair>>(),
-        const double schwarz = 0.0)
-     : rank_(n), boxsize_(size), centre_(c), boxid_(id), tvec_(v), lmax_(lmax), lmax_k_(lmax_k), sp_(sp), schwarz_thresh_(schwarz) { }
+        const double schwarz = 0.0, const bool qqr = false)
+     : rank_(n), boxsize_(size), centre_(c), boxid_(id), tvec_(v), lmax_(lmax), lmax_k_(lmax_k), sp_(sp), schwarz_thresh_(schwarz), qqr_(qqr) { }
 
     ~Box() { }
 
@@ -24,6 +24,8 @@
 //
 
 
+#include <mutex>
+#include <numeric>
 #include <src/scf/fmm/fmm.h>
 #include <src/util/taskqueue.h>
 #include <src/util/parallel/mpi_interface.h>
@@ -61,6 +63,7 @@ FMM::FMM(std::shared_ptr<const PTree> idata, shared_ptr<const Geometry> geom, co
   centre_ = geom->charge_center();
   nbasis_ = geom->nbasis();
   thresh_ = geom->schwarz_thresh();
+  qqr_ = geom->qqr();
   init();
 }
 
@@ -93,6 +96,12 @@ void FMM::init() {
   coordinates_.resize(nsp_);
 
   get_boxes();
+  assign_boxes();
+
+  // the translation operators are reused in every call of M2L
+  m2l_ = make_shared<const M2LRotation>(lmax_);
+  for (auto& b : box_)
+    b->init_m2l(m2l_);
 
   do_ff_ = false;
   for (int i = 0; i != nbranch_[0]; ++i)
@@ -157,7 +166,7 @@ void FMM::get_boxes() {
     array<double, 3> centre;
     for (int i = 0; i != 3; ++i)
       centre[i] = (id[i]-ns2/2-1)*unitsize_ + 0.5*unitsize_;
-    auto newbox = make_shared<Box>(0, unitsize_, centre, il, id, lmax_, lmax_k_, sp, thresh_);
+    auto newbox = make_shared<Box>(0, unitsize_, centre, il, id, lmax_, lmax_k_, sp, thresh_, qqr_);
     box_.insert(box_.end(), newbox);
     ++nbox;
   }
@@ -193,7 +202,7 @@ void FMM::get_boxes() {
               if (nss != 0) {
                 const double boxsize = unitsize_ * pow(2, ns_-nss+1);
                 auto newbox = make_shared<Box>(ns_-nss+1, boxsize, array<double, 3>{{0.0, 0.0, 0.0}},
-                     nbox, idxp, lmax_, lmax_k_, box_[ichild]->sp(), thresh_);
+                     nbox, idxp, lmax_, lmax_k_, box_[ichild]->sp(), thresh_, qqr_);
                 box_.insert(box_.end(), newbox);
                 treemap.insert(treemap.end(), pair<array<int, 3>,int>(idxp, nbox));
                 box_[nbox]->insert_child(box_[ichild]);
@@ -269,25 +278,74 @@ void FMM::get_boxes() {
 }
 
 
-void FMM::M2M(shared_ptr<const Matrix> density, const bool dox) const {
+void FMM::assign_boxes() {
+
+  level_offset_.assign(ns_+2, 0);
+  for (int i = 0; i != ns_+1; ++i)
+    level_offset_[i+1] = level_offset_[i] + nbranch_[i];
+  assert(level_offset_.back() == nbox_);
+
+  auto morton = [](const array<int, 3>& v) {
+    uint64_t key = 0;
+    for (int b = 0; b != 21; ++b)
+      for (int i = 0; i != 3; ++i)
+        key |= static_cast<uint64_t>((v[i] >> b) & 1) << (3*b+i);
+    return key;
+  };
+  vector<int> leaves(nbranch_[0]);
+  iota(leaves.begin(), leaves.end(), 0);
+  sort(leaves.begin(), leaves.end(), [&](const int a, const int b) { return morton(box_[a]->tvec()) < morton(box_[b]->tvec()); });
+
+  // the number of shell pairs is used as the cost of a leaf
+  owner_.assign(nbox_, 0);
+  double total = 0.0;
+  for (auto& i : leaves)
+    total += box_[i]->nsp_;
+  double acc = 0.0;
+  for (auto& i : leaves) {
+    owner_[i] = min(mpi__->size()-1, static_cast<int>(acc * mpi__->size() / max(total, 1.0)));
+    acc += box_[i]->nsp_;
+  }
+  for (int i = nbranch_[0]; i != nbox_; ++i)
+    owner_[i] = owner_[box_[i]->child_[0].lock()->boxid()];
+}
 
-  Timer m2mtime;
-  for (int i = 0; i != nbranch_[0]; ++i)
-    if (i % mpi__->size() == mpi__->rank())
-      box_[i]->compute_M2M(density);
 
-  for (int i = 0; i != nbranch_[0]; ++i)
-    mpi__->broadcast(box_[i]->olm()->data(), box_[i]->olm()->size(), i % mpi__->size());
+void FMM::allreduce_level(const int level, const bool local) const {
+
+  if (mpi__->size() == 1) return;
+  const int nmult = (lmax_+1)*(lmax_+1);
+  vector<complex<double>> buf(nbranch_[level]*nmult);
+  for (int i = 0; i != nbranch_[level]; ++i) {
+    const int ibox = level_offset_[level] + i;
+    if (owner_[ibox] == mpi__->rank())
+      copy_n((local ? box_[ibox]->mlm() : box_[ibox]->olm())->data(), nmult, buf.data() + i*nmult);
+  }
+  mpi__->allreduce(buf.data(), buf.size());
+  for (int i = 0; i != nbranch_[level]; ++i) {
+    const int ibox = level_offset_[level] + i;
+    copy_n(buf.data() + i*nmult, nmult, (local ? box_[ibox]->mlm() : box_[ibox]->olm())->data());
+  }
+}
 
-  m2mtime.tick_print("Compute multipoles");
 
-  int icnt = nbranch_[0];
-  for (int i = 1; i != ns_+1; ++i) {
-    for (int j = 0; j != nbranch_[i]; ++j, ++icnt)
-      box_[icnt]->compute_M2M(density);
+void FMM::M2M(shared_ptr<const Matrix> density, const bool dox) const {
+
+  Timer m2mtime;
+  for (int i = 0; i != ns_+1; ++i) {
+    TaskQueue<function<void(void)>> tasks(nbranch_[i]);
+    for (int ibox = level_offset_[i]; ibox != level_offset_[i+1]; ++ibox)
+      if (owner_[ibox] == mpi__->rank())
+        tasks.emplace_back(
+          [this, ibox, &density]() { box_[ibox]->compute_M2M(density); }
+        );
+    tasks.compute();
+    allreduce_level(i, false);
+
+    if (i == 0)
+      m2mtime.tick_print("Compute multipoles");
   }
   m2mtime.tick_print("M2M pass");
-  assert(icnt == nbox_);
 }
 
 
@@ -313,10 +371,12 @@ void FMM::M2L(const bool dox) const {
 
   TaskQueue<function<void(void)>> tasks(nbox_);
   if (!dox) {
-    for (auto& b : box_)
-      tasks.emplace_back(
-        [this, b]() { b->compute_M2L(); }
-      );
+    // local expansions of the other boxes are collected in the L2L pass
+    for (int i = 0; i != nbox_; ++i)
+      if (owner_[i] == mpi__->rank())
+        tasks.emplace_back(
+          [this, i]() { box_[i]->compute_M2L(); }
+        );
     tasks.compute();
     m2ltime.tick_print("M2L pass");
   } else {
@@ -337,10 +397,14 @@ void FMM::L2L(const bool dox) const {
   int icnt = 0;
   if (!dox) {
     for (int ir = ns_; ir > -1; --ir) {
-      for (int ib = 0; ib != nbranch_[ir]; ++ib)
-        box_[nbox_-icnt-nbranch_[ir]+ib]->compute_L2L();
-
-      icnt += nbranch_[ir];
+      TaskQueue<function<void(void)>> tasks(nbranch_[ir]);
+      for (int ibox = level_offset_[ir]; ibox != level_offset_[ir+1]; ++ibox)
+        if (owner_[ibox] == mpi__->rank())
+          tasks.emplace_back(
+            [this, ibox]() { box_[ibox]->compute_L2L(); }
+          );
+      tasks.compute();
+      allreduce_level(ir, true);
     }
 
     l2ltime.tick_print("L2L pass");
@@ -394,13 +458,20 @@ shared_ptr<const Matrix> FMM::compute_Fock_FMM(shared_ptr<const Matrix> density)
     }
 
     auto ff = make_shared<Matrix>(nbasis_, nbasis_);
+    TaskQueue<function<void(void)>> tasks(nbranch_[0]);
+    mutex fmutex;
     for (int i = 0; i != nbranch_[0]; ++i)
-      if (i % mpi__->size() == mpi__->rank()) {
-        auto ei = box_[i]->compute_Fock_nf(density, maxden);
-        blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
-        auto ffi = box_[i]->compute_Fock_ff(density);
-        blas::ax_plus_y_n(1.0, ffi->data(), nbasis_*nbasis_, ff->data());
-      }
+      if (owner_[i] == mpi__->rank())
+        tasks.emplace_back(
+          [this, i, &density, &maxden, &out, &ff, &fmutex]() {
+            auto ei = box_[i]->compute_Fock_nf(density, maxden);
+            auto ffi = box_[i]->compute_Fock_ff(density);
+            lock_guard<mutex> lock(fmutex);
+            blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
+            blas::ax_plus_y_n(1.0, ffi->data(), nbasis_*nbasis_, ff->data());
+          }
+        );
+    tasks.compute();
     out->allreduce();
     ff->allreduce();
 
@@ -519,11 +590,18 @@ shared_ptr<const Matrix> FMM::compute_Fock_FMM_K(shared_ptr<const Matrix> densit
       (*maxden)(i01) = denmax;
     }
 
+    TaskQueue<function<void(void)>> tasks(nbranch_[0]);
+    mutex kmutex;
     for (int i = 0; i != nbranch_[0]; ++i)
-      if (i % mpi__->size() == mpi__->rank()) {
-        auto ei = box_[i]->compute_Fock_nf_K(density, maxden);
-        blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
-      }
+      if (owner_[i] == mpi__->rank())
+        tasks.emplace_back(
+          [this, i, &density, &maxden, &out, &kmutex]() {
+            auto ei = box_[i]->compute_Fock_nf_K(density, maxden);
+            lock_guard<mutex> lock(kmutex);
+            blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
+          }
+        );
+    tasks.compute();
     out->allreduce();
 
     for (int i = 0; i != nbasis_; ++i) out->element(i, i) *= 2.0;
@@ -571,19 +649,36 @@ shared_ptr<const Matrix> FMM::compute_Fock_FMM_J(shared_ptr<const Matrix> densit
     }
 
     auto ff = make_shared<Matrix>(nbasis_, nbasis_);
-    for (int i = 0; i != nbranch_[0]; ++i)
-      if (i % mpi__->size() == mpi__->rank()) {
-        auto ffi = box_[i]->compute_Fock_ff(density);
-        blas::ax_plus_y_n(1.0, ffi->data(), nbasis_*nbasis_, ff->data());
-      }
+    mutex jmutex;
+    {
+      TaskQueue<function<void(void)>> tasks(nbranch_[0]);
+      for (int i = 0; i != nbranch_[0]; ++i)
+        if (owner_[i] == mpi__->rank())
+          tasks.emplace_back(
+            [this, i, &density, &ff, &jmutex]() {
+              auto ffi = box_[i]->compute_Fock_ff(density);
+              lock_guard<mutex> lock(jmutex);
+              blas::ax_plus_y_n(1.0, ffi->data(), nbasis_*nbasis_, ff->data());
+            }
+          );
+      tasks.compute();
+    }
     ff->allreduce();
     fmmtime.tick_print("FMM-J");
 
-    for (int i = 0; i != nbranch_[0]; ++i)
-      if (i % mpi__->size() == mpi__->rank()) {
-        auto ei = box_[i]->compute_Fock_nf_J(density, maxden);
-        blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
-      }
+    {
+      TaskQueue<function<void(void)>> tasks(nbranch_[0]);
+      for (int i = 0; i != nbranch_[0]; ++i)
+        if (owner_[i] == mpi__->rank())
+          tasks.emplace_back(
+            [this, i, &density, &maxden, &out, &jmutex]() {
+              auto ei = box_[i]->compute_Fock_nf_J(density, maxden);
+              lock_guard<mutex> lock(jmutex);
+              blas::ax_plus_y_n(1.0, ei->data(), nbasis_*nbasis_, out->data());
+            }
+          );
+      tasks.compute();
+    }
     out->allreduce();
 
     const double enj = 0.5*density->dot_product(*ff);
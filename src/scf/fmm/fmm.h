@@ -47,15 +47,26 @@ class FMM {
     std::shared_ptr<const FMMInfo> geomdata_;
 
     std::vector<std::shared_ptr<Box>> box_;
+    std::shared_ptr<const M2LRotation> m2l_;
+    // process that computes each box: leaves are split into contiguous chunks along a Morton curve,
+    // and a parent is owned by the owner of its first child
+    std::vector<int> owner_;
+    // box_ is ordered from the leaves to the root; boxes at level i are [level_offset_[i], level_offset_[i+1])
+    std::vector<int> level_offset_;
     double ws_;
     bool do_exchange_;
     int lmax_k_;
     bool debug_;
     int xbatchsize_;
     double thresh_;
+    // QQR screening of the near-field integrals (see Geometry::qqr)
+    bool qqr_;
 
     void init();
     void get_boxes();
+    void assign_boxes();
+    // collects the multipoles (or local expansions) of the boxes at a level from their owners in one collective
+    void allreduce_level(const int level, const bool local) const;
     void M2M(std::shared_ptr<const Matrix> mat, const bool do_exchange = false) const;
     void M2M_X(std::shared_ptr<const Matrix> ocoeff_sj, std::shared_ptr<const Matrix> ocoeff_ui) const;
     void M2L(const bool do_exchange = false) const;
@@ -66,13 +77,16 @@ class FMM {
     template<class Archive>
     void save(Archive& ar, const unsigned int) const {
       ar << ns_ << lmax_ << ws_ << do_exchange_ << lmax_k_ << debug_ << xbatchsize_ << geomdata_
-         << centre_ << nbasis_ << thresh_;
+         << centre_ << nbasis_ << thresh_ << qqr_;
     }
 
     template<class Archive>
-    void load(Archive& ar, const unsigned int) {
+    void load(Archive& ar, const unsigned int version) {
       ar >> ns_ >> lmax_ >> ws_ >> do_exchange_ >> lmax_k_ >> debug_ >> xbatchsize_ >> geomdata_
          >> centre_ >> nbasis_ >> thresh_;
+      qqr_ = false;
+      if (version > 0)
+        ar >> qqr_;
       init();
     }
 
@@ -95,4 +109,8 @@ class FMM {
 };
 
 }
+
+#include <boost/serialization/version.hpp>
+BOOST_CLASS_VERSION(bagel::FMM, 1)
+
 #endif
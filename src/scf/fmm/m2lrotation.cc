@@ -0,0 +1,150 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: m2lrotation.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <src/scf/fmm/m2lrotation.h>
+#include <src/util/math/legendre.h>
+
+using namespace std;
+using namespace bagel;
+
+const static Legendre plm;
+
+M2LRotation::M2LRotation(const int lmax) : lmax_(lmax) {
+  const int nmult = (lmax_+1)*(lmax_+1);
+
+  factorial_.resize(2*lmax_+1, 1.0);
+  for (int i = 1; i <= 2*lmax_; ++i)
+    factorial_[i] = factorial_[i-1] * i;
+
+  scale_.resize(nmult);
+  for (int l = 0; l <= lmax_; ++l)
+    for (int m = -l; m <= l; ++m)
+      scale_[l*l+l+m] = sqrt(factorial_[l-abs(m)] * factorial_[l+abs(m)]);
+
+  // see Box::shift_localMX with r12 along z
+  zcoeff_.resize((lmax_+1)*(lmax_+1)*(2*lmax_+1));
+  for (int l = 0; l <= lmax_; ++l)
+    for (int j = 0; j <= lmax_; ++j)
+      for (int m = -min(l,j); m <= min(l,j); ++m)
+        zcoeff_[zindex(l, j, m)] = (1-((l&1)<<1)) * factorial_[l+j] / (scale_[l*l+l+m] * scale_[j*j+j-m]);
+
+  // R_x(pi/2) maps (x,y,z) to (x,-z,y). Its representation is fitted on a Fibonacci lattice on the unit sphere.
+  for (int l = 0; l <= lmax_; ++l) {
+    const int n = 2*l+1;
+    const int npts = 2*n+2;
+    ZMatrix ux(n, npts);
+    ZMatrix uq(n, npts);
+    for (int s = 0; s != npts; ++s) {
+      const double z = 1.0 - (2.0*s+1.0)/npts;
+      const double rho = sqrt(1.0 - z*z);
+      const double ang = s * pi__ * (3.0 - sqrt(5.0));
+      const array<double,3> x{{rho*cos(ang), rho*sin(ang), z}};
+      harmonics(l, x, ux.element_ptr(0, s));
+      harmonics(l, array<double,3>{{x[0], -x[2], x[1]}}, uq.element_ptr(0, s));
+    }
+    ZMatrix gram = ux ^ ux;
+    gram.inverse();
+    auto rot = make_shared<ZMatrix>((uq ^ ux) * gram);
+    auto rotinv = rot->copy();
+    rotinv->inverse();
+    rot_.push_back(rot);
+    rotinv_.push_back(rotinv);
+  }
+}
+
+
+void M2LRotation::harmonics(const int l, const array<double,3>& x, complex<double>* out) const {
+  const double phi = atan2(x[1], x[0]);
+  for (int m = -l; m <= l; ++m) {
+    const double sign = (m >= 0) ? 1.0 : (1-((m&1)<<1));
+    const double value = sign * plm.compute(l, abs(m), x[2]) * scale_[l*l+l+m] / factorial_[l+abs(m)];
+    out[m+l] = complex<double>(value*cos(m*phi), -value*sin(m*phi));
+  }
+}
+
+
+M2LRotation::Translation M2LRotation::translation(const array<double,3>& r12) const {
+  const double r = sqrt(r12[0]*r12[0] + r12[1]*r12[1] + r12[2]*r12[2]);
+  assert(r > numerical_zero__);
+  const double theta = acos(max(-1.0, min(1.0, r12[2]/r)));
+  const double phi = atan2(r12[1], r12[0]);
+
+  Translation out;
+  out.theta.resize(2*lmax_+1);
+  out.phi.resize(2*lmax_+1);
+  for (int k = -lmax_; k <= lmax_; ++k) {
+    out.theta[k+lmax_] = complex<double>(cos(k*theta), sin(k*theta));
+    out.phi[k+lmax_] = complex<double>(cos(k*phi), sin(k*phi));
+  }
+  out.radial.resize(2*lmax_+1);
+  out.radial[0] = 1.0 / r;
+  for (int a = 1; a <= 2*lmax_; ++a)
+    out.radial[a] = out.radial[a-1] / r;
+  return out;
+}
+
+
+void M2LRotation::compute(const Translation& t, const complex<double>* olm, complex<double>* mlm) const {
+  const int nmult = (lmax_+1)*(lmax_+1);
+  const complex<double>* theta = t.theta.data() + lmax_;
+  const complex<double>* phi = t.phi.data() + lmax_;
+  unique_ptr<complex<double>[]> x(new complex<double>[nmult]);
+  unique_ptr<complex<double>[]> z(new complex<double>[nmult]);
+  unique_ptr<complex<double>[]> y(new complex<double>[2*lmax_+1]);
+
+  // rotation to the frame in which r12 is along z: R_y(-theta) R_z(-phi)
+  for (int l = 0; l <= lmax_; ++l) {
+    const int n = 2*l+1;
+    complex<double>* xl = x.get() + l*l;
+    for (int m = -l; m <= l; ++m)
+      xl[m+l] = olm[l*l+l+m] * scale_[l*l+l+m] * phi[m];
+    zgemv_("N", n, n, 1.0, rot_[l]->data(), n, xl, 1, 0.0, y.get(), 1);
+    for (int m = -l; m <= l; ++m)
+      y[m+l] *= theta[m];
+    zgemv_("N", n, n, 1.0, rotinv_[l]->data(), n, y.get(), 1, 0.0, xl, 1);
+  }
+
+  // translation along z couples (j,-m) and (l,m) only
+  fill_n(z.get(), nmult, 0.0);
+  for (int l = 0; l <= lmax_; ++l)
+    for (int m = -l; m <= l; ++m) {
+      complex<double> sum = 0.0;
+      for (int j = abs(m); j <= lmax_; ++j)
+        sum += zcoeff_[zindex(l, j, m)] * t.radial[l+j] * x[j*j+j-m];
+      z[l*l+l+m] = sum;
+    }
+
+  // transpose of the rotation above, since the local expansions are contracted with the multipoles
+  for (int l = 0; l <= lmax_; ++l) {
+    const int n = 2*l+1;
+    complex<double>* zl = z.get() + l*l;
+    zgemv_("T", n, n, 1.0, rotinv_[l]->data(), n, zl, 1, 0.0, y.get(), 1);
+    for (int m = -l; m <= l; ++m)
+      y[m+l] *= theta[m];
+    zgemv_("T", n, n, 1.0, rot_[l]->data(), n, y.get(), 1, 0.0, zl, 1);
+    for (int m = -l; m <= l; ++m)
+      mlm[l*l+l+m] += zl[m+l] * scale_[l*l+l+m] * phi[m];
+  }
+}
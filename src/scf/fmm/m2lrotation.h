@@ -0,0 +1,71 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: m2lrotation.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_SCF_FMM_M2LROTATION_H
+#define __SRC_SCF_FMM_M2LROTATION_H
+
+#include <src/util/math/matop.h>
+
+namespace bagel {
+
+// M2L translation in O(L^3) per box pair: the multipoles are rotated such that the translation vector is along z,
+// translated along z (which is diagonal in m), and rotated back. The rotation about the y axis is computed as
+// R_x(pi/2)^-1 R_z R_x(pi/2), where the matrices representing R_x(pi/2) are computed once per l.
+class M2LRotation {
+  public:
+    // quantities that depend on the translation vector (computed once per box pair)
+    struct Translation {
+      std::vector<std::complex<double>> theta; // exp(i k theta) for k = -lmax..lmax
+      std::vector<std::complex<double>> phi;   // exp(i k phi) for k = -lmax..lmax
+      std::vector<double> radial;              // r^-(a+1) for a = 0..2lmax
+    };
+
+  protected:
+    const int lmax_;
+    // representation of R_x(pi/2) and its inverse for each l, in the basis of the normalized harmonics
+    std::vector<std::shared_ptr<const ZMatrix>> rot_;
+    std::vector<std::shared_ptr<const ZMatrix>> rotinv_;
+    std::vector<double> factorial_;
+    // ratio between the normalized harmonics and those used for the multipoles, sqrt((l-|m|)!(l+|m|)!)
+    std::vector<double> scale_;
+    // translation along z from (j,-m) to (l,m) without the radial part, indexed by l, j and m
+    std::vector<double> zcoeff_;
+
+    void harmonics(const int l, const std::array<double,3>& x, std::complex<double>* out) const;
+    size_t zindex(const int l, const int j, const int m) const { return ((l*(lmax_+1))+j)*(2*lmax_+1) + m+lmax_; }
+
+  public:
+    M2LRotation(const int lmax);
+
+    Translation translation(const std::array<double,3>& r12) const;
+    // adds the local expansion generated by the multipoles olm to mlm
+    void compute(const Translation& t, const std::complex<double>* olm, std::complex<double>* mlm) const;
+
+    int lmax() const { return lmax_; }
+};
+
+}
+
+#endif
@@ -23,110 +23,131 @@
 //
 
 #include <src/scf/hf/fock.h>
+#include <src/molecule/shellpair.h>
+#include <src/util/taskqueue.h>
 
-using namespace std;
-using namespace bagel;
+namespace bagel {
 
+// Accumulators for the two-electron part, one per thread. Handed out in the same way as StackMem in Resources.
+class FockAccumulator {
+  protected:
+    const int ndim_;
+    std::vector<std::shared_ptr<Matrix>> mat_;
+    std::unique_ptr<std::atomic_flag[]> flag_;
 
-// Non-DF Fock matrix, standard basis
-template <>
-void Fock<0>::fock_two_electron_part(shared_ptr<const Matrix> den) {
-  const vector<shared_ptr<const Atom>> atoms = geom_->atoms();
-  vector<shared_ptr<const Shell>> basis;
-  vector<int> offset;
-  int cnt = 0;
-  for (auto aiter = atoms.begin(); aiter != atoms.end(); ++aiter, ++cnt) {
-    const vector<shared_ptr<const Shell>> tmp = (*aiter)->shells();
-    basis.insert(basis.end(), tmp.begin(), tmp.end());
-    const vector<int> tmpoff = geom_->offset(cnt);
-    offset.insert(offset.end(), tmpoff.begin(), tmpoff.end());
-  }
-
-  const int shift = sizeof(int) * 4;
-  const int size = basis.size();
-
-  // first make max_density_change vector for each batch pair.
-  const double* density_data = density_->data();
-
-  vector<double> max_density_change(size * size);
-  for (int i = 0; i != size; ++i) {
-    const int ioffset = offset[i];
-    const int isize = basis[i]->nbasis();
-    for (int j = i; j != size; ++j) {
-      const int joffset = offset[j];
-      const int jsize = basis[j]->nbasis();
+  public:
+    FockAccumulator(const int n, const int ndim) : ndim_(ndim), mat_(n), flag_(new std::atomic_flag[n]) {
+      for (int i = 0; i != n; ++i) flag_[i].clear();
+    }
 
-      double cmax = 0.0;
-      for (int ii = ioffset; ii != ioffset + isize; ++ii) {
-        const int iin = ii * ndim();
-        for (int jj = joffset; jj != joffset + jsize; ++jj) {
-          cmax = max(cmax, fabs(density_data[iin + jj]));
-        }
-      }
-      const int ij = i * size + j;
-      const int ji = j * size + i;
-      max_density_change[ij] = cmax;
-      max_density_change[ji] = cmax;
+    int get() {
+      while (true)
+        for (int i = 0; i != mat_.size(); ++i)
+          if (!flag_[i].test_and_set()) {
+            // allocated when first used, so that idle threads do not cost memory
+            if (!mat_[i]) mat_[i] = std::make_shared<Matrix>(ndim_, ndim_);
+            return i;
+          }
     }
-  }
+    void release(const int i) { flag_[i].clear(); }
+    double* data(const int i) { return mat_[i]->data(); }
 
-  ////////////////////////////////////////////
-  // starting 2-e Fock matrix evaluation!
-  ////////////////////////////////////////////
-  //////////////// ONLY FOR REFERENCES. //////////////////
+    void sum(Matrix& out) const {
+      for (auto& i : mat_)
+        if (i) out += *i;
+    }
+};
+
+
+// all the shell quartets with a given bra shell pair (i0, i1)
+class FockTask {
+  protected:
+    const std::vector<std::shared_ptr<const Shell>>& basis_;
+    const std::vector<int>& offset_;
+    const std::vector<double>& schwarz_;
+    // shell pairs (i0 <= i1) for the distance-including screening; nullptr if it is switched off
+    const std::vector<std::shared_ptr<const ShellPair>>* pairs_;
+    const std::vector<double>& max_density_change_;
+    const double* const density_data_;
+    const double schwarz_thresh_;
+    const int ndim_;
+    const int i0_;
+    const int i1_;
+    FockAccumulator* accum_;
+    // when symmetry is used, only unique quartets are computed with weights
+    const Petite* plist_;
+
+  public:
+    FockTask(const std::vector<std::shared_ptr<const Shell>>& b, const std::vector<int>& o, const std::vector<double>& s,
+             const std::vector<std::shared_ptr<const ShellPair>>* sp, const std::vector<double>& m,
+             const double* d, const double t, const int n, const int i0, const int i1, FockAccumulator* a, const Petite* p)
+     : basis_(b), offset_(o), schwarz_(s), pairs_(sp), max_density_change_(m), density_data_(d), schwarz_thresh_(t), ndim_(n), i0_(i0), i1_(i1),
+       accum_(a), plist_(p) { }
+
+    // rough estimate of the cost, used by TaskQueue for load balancing
+    double cost() const {
+      const int nket = basis_.size() - i0_;
+      return static_cast<double>(basis_[i0_]->nbasis() * basis_[i0_]->num_primitive()) * basis_[i1_]->nbasis() * basis_[i1_]->num_primitive() * nket * (nket+1) / 2;
+    }
 
-  for (int i0 = 0; i0 != size; ++i0) {
-    const shared_ptr<const Shell>  b0 = basis[i0];
-    const int b0offset = offset[i0];
-    const int b0size = b0->nbasis();
-    for (int i1 = i0; i1 != size; ++i1) {
+    void compute() {
+      const int shift = sizeof(int) * 4;
+      const int size = basis_.size();
+      const int islot = accum_->get();
+      double* const fock = accum_->data(islot);
+      const double* const density_data = density_data_;
+      const int ndim = ndim_;
+
+      const int i0 = i0_;
+      const int i1 = i1_;
+      const std::shared_ptr<const Shell>  b0 = basis_[i0];
+      const int b0offset = offset_[i0];
+      const int b0size = b0->nbasis();
       const unsigned int i01 = i0 *size + i1;
 
-      const shared_ptr<const Shell>  b1 = basis[i1];
-      const int b1offset = offset[i1];
+      const std::shared_ptr<const Shell>  b1 = basis_[i1];
+      const int b1offset = offset_[i1];
       const int b1size = b1->nbasis();
 
-      const double density_change_01 = max_density_change[i01] * 4.0;
+      const double density_change_01 = max_density_change_[i01] * 4.0;
 
       for (int i2 = i0; i2 != size; ++i2) {
-        const shared_ptr<const Shell>  b2 = basis[i2];
-        const int b2offset = offset[i2];
+        const std::shared_ptr<const Shell>  b2 = basis_[i2];
+        const int b2offset = offset_[i2];
         const int b2size = b2->nbasis();
 
-        const double density_change_02 = max_density_change[i0 * size + i2];
-        const double density_change_12 = max_density_change[i1 * size + i2];
+        const double density_change_02 = max_density_change_[i0 * size + i2];
+        const double density_change_12 = max_density_change_[i1 * size + i2];
 
         for (int i3 = i2; i3 != size; ++i3) {
           const unsigned int i23 = i2 * size + i3;
           if (i23 < i01) continue;
+          const int weight = plist_ ? plist_->in_p4(i01, i23, i0, i1, i2, i3) : 1;
+          if (weight == 0) continue;
 
-          const double density_change_23 = max_density_change[i2 * size + i3] * 4.0;
-          const double density_change_03 = max_density_change[i0 * size + i2];
-          const double density_change_13 = max_density_change[i0 * size + i2];
+          const double density_change_23 = max_density_change_[i2 * size + i3] * 4.0;
+          const double density_change_03 = max_density_change_[i0 * size + i3];
+          const double density_change_13 = max_density_change_[i1 * size + i3];
 
           const bool eqli01i23 = (i01 == i23);
 
-          const shared_ptr<const Shell>  b3 = basis[i3];
-          const int b3offset = offset[i3];
+          const std::shared_ptr<const Shell>  b3 = basis_[i3];
+          const int b3offset = offset_[i3];
           const int b3size = b3->nbasis();
 
-          const double mulfactor = max(max(max(density_change_01, density_change_02),
-                                           max(density_change_12, density_change_23)),
-                                           max(density_change_03, density_change_13));
-          const double integral_bound = mulfactor * schwarz_[i01] * schwarz_[i23];
+          const double mulfactor = std::max(std::max(std::max(density_change_01, density_change_02),
+                                                     std::max(density_change_12, density_change_23)),
+                                                     std::max(density_change_03, density_change_13));
+          const double integral_bound = mulfactor * schwarz_[i01] * schwarz_[i23] * (pairs_ ? (*pairs_)[i01]->qqr(*(*pairs_)[i23]) : 1.0);
           const bool skip_schwarz = integral_bound < schwarz_thresh_;
           if (skip_schwarz) continue;
 
-          array<shared_ptr<const Shell>,4> input = {{b3, b2, b1, b0}};
-#ifdef LIBINT_INTERFACE
-          Libint eribatch(input);
-#else
-          ERIBatch eribatch(input, mulfactor);
-#endif
+          std::array<std::shared_ptr<const Shell>,4> input = {{b3, b2, b1, b0}};
+          AutoERIBatch eribatch(input, mulfactor);
           eribatch.compute();
           const double* eridata = eribatch.data();
           for (int j0 = b0offset; j0 != b0offset + b0size; ++j0) {
-            const int j0n = j0 * ndim();
+            const int j0n = j0 * ndim;
 
             for (int j1 = b1offset; j1 != b1offset + b1size; ++j1) {
               const unsigned int nj01 = (j0 << shift) + j1;
@@ -138,15 +159,15 @@ void Fock<0>::fock_two_electron_part(shared_ptr<const Matrix> den) {
 
               const bool eqlj0j1 = (j0 == j1);
               const double scal01 = (eqlj0j1 ? 0.5 : 1.0);
-              const int j1n = j1 * ndim();
+              const int j1n = j1 * ndim;
 
               for (int j2 = b2offset; j2 != b2offset + b2size; ++j2) {
-                const int maxj1j2 = max(j1, j2);
-                const int minj1j2 = min(j1, j2);
+                const int maxj1j2 = std::max(j1, j2);
+                const int minj1j2 = std::min(j1, j2);
 
-                const int maxj0j2 = max(j0, j2);
-                const int minj0j2 = min(j0, j2);
-                const int j2n = j2 * ndim();
+                const int maxj0j2 = std::max(j0, j2);
+                const int minj0j2 = std::min(j0, j2);
+                const int j2n = j2 * ndim;
 
                 for (int j3 = b3offset; j3 != b3offset + b3size; ++j3, ++eridata) {
                   const bool skipj2j3 = (j2 > j3);
@@ -155,29 +176,116 @@ void Fock<0>::fock_two_electron_part(shared_ptr<const Matrix> den) {
 
                   if (skipj2j3 || skipj01j23) continue;
 
-                  const int maxj1j3 = max(j1, j3);
-                  const int minj1j3 = min(j1, j3);
+                  const int maxj1j3 = std::max(j1, j3);
+                  const int minj1j3 = std::min(j1, j3);
 
-                  double intval = *eridata * scal01 * (j2 == j3 ? 0.5 : 1.0) * (nj01 == nj23 ? 0.25 : 0.5); // 1/2 in the Hamiltonian absorbed here
+                  double intval = *eridata * weight * scal01 * (j2 == j3 ? 0.5 : 1.0) * (nj01 == nj23 ? 0.25 : 0.5); // 1/2 in the Hamiltonian absorbed here
                   const double intval4 = 4.0 * intval;
 
-                  element(j1, j0) += density_data[j2n + j3] * intval4;
-                  element(j3, j2) += density_data[j0n + j1] * intval4;
-                  element(j3, j0) -= density_data[j1n + j2] * intval;
-                  element(maxj1j2, minj1j2) -= density_data[j0n + j3] * intval;
-                  element(maxj0j2, minj0j2) -= density_data[j1n + j3] * intval;
-                  element(maxj1j3, minj1j3) -= density_data[j0n + j2] * intval;
+                  fock[j1 + j0n] += density_data[j2n + j3] * intval4;
+                  fock[j3 + j2n] += density_data[j0n + j1] * intval4;
+                  fock[j3 + j0n] -= density_data[j1n + j2] * intval;
+                  fock[maxj1j2 + minj1j2 * ndim] -= density_data[j0n + j3] * intval;
+                  fock[maxj0j2 + minj0j2 * ndim] -= density_data[j1n + j3] * intval;
+                  fock[maxj1j3 + minj1j3 * ndim] -= density_data[j0n + j2] * intval;
                 }
               }
             }
           }
+        }
+      }
+      accum_->release(islot);
+    }
+};
 
+}
+
+using namespace std;
+using namespace bagel;
+
+
+// Non-DF Fock matrix, standard basis. When density_ is a density change, the previous Fock matrix is updated incrementally
+// and the screening based on max_density_change skips most of the quartets in later iterations.
+template <>
+void Fock<0>::fock_two_electron_part(shared_ptr<const Matrix> den) {
+  const vector<shared_ptr<const Atom>> atoms = geom_->atoms();
+  vector<shared_ptr<const Shell>> basis;
+  vector<int> offset;
+  int cnt = 0;
+  for (auto aiter = atoms.begin(); aiter != atoms.end(); ++aiter, ++cnt) {
+    const vector<shared_ptr<const Shell>> tmp = (*aiter)->shells();
+    basis.insert(basis.end(), tmp.begin(), tmp.end());
+    const vector<int> tmpoff = geom_->offset(cnt);
+    offset.insert(offset.end(), tmpoff.begin(), tmpoff.end());
+  }
+
+  const int size = basis.size();
+
+  // first make max_density_change vector for each batch pair.
+  const double* density_data = density_->data();
+
+  vector<double> max_density_change(size * size);
+  for (int i = 0; i != size; ++i) {
+    const int ioffset = offset[i];
+    const int isize = basis[i]->nbasis();
+    for (int j = i; j != size; ++j) {
+      const int joffset = offset[j];
+      const int jsize = basis[j]->nbasis();
+
+      double cmax = 0.0;
+      for (int ii = ioffset; ii != ioffset + isize; ++ii) {
+        const int iin = ii * ndim();
+        for (int jj = joffset; jj != joffset + jsize; ++jj) {
+          cmax = max(cmax, fabs(density_data[iin + jj]));
         }
       }
+      const int ij = i * size + j;
+      const int ji = j * size + i;
+      max_density_change[ij] = cmax;
+      max_density_change[ji] = cmax;
     }
   }
+  const double max_density = *max_element(max_density_change.begin(), max_density_change.end()) * 4.0;
+  const double max_schwarz = *max_element(schwarz_.begin(), schwarz_.end());
+
+  // the skeleton matrix from the symmetry-unique quartets is symmetrized at the end, which requires a totally symmetric density
+  shared_ptr<const Petite> plist = geom_->plist();
+  if (plist && !plist->is_symmetric(*density_, 1.0e-8))
+    plist.reset();
+
+  ////////////////////////////////////////////
+  // starting 2-e Fock matrix evaluation!
+  ////////////////////////////////////////////
+  // bra shell pairs are distributed over MPI processes, and threads accumulate into their own matrices
+
+  // centres and extents of the shell pairs for the QQR screening, usually made once in SCF together with the Schwarz factors
+  if (geom_->qqr() && !shellpairs_)
+    shellpairs_ = make_shared<const vector<shared_ptr<const ShellPair>>>(geom_->shellpairs(schwarz_));
+  const vector<shared_ptr<const ShellPair>>* pairs = geom_->qqr() ? shellpairs_.get() : nullptr;
+
+  FockAccumulator accum(resources__->max_num_threads(), ndim());
+  TaskQueue<FockTask> tasks(size*(size+1)/2/mpi__->size()+1);
+
+  int ntask = 0;
+  for (int i0 = 0; i0 != size; ++i0)
+    for (int i1 = i0; i1 != size; ++i1) {
+      if (schwarz_[i0*size+i1] * max_schwarz * max_density < schwarz_thresh_) continue;
+      if (plist && !plist->in_p2(i0*size+i1)) continue;
+      if (ntask++ % mpi__->size() != mpi__->rank()) continue;
+      tasks.emplace_back(basis, offset, schwarz_, pairs, max_density_change, density_data, schwarz_thresh_, ndim(), i0, i1, &accum, plist.get());
+    }
+  tasks.compute();
+
+  accum.sum(*this);
+  allreduce();
+
   for (int i = 0; i != ndim(); ++i) element(i, i) *= 2.0;
   fill_upper();
+
+  if (plist) {
+    shared_ptr<const Matrix> sym = plist->symmetrize(*this);
+    copy_n(sym->data(), ndim()*mdim(), data());
+  }
 }
 
 
@@ -227,14 +335,29 @@ void Fock<DF>::fock_two_electron_part(shared_ptr<const Matrix> den_ex) {
 
 
 template<int DF>
-void Fock<DF>::fock_two_electron_part_with_coeff(const MatView ocoeff, const bool rhf, const double scale_exchange, const double scale_coulomb) {
+void Fock<DF>::fock_two_electron_part_with_coeff(const MatView ocoeff, const bool rhf, const double scale_exchange, const double scale_coulomb, shared_ptr<LocalExchange> local_ex) {
   if (DF == 0) throw logic_error("Fock<DF>::fock_two_electron_part_with_coeff() is only for DF cases");
 
   Timer pdebug(3);
 
   shared_ptr<const DFDist> df = geom_->df();
 
-  if (scale_exchange != 0.0) {
+  // half-transformed integrals are not formed with local exchange; they are needed for gradients
+  if (scale_exchange != 0.0 && local_ex && !store_half_ && LocalExchange::available(df)) {
+    *this += *local_ex->compute(ocoeff, -1.0*scale_exchange);
+    pdebug.tick_print("Local exchange build");
+
+    if (rhf) {
+      Matrix oc(ocoeff);
+      auto den = make_shared<const Matrix>((oc ^ oc) * (2.0*scale_coulomb));
+      *this += *df->compute_Jop(den);
+    } else {
+      shared_ptr<Matrix> jop = df->compute_Jop(density_);
+      if (scale_coulomb != 1.0)
+        jop->scale(scale_coulomb);
+      *this += *jop;
+    }
+  } else if (scale_exchange != 0.0) {
     shared_ptr<DFHalfDist> halfbj = df->compute_half_transform(ocoeff);
     pdebug.tick_print("First index transform");
 
@@ -27,9 +27,9 @@
 #define __BAGEL_SRC_SCF_FOCK_H
 
 #include <src/df/df.h>
-#include <src/integral/libint/libint.h>
-#include <src/integral/rys/eribatch.h>
+#include <src/integral/eribackend.h>
 #include <src/scf/hf/fock_base.h>
+#include <src/scf/hf/localexchange.h>
 
 namespace bagel {
 
@@ -37,12 +37,15 @@ template<int DF>
 class Fock : public Fock_base {
   protected:
     void fock_two_electron_part(std::shared_ptr<const Matrix> den = nullptr);
-    void fock_two_electron_part_with_coeff(const MatView coeff, const bool rhf, const double scale_ex, const double scale_coulomb);
+    void fock_two_electron_part_with_coeff(const MatView coeff, const bool rhf, const double scale_ex, const double scale_coulomb, std::shared_ptr<LocalExchange> local_ex);
 
     // when DF gradients are requested
     bool store_half_;
     std::shared_ptr<DFHalfDist> half_;
 
+    // shell pairs for the QQR screening in non-DF builds (see Geometry::shellpairs); made on the fly if not given
+    std::shared_ptr<const std::vector<std::shared_ptr<const ShellPair>>> shellpairs_;
+
   private:
     // serialization
     friend class boost::serialization::access;
@@ -53,31 +56,35 @@ class Fock : public Fock_base {
 
   public:
     Fock() { }
-    // Fock operator for DF cases
+    // Fock operator for DF cases. If local_ex is given, exchange is computed with localized orbitals
     template<int DF1 = DF, class = typename std::enable_if<DF1==1>::type>
     Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den,
-         const MatView ocoeff, const bool store = false, const bool rhf = false, const double scale_ex = 1.0, const double scale_coulomb = 1.0)
+         const MatView ocoeff, const bool store = false, const bool rhf = false, const double scale_ex = 1.0, const double scale_coulomb = 1.0,
+         std::shared_ptr<LocalExchange> local_ex = nullptr)
      : Fock_base(a,prev,den), store_half_(store) {
-      fock_two_electron_part_with_coeff(ocoeff, rhf, scale_ex, scale_coulomb);
+      fock_two_electron_part_with_coeff(ocoeff, rhf, scale_ex, scale_coulomb, local_ex);
       fock_one_electron_part();
     }
     // the same as above.
     template<typename T, class = typename std::enable_if<btas::is_boxtensor<T>::value>::type>
     Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den,
-         std::shared_ptr<T> ocoeff, const bool store = false, const bool rhf = false, const double scale_ex = 1.0, const double scale_coulomb = 1.0)
-     : Fock(a,prev,den,*ocoeff,store,rhf,scale_ex,scale_coulomb) {
+         std::shared_ptr<T> ocoeff, const bool store = false, const bool rhf = false, const double scale_ex = 1.0, const double scale_coulomb = 1.0,
+         std::shared_ptr<LocalExchange> local_ex = nullptr)
+     : Fock(a,prev,den,*ocoeff,store,rhf,scale_ex,scale_coulomb,local_ex) {
     }
 
     // Fock operator
     template<int DF1 = DF, class = typename std::enable_if<DF1==1 or DF1==0>::type>
-    Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den, const std::vector<double>& d)
-     : Fock(a,prev,den,den,d) {
+    Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den, const std::vector<double>& d,
+         std::shared_ptr<const std::vector<std::shared_ptr<const ShellPair>>> sp = nullptr)
+     : Fock(a,prev,den,den,d,sp) {
     }
 
     // Fock operator with a different density matrix for exchange
     template<int DF1 = DF, class = typename std::enable_if<DF1==1 or DF1==0>::type>
-    Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den, std::shared_ptr<const Matrix> ex, const std::vector<double>& d)
-     : Fock_base(a,prev,den,d), store_half_(false) {
+    Fock(std::shared_ptr<const Geometry> a, std::shared_ptr<const Matrix> prev, std::shared_ptr<const Matrix> den, std::shared_ptr<const Matrix> ex, const std::vector<double>& d,
+         std::shared_ptr<const std::vector<std::shared_ptr<const ShellPair>>> sp = nullptr)
+     : Fock_base(a,prev,den,d), store_half_(false), shellpairs_(sp) {
       fock_two_electron_part(ex);
       fock_one_electron_part();
     }
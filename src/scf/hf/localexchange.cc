@@ -0,0 +1,166 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: localexchange.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <src/scf/hf/localexchange.h>
+#include <src/wfn/localization.h>
+#include <src/mat1e/overlap.h>
+#include <src/util/muffle.h>
+
+using namespace std;
+using namespace bagel;
+
+LocalExchange::LocalExchange(shared_ptr<const Geometry> geom, const double thresh)
+ : geom_(geom), overlap_(make_shared<Overlap>(geom)), thresh_(thresh) {
+}
+
+
+shared_ptr<Matrix> LocalExchange::localize(const MatView ocoeff) {
+  auto coeff = make_shared<Matrix>(ocoeff);
+  if (coeff->mdim() < 2)
+    return coeff;
+  // exchange is invariant to the rotation among the orbitals. Output is suppressed as this is called in every Fock build
+  Muffle hide;
+  if (previous_ && previous_->ndim() == coeff->ndim() && previous_->mdim() == coeff->mdim()) {
+    // the previous localized orbitals projected onto the current occupied space and orthonormalized
+    auto u = make_shared<Matrix>(*coeff % *overlap_ * *previous_);
+    Matrix uu = *u % *u;
+    if (uu.inverse_half())
+      coeff = make_shared<Matrix>(*coeff * (*u * uu));
+  }
+  PMLocalization pm(make_shared<const PTree>(), geom_, coeff, vector<pair<int,int>>{{0, coeff->mdim()}});
+  shared_ptr<Matrix> out = pm.localize();
+  previous_ = out;
+  return out;
+}
+
+
+shared_ptr<Matrix> LocalExchange::compute(const MatView ocoeff, const double a) {
+  shared_ptr<const DFDist> df = geom_->df();
+  assert(available(df));
+  const size_t nbasis = df->nbasis0();
+  const int nocc = ocoeff.mdim();
+  auto out = make_shared<Matrix>(nbasis, nbasis);
+  if (nocc == 0)
+    return out;
+
+  shared_ptr<const Matrix> coeff = localize(ocoeff);
+  shared_ptr<const DFBlock> block = df->block(0);
+  const size_t naux = block->asize();
+
+  // orbitals are sorted by the AO function with the largest coefficient so that the domains in a batch are close to each other.
+  // Coefficients below thresh are dropped.
+  vector<pair<int,int>> center(nocc);
+  for (int i = 0; i != nocc; ++i)
+    center[i] = {max_element(coeff->element_ptr(0, i), coeff->element_ptr(0, i+1), [](const double a, const double b) { return fabs(a) < fabs(b); })
+                 - coeff->element_ptr(0, i), i};
+  sort(center.begin(), center.end());
+  Matrix screened(nbasis, nocc, true);
+  for (int i = 0; i != nocc; ++i)
+    transform(coeff->element_ptr(0, center[i].second), coeff->element_ptr(0, center[i].second+1), screened.element_ptr(0, i),
+              [this](const double c) { return fabs(c) > thresh_ ? c : 0.0; });
+
+  // (D|ri) is formed for a batch of orbitals at a time; the batch is at most 1/16 of the 3-index integrals
+  const int nbatch = min(nocc, max(1, static_cast<int>(nbasis/16)));
+  vector<double> half(naux*nbasis*nbatch);
+  vector<double> norm(nbasis*nbatch);
+
+  // domains in which the exchange of each orbital is computed, and the compressed (D|ri) in the domains
+  vector<vector<int>> domain(nocc);
+  vector<size_t> offset(nocc);
+  vector<double> compressed;
+  size_t ncol = 0;
+  for (int i0 = 0; i0 < nocc; i0 += nbatch) {
+    const int nb = min(nbatch, nocc-i0);
+    fill_n(half.begin(), naux*nbasis*nb, 0.0);
+    // the functions s that are in the domain of any of the orbitals in this batch
+    auto significant = [&](const size_t s) {
+      for (int i = 0; i != nb; ++i)
+        if (screened.element(s, i0+i) != 0.0) return true;
+      return false;
+    };
+    for (size_t start = 0; start < nbasis; ++start) {
+      if (!significant(start)) continue;
+      size_t end = start+1;
+      while (end != nbasis && significant(end)) ++end;
+      if (naux)
+        dgemm_("N", "N", naux*nbasis, nb, end-start, 1.0, block->data()+naux*nbasis*start, naux*nbasis, screened.element_ptr(start, i0), nbasis,
+               1.0, half.data(), naux*nbasis);
+      start = end;
+    }
+    for (int i = 0; i != nb; ++i)
+      for (size_t r = 0; r != nbasis; ++r)
+        norm[r+nbasis*i] = blas::dot_product(half.data()+naux*(r+nbasis*i), naux, half.data()+naux*(r+nbasis*i));
+    if (!df->serial())
+      mpi__->allreduce(norm.data(), nbasis*nb);
+
+    for (int i = 0; i != nb; ++i) {
+      for (int r = 0; r != nbasis; ++r)
+        if (norm[r+nbasis*i] > thresh_*thresh_)
+          domain[i0+i].push_back(r);
+      offset[i0+i] = ncol;
+      ncol += domain[i0+i].size();
+      compressed.resize(naux*ncol);
+      for (int r = 0; r != domain[i0+i].size(); ++r)
+        copy_n(half.data()+naux*(domain[i0+i][r]+nbasis*i), naux, compressed.data()+naux*(offset[i0+i]+r));
+    }
+  }
+  half = vector<double>();
+  if (ncol == 0)
+    return out;
+
+  // compressed (D|ri), to which J^-1/2 is applied
+  auto cdist = make_shared<DFFullDist>(df, ncol, 1);
+  {
+    auto cblock = make_shared<DFBlock>(block->adist_now(), block->adist_now(), naux, ncol, 1, block->astart(), 0, 0, block->averaged());
+    copy_n(compressed.data(), naux*ncol, cblock->data());
+    cdist->add_block(cblock);
+  }
+  compressed = vector<double>();
+  shared_ptr<const DFFullDist> fitted = cdist->apply_J();
+  const size_t nfit = fitted->block(0)->asize();
+
+  vector<shared_ptr<Matrix>> contrib(nocc);
+  {
+    TaskQueue<function<void(void)>> tasks(nocc);
+    for (int i = 0; i != nocc; ++i)
+      tasks.emplace_back([&, i]() {
+        const int m = domain[i].size();
+        contrib[i] = make_shared<Matrix>(m, m, true);
+        if (m && nfit) {
+          const double* data = fitted->block(0)->data()+nfit*offset[i];
+          dgemm_("T", "N", m, m, nfit, a, data, nfit, data, nfit, 0.0, contrib[i]->data(), m);
+        }
+      });
+    tasks.compute();
+  }
+  for (int i = 0; i != nocc; ++i)
+    for (int s = 0; s != domain[i].size(); ++s)
+      for (int r = 0; r != domain[i].size(); ++r)
+        out->element(domain[i][r], domain[i][s]) += contrib[i]->element(r, s);
+
+  if (!df->serial())
+    out->allreduce();
+  return out;
+}
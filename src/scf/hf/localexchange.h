@@ -0,0 +1,63 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: localexchange.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_SCF_HF_LOCALEXCHANGE_H
+#define __SRC_SCF_HF_LOCALEXCHANGE_H
+
+#include <src/wfn/geometry.h>
+
+namespace bagel {
+
+/*
+    Exchange matrix with density fitting using localized (Pipek-Mezey) occupied orbitals.
+    For each orbital i, only the AO functions with |C_ni| > thresh are transformed, and only the functions whose half-transformed
+    integrals (D|ri) have a norm larger than thresh are contracted, so that the cost grows linearly with the number of occupied orbitals.
+    The object is kept during the SCF iterations; the localized orbitals of the previous call are the initial guess of the next localization.
+*/
+
+class LocalExchange {
+  protected:
+    std::shared_ptr<const Geometry> geom_;
+    std::shared_ptr<const Matrix> overlap_;
+    const double thresh_;
+
+    // localized orbitals of the previous call
+    std::shared_ptr<const Matrix> previous_;
+
+    std::shared_ptr<Matrix> localize(const MatView ocoeff);
+
+  public:
+    LocalExchange(std::shared_ptr<const Geometry> geom, const double thresh);
+
+    // local exchange requires dense 3-index integrals in a single block
+    static bool available(std::shared_ptr<const DFDist> df) { return !df->has_storage() && df->block().size() == 1; }
+
+    // returns a * sum_i (r i|s i), which is equivalent to half->form_2index(half, a) after half->apply_J()
+    std::shared_ptr<Matrix> compute(const MatView ocoeff, const double a);
+};
+
+}
+
+#endif
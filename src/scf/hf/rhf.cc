@@ -73,7 +73,7 @@ void RHF::compute() {
           if (dodf_) {
             focka = make_shared<const Fock<1>>(geom_, hcore_, aden, schwarz_);
           } else {
-            focka = make_shared<const Fock<0>>(geom_, hcore_, aden, schwarz_);
+            focka = make_shared<const Fock<0>>(geom_, hcore_, aden, schwarz_, shellpairs_);
           }
         } else {
           focka = compute_Fock_FMM(aden);
@@ -88,9 +88,9 @@ void RHF::compute() {
       if (!dofmm_) {
         if (!dodf_) {
           aodensity_ = coeff_->form_density_rhf(nocc_);
-          focka = make_shared<const Fock<0>>(geom_, hcore_, aodensity_, schwarz_);
+          focka = make_shared<const Fock<0>>(geom_, hcore_, aodensity_, schwarz_, shellpairs_);
         } else {
-          focka = make_shared<const Fock<1>>(geom_, hcore_, nullptr, coeff_->slice(0, nocc_), do_grad_, true/*rhf*/);
+          focka = make_shared<const Fock<1>>(geom_, hcore_, nullptr, coeff_->slice(0, nocc_), do_grad_, true/*rhf*/, 1.0, 1.0, local_exchange());
         }
       } else {
         aodensity_ = coeff_->form_density_rhf(nocc_);
@@ -119,6 +119,8 @@ void RHF::compute() {
 
   // starting SCF iteration
   shared_ptr<const Matrix> densitychange = aodensity_;
+  // in non-DF runs the Fock matrix is built incrementally from the density change; optionally rebuilt to remove accumulated errors
+  const int fock_rebuild = idata_->get<int>("fock_rebuild", 0);
 
   for (int iter = 0; iter != max_iter_; ++iter) {
     Timer pdebug(1);
@@ -131,17 +133,23 @@ void RHF::compute() {
     }
 #endif
 
+    shared_ptr<const DistMatrix> fock;
     if (!dofmm_) {
       if (!dodf_) {
-        previous_fock = make_shared<Fock<0>>(geom_, previous_fock, densitychange, schwarz_);
-        mpi__->broadcast(const_pointer_cast<Matrix>(previous_fock)->data(), previous_fock->size(), 0);
+        if (fock_rebuild > 0 && iter > 0 && iter % fock_rebuild == 0)
+          previous_fock = make_shared<Fock<0>>(geom_, hcore_, aodensity_, schwarz_, shellpairs_);
+        else
+          previous_fock = make_shared<Fock<0>>(geom_, previous_fock, densitychange, schwarz_, shellpairs_);
+      } else if (!do_grad_ && local_exchange_ <= 0.0) {
+        fock = compute_Fock_DF_dist(hcore);
       } else {
-        previous_fock = make_shared<Fock<1>>(geom_, hcore_, nullptr, coeff_->slice(0, nocc_), do_grad_, true/*rhf*/);
+        previous_fock = make_shared<Fock<1>>(geom_, hcore_, nullptr, coeff_->slice(0, nocc_), do_grad_, true/*rhf*/, 1.0, 1.0, local_exchange());
       }
     } else {
       previous_fock = compute_Fock_FMM(aodensity_, make_shared<const Matrix>(coeff_->slice(0, nocc_)));
     }
-    shared_ptr<const DistMatrix> fock = previous_fock->distmatrix();
+    if (!fock)
+      fock = previous_fock->distmatrix();
 
     energy_  = 0.5*aodensity->dot_product(*hcore+*fock) + geom_->nuclear_repulsion();
 
@@ -217,6 +225,20 @@ shared_ptr<const Reference> RHF::conv_to_ref() const {
 
 
 // FMM
+shared_ptr<const DistMatrix> RHF::compute_Fock_DF_dist(shared_ptr<const DistMatrix> hcore) const {
+  // same contractions as Fock<1> with rhf = true, but each process only receives its block of the exchange and Coulomb matrices
+  shared_ptr<const DFDist> df = geom_->df();
+  const MatView ocoeff = coeff_->slice(0, nocc_);
+  shared_ptr<DFHalfDist> half = df->compute_half_transform(ocoeff)->apply_J();
+
+  auto out = make_shared<DistMatrix>(*hcore);
+  *out += *half->form_2index_dist(half, -1.0);
+  auto coeff = make_shared<const Matrix>(*Matrix(ocoeff).transpose()*2.0);
+  *out += *df->compute_Jop_dist(half, coeff, true);
+  return out;
+}
+
+
 shared_ptr<const Matrix> RHF::compute_Fock_FMM(shared_ptr<const Matrix> density, shared_ptr<const Matrix> ocoeff) {
 
   shared_ptr<const Matrix> Kff_rj;
@@ -42,6 +42,8 @@ class RHF : public SCF_base {
 
     std::shared_ptr<DIIS<DistMatrix>> diis_;
     std::shared_ptr<const Matrix> compute_Fock_FMM(std::shared_ptr<const Matrix> density, std::shared_ptr<const Matrix> coeff = nullptr);
+    // DF Fock matrix assembled directly in the distributed layout (no gradients, no local exchange)
+    std::shared_ptr<const DistMatrix> compute_Fock_DF_dist(std::shared_ptr<const DistMatrix> hcore) const;
 
   private:
     // serialization
@@ -22,6 +22,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <mutex>
 #include <numeric>
 #include <src/scf/ks/dftgrid.h>
 #include <src/scf/ks/lebedevlist.h>
@@ -71,22 +73,6 @@ vector<shared_ptr<const Matrix>> DFTGrid_base::compute_rho_sigma(shared_ptr<cons
 
 
 namespace bagel {
-class ExcVxcTask {
-  protected:
-    const size_t size;
-    const double* rho;
-    const double* sigma;
-    double* exc;
-    double* vxc;
-    double* vxc2;
-    shared_ptr<const XCFunc> func;
-  public:
-    ExcVxcTask(const size_t n, const double* r, const double* s, double* e, double* v, double* v2, shared_ptr<const XCFunc> f)
-     : size(n), rho(r), sigma(s), exc(e), vxc(v), vxc2(v2), func(f) { }
-    void compute() {
-      func->compute_exc_vxc(size, rho, sigma, exc, vxc, vxc2);
-    }
-};
 class VxcTask {
   protected:
     const size_t size;
@@ -108,56 +94,82 @@ class VxcTask {
 tuple<shared_ptr<const Matrix>,double> DFTGrid_base::compute_xc(shared_ptr<const XCFunc> func, shared_ptr<const Matrix> mat) const {
   Timer time;
 
-  unique_ptr<double[]> rho(new double[grid_->size()]);
-  unique_ptr<double[]> sigma, rhox, rhoy, rhoz;
-  if (!func->lda()) {
-    sigma = unique_ptr<double[]>(new double[grid_->size()]);
-    rhox  = unique_ptr<double[]>(new double[grid_->size()]);
-    rhoy  = unique_ptr<double[]>(new double[grid_->size()]);
-    rhoz  = unique_ptr<double[]>(new double[grid_->size()]);
-  }
-
-  compute_rho_sigma(func, mat, rho, sigma, rhox, rhoy, rhoz);
-
-  time.tick_print("rho, sigma");
-
-  unique_ptr<double[]> exc(new double[grid_->size()]);
-  unique_ptr<double[]> vxc(new double[grid_->size()*(func->lda()?1:2)]);
-
-  StaticDist dist(grid_->size(), min(resources__->max_num_threads()*100, grid_->size()));
-  vector<pair<size_t, size_t>> table = dist.atable();
-
-  TaskQueue<ExcVxcTask> tasks(table.size());
-  for (auto& i : table) {
-    const size_t n = i.first;
-    tasks.emplace_back(i.second, rho.get()+n, (!func->lda() ? sigma.get()+n : nullptr),
-                               exc.get()+n, vxc.get()+n, (!func->lda() ? vxc.get()+n+grid_->size() : nullptr), func);
-  }
-  tasks.compute();
-  time.tick_print("exc+vxc");
-
   auto out = make_shared<Matrix>(mol_->nbasis(), mol_->nbasis());
   double en = 0.0;
+  mutex outmutex;
+
+  // closed-shell density matrix; only its blocks between significant basis functions are used below
+  auto density = make_shared<const Matrix>(*mat ^ *mat * 2.0);
+
+  // each batch only involves the basis functions that are significant on its points
+  const vector<GridBatch>& batches = grid_->batches();
+  TaskQueue<function<void(void)>> tasks(batches.size());
+  for (auto& batch : batches) {
+    if (batch.nbasis() == 0) continue;
+    tasks.emplace_back(
+      [this, &func, &density, &batch, &out, &en, &outmutex]() {
+        const bool lda = func->lda();
+        const size_t npt = batch.size();
+        const size_t nbas = batch.nbasis();
+        array<shared_ptr<Matrix>,4> val = grid_->compute_batch(batch, !lda);
+
+        // density matrix restricted to the significant basis functions, contracted with their values
+        Matrix dlocal(nbas, nbas);
+        for (size_t j = 0; j != nbas; ++j)
+          for (size_t i = 0; i != nbas; ++i)
+            dlocal(i, j) = density->element(batch.basis()[i], batch.basis()[j]);
+        const Matrix dval = dlocal * *val[0];
+
+        unique_ptr<double[]> rho(new double[npt]);
+        unique_ptr<double[]> sigma, rhox, rhoy, rhoz;
+        for (size_t i = 0; i != npt; ++i)
+          rho[i] = ddot_(nbas, val[0]->element_ptr(0, i), 1, dval.element_ptr(0, i), 1);
+        if (!lda) {
+          sigma = unique_ptr<double[]>(new double[npt]);
+          rhox  = unique_ptr<double[]>(new double[npt]);
+          rhoy  = unique_ptr<double[]>(new double[npt]);
+          rhoz  = unique_ptr<double[]>(new double[npt]);
+          for (size_t i = 0; i != npt; ++i) {
+            const double sigx = ddot_(nbas, val[1]->element_ptr(0, i), 1, dval.element_ptr(0, i), 1);
+            const double sigy = ddot_(nbas, val[2]->element_ptr(0, i), 1, dval.element_ptr(0, i), 1);
+            const double sigz = ddot_(nbas, val[3]->element_ptr(0, i), 1, dval.element_ptr(0, i), 1);
+            sigma[i] = 4*(sigx*sigx + sigy*sigy + sigz*sigz);
+            rhox[i] = 2*sigx;
+            rhoy[i] = 2*sigy;
+            rhoz[i] = 2*sigz;
+          }
+        }
 
-  auto scal = make_shared<Matrix>(mol_->nbasis(), grid_->size());
-  if (func->lda()) {
-    for (size_t i = 0; i != scal->mdim(); ++i) {
-      daxpy_(scal->ndim(), vxc[i]*grid_->weight(i), grid_->basis()->element_ptr(0, i), 1, scal->element_ptr(0, i), 1);
-      en += exc[i] * rho[i] * grid_->weight(i);
-    }
-  } else {
-    for (size_t i = 0; i != scal->mdim(); ++i) {
-      daxpy_(scal->ndim(), vxc[i]*grid_->weight(i), grid_->basis()->element_ptr(0, i), 1, scal->element_ptr(0, i), 1);
-      daxpy_(scal->ndim(), 4*vxc[i+grid_->size()]*grid_->weight(i)*rhox[i], grid_->gradx()->element_ptr(0, i), 1, scal->element_ptr(0, i), 1);
-      daxpy_(scal->ndim(), 4*vxc[i+grid_->size()]*grid_->weight(i)*rhoy[i], grid_->grady()->element_ptr(0, i), 1, scal->element_ptr(0, i), 1);
-      daxpy_(scal->ndim(), 4*vxc[i+grid_->size()]*grid_->weight(i)*rhoz[i], grid_->gradz()->element_ptr(0, i), 1, scal->element_ptr(0, i), 1);
-      en += exc[i] * rho[i] * grid_->weight(i);
-    }
+        unique_ptr<double[]> exc(new double[npt]);
+        unique_ptr<double[]> vxc(new double[npt*(lda ? 1 : 2)]);
+        func->compute_exc_vxc(npt, rho.get(), sigma.get(), exc.get(), vxc.get(), (!lda ? vxc.get()+npt : nullptr));
+
+        double e = 0.0;
+        Matrix scal(nbas, npt);
+        for (size_t i = 0; i != npt; ++i) {
+          const double w = grid_->weight(batch.points()[i]);
+          daxpy_(nbas, vxc[i]*w, val[0]->element_ptr(0, i), 1, scal.element_ptr(0, i), 1);
+          if (!lda) {
+            daxpy_(nbas, 4*vxc[i+npt]*w*rhox[i], val[1]->element_ptr(0, i), 1, scal.element_ptr(0, i), 1);
+            daxpy_(nbas, 4*vxc[i+npt]*w*rhoy[i], val[2]->element_ptr(0, i), 1, scal.element_ptr(0, i), 1);
+            daxpy_(nbas, 4*vxc[i+npt]*w*rhoz[i], val[3]->element_ptr(0, i), 1, scal.element_ptr(0, i), 1);
+          }
+          e += exc[i] * rho[i] * w;
+        }
+        const Matrix local = scal ^ *val[0];
+
+        lock_guard<mutex> lock(outmutex);
+        for (size_t j = 0; j != nbas; ++j)
+          for (size_t i = 0; i != nbas; ++i)
+            out->element(batch.basis()[i], batch.basis()[j]) += local(i, j);
+        en += e;
+      }
+    );
   }
-  *out += *scal ^ *grid_->basis();
+  tasks.compute();
   out->symmetrize();
 
-  time.tick_print("contraction");
+  time.tick_print("exc+vxc");
   return make_tuple(out, en);
 }
 
@@ -256,6 +268,26 @@ shared_ptr<const GradFile> DFTGrid_base::compute_xcgrad(shared_ptr<const XCFunc>
 
 constexpr double a_stratmann__ = 0.64;
 
+// Stratmann CPL 1996, Eq. 14; nu is the hyperbolic coordinate divided by a
+static double stratmann(const double nu) {
+  const double nu2 = nu*nu;
+  return nu >= -1 ? (nu < 1 ?  0.5-0.5*(35.0/16.0*nu*(1.0-nu2*(1.0-21.0/35.0*nu2*(1.0-5.0/21.0*nu2)))) : 0.0) : 1.0;
+}
+
+
+DFTGrid_base::DFTGrid_base(shared_ptr<const Molecule> mol, const bool screened) : mol_(mol), screened_(screened) {
+  if (screened_) {
+    neighbors_.resize(mol_->natom());
+    for (int i = 0; i != mol_->natom(); ++i) {
+      for (int j = 0; j != mol_->natom(); ++j)
+        if (i != j)
+          neighbors_[i].emplace_back(mol_->atoms(i)->distance(mol_->atoms(j)), j);
+      sort(neighbors_[i].begin(), neighbors_[i].end());
+    }
+  }
+}
+
+
 double DFTGrid_base::fuzzy_cell(shared_ptr<const Atom> atom, array<double,3>&& xyz) const {
   int fuzzy = -1;
   shared_ptr<StackMem> stack = resources__->get();
@@ -269,10 +301,7 @@ double DFTGrid_base::fuzzy_cell(shared_ptr<const Atom> atom, array<double,3>&& x
     for (auto c = b+1; c != mol_->atoms().end(); ++c, ++j) {
       const double distbc = (*b)->distance(*c);
       const double distcg = (*c)->distance(xyz);
-      // Stratmann CPL 1996
-      double nuij = (distbg - distcg) / distbc / a_stratmann__;
-      const double nuij2 = pow(nuij,2);
-      const double fac = (nuij >= -1 ? (nuij < 1 ?  0.5-0.5*(35.0/16.0*nuij*(1.0-nuij2*(1.0-21.0/35.0*nuij2*(1.0-5.0/21.0*nuij2)))) : 0.0) : 1.0);
+      const double fac = stratmann((distbg - distcg) / distbc / a_stratmann__);
       total[i] *= fac;
       total[j] *= 1.0-fac;
     }
@@ -290,11 +319,49 @@ double DFTGrid_base::fuzzy_cell(shared_ptr<const Atom> atom, array<double,3>&& x
 }
 
 
+double DFTGrid_base::fuzzy_cell_screened(const int iatom, array<double,3>&& xyz) const {
+  assert(screened_);
+  // s(mu_bc) vanishes when r_b >= f r_c, and is one when r_c >= f r_b
+  const double f = (1.0+a_stratmann__)/(1.0-a_stratmann__);
+  const double ra = mol_->atoms(iatom)->distance(xyz);
+
+  // atoms whose cell function can be nonzero (r_b < f r_a). Note that r_ab <= r_a + r_b.
+  vector<pair<int,double>> cand{{iatom, ra}};
+  for (auto& n : neighbors_[iatom]) {
+    if (n.first >= (1.0+f)*ra) break;
+    const double rb = mol_->atoms(n.second)->distance(xyz);
+    if (rb < f*ra)
+      cand.emplace_back(n.second, rb);
+  }
+
+  double total = 0.0;
+  double own = 0.0;
+  for (auto& b : cand) {
+    shared_ptr<const Atom> atomb = mol_->atoms(b.first);
+    double cell = 1.0;
+    if (b.first != iatom)
+      cell *= stratmann((b.second - ra) / atomb->distance(mol_->atoms(iatom)) / a_stratmann__);
+    // atoms that can contribute are within r_a + f r_b from atom a
+    for (auto& n : neighbors_[iatom]) {
+      if (n.first >= ra + f*b.second || cell == 0.0) break;
+      if (n.second == b.first) continue;
+      shared_ptr<const Atom> atomc = mol_->atoms(n.second);
+      cell *= stratmann((b.second - atomc->distance(xyz)) / atomb->distance(atomc) / a_stratmann__);
+    }
+    total += cell;
+    if (b.first == iatom)
+      own = cell;
+  }
+  return own / total; // Eq. 22
+}
+
+
 namespace bagel {
 class FuzzyTask {
   protected:
     shared_ptr<Matrix> data;
     shared_ptr<const Atom> atom;
+    const int iatom;
     double xg;
     double yg;
     double zg;
@@ -302,11 +369,12 @@ class FuzzyTask {
     DFTGrid_base* parent;
     const int n;
   public:
-    FuzzyTask(shared_ptr<Matrix> d, shared_ptr<const Atom> a, double x, double y, double z, double c, DFTGrid_base* ptr, const int i)
-     : data(d), atom(a), xg(x), yg(y), zg(z), coeff(c), parent(ptr), n(i) { }
+    FuzzyTask(shared_ptr<Matrix> d, shared_ptr<const Atom> a, const int ia, double x, double y, double z, double c, DFTGrid_base* ptr, const int i)
+     : data(d), atom(a), iatom(ia), xg(x), yg(y), zg(z), coeff(c), parent(ptr), n(i) { }
 
     void compute() {
-      const double weight = coeff * parent->fuzzy_cell(atom, array<double,3>{{xg, yg, zg}});
+      const double weight = coeff * (parent->screened() ? parent->fuzzy_cell_screened(iatom, array<double,3>{{xg, yg, zg}})
+                                                        : parent->fuzzy_cell(atom, array<double,3>{{xg, yg, zg}}));
       data->element(0, n) = xg;
       data->element(1, n) = yg;
       data->element(2, n) = zg;
@@ -330,13 +398,19 @@ void DFTGrid_base::add_grid(const int nrad, const int nang, const unique_ptr<dou
   TaskQueue<FuzzyTask> tasks(mol_->natom()*nrad*nang);
 
   int cnt = nprev;
-  for (auto& a : mol_->atoms()) {
+  for (int ia = 0; ia != mol_->natom(); ++ia) {
+    shared_ptr<const Atom> a = mol_->atoms(ia);
     const double rbs = a->radius();
 
     double rib = 1.0e+10;
-    for (auto& b : mol_->atoms())
-      if (a != b)
-        rib = min(rib, a->distance(b));
+    if (screened_) {
+      if (!neighbors_[ia].empty())
+        rib = neighbors_[ia].front().first;
+    } else {
+      for (auto& b : mol_->atoms())
+        if (a != b)
+          rib = min(rib, a->distance(b));
+    }
 
     for (int i = 0; i != nrad; ++i) {
       const double rr = r_ch[i] * rbs;
@@ -356,7 +430,7 @@ void DFTGrid_base::add_grid(const int nrad, const int nang, const unique_ptr<dou
           const double xg = x[j] * rr + a->position(0);
           const double yg = y[j] * rr + a->position(1);
           const double zg = z[j] * rr + a->position(2);
-          tasks.emplace_back(combined, a, xg, yg, zg, w[j]*w_ch[i]*pow(rbs,3)*4.0*pi__, this, cnt++);
+          tasks.emplace_back(combined, a, ia, xg, yg, zg, w[j]*w_ch[i]*pow(rbs,3)*4.0*pi__, this, cnt++);
         }
       }
     }
@@ -392,7 +466,7 @@ void DFTGrid_base::remove_redgrid() {
 
 
 // grid without 'pruning'. Becke's original mapping
-BLGrid::BLGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule> mol) : DFTGrid_base(mol) {
+BLGrid::BLGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule> mol, const bool screened) : DFTGrid_base(mol, screened) {
   // construct Lebedev grid
   unique_ptr<double[]> x(new double[nang]);
   unique_ptr<double[]> y(new double[nang]);
@@ -417,7 +491,7 @@ BLGrid::BLGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule>
 }
 
 
-TALGrid::TALGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule> mol) : DFTGrid_base(mol) {
+TALGrid::TALGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule> mol, const bool screened) : DFTGrid_base(mol, screened) {
   // construct Lebedev grid
   unique_ptr<double[]> x(new double[nang]);
   unique_ptr<double[]> y(new double[nang]);
@@ -442,7 +516,7 @@ TALGrid::TALGrid(const size_t nrad, const size_t nang, shared_ptr<const Molecule
 }
 
 
-DefaultGrid::DefaultGrid(shared_ptr<const Molecule> mol) : DFTGrid_base(mol) {
+DefaultGrid::DefaultGrid(shared_ptr<const Molecule> mol, const bool screened) : DFTGrid_base(mol, screened) {
   // the default radial grid has 75 points
   const int nrad = 75;
   // construct Chebyshev grid
@@ -35,6 +35,11 @@ class DFTGrid_base {
     const std::shared_ptr<const Molecule> mol_;
     std::shared_ptr<Grid> grid_;
 
+    // if true, the partitioning weights are screened using per-atom neighbor lists (Stratmann, Scuseria, and Frisch)
+    const bool screened_;
+    // for each atom, the distances to and indices of all the other atoms in ascending order
+    std::vector<std::vector<std::pair<double,int>>> neighbors_;
+
     // TODO to be controlled by the input deck
     constexpr static double grid_thresh_ = 1.0e-10;
 
@@ -46,11 +51,13 @@ class DFTGrid_base {
                                                     std::unique_ptr<double[]>& rho, std::unique_ptr<double[]>& sigma,
                                                     std::unique_ptr<double[]>& rhox, std::unique_ptr<double[]>& rhoy, std::unique_ptr<double[]>& rhoz) const;
   public:
-    DFTGrid_base(std::shared_ptr<const Molecule> mol) : mol_(mol) { }
+    DFTGrid_base(std::shared_ptr<const Molecule> mol, const bool screened = false);
 
     std::tuple<std::shared_ptr<const Matrix>,double> compute_xc(std::shared_ptr<const XCFunc> func, std::shared_ptr<const Matrix> mat) const;
     std::shared_ptr<const GradFile> compute_xcgrad(std::shared_ptr<const XCFunc> func, std::shared_ptr<const Matrix> mat) const;
     double fuzzy_cell(std::shared_ptr<const Atom> a, std::array<double,3>&& x) const;
+    double fuzzy_cell_screened(const int a, std::array<double,3>&& x) const;
+    bool screened() const { return screened_; }
 
     std::shared_ptr<const Grid> grid() const { return grid_; }
 };
@@ -59,19 +66,19 @@ class DFTGrid_base {
 // Becke-Chebyshev-Lebedev
 class BLGrid : public DFTGrid_base {
   public:
-    BLGrid(const size_t nrad, const size_t nang, std::shared_ptr<const Molecule> mol);
+    BLGrid(const size_t nrad, const size_t nang, std::shared_ptr<const Molecule> mol, const bool screened = false);
 };
 
 // Treutler-Ahlrichs-Chebyshev-Lebedev
 class TALGrid : public DFTGrid_base {
   public:
-    TALGrid(const size_t nrad, const size_t nang, std::shared_ptr<const Molecule> mol);
+    TALGrid(const size_t nrad, const size_t nang, std::shared_ptr<const Molecule> mol, const bool screened = false);
 };
 
 // Pruned Grid
 class DefaultGrid : public DFTGrid_base {
   public:
-    DefaultGrid(std::shared_ptr<const Molecule> mol);
+    DefaultGrid(std::shared_ptr<const Molecule> mol, const bool screened = false);
 };
 
 }
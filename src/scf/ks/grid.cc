@@ -22,6 +22,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <src/scf/ks/grid.h>
 #include <src/util/taskqueue.h>
 #include <src/util/parallel/resources.h>
@@ -91,13 +94,130 @@ using namespace std;
 using namespace bagel;
 
 void Grid::init() {
+  shells_.clear();
+  batches_.clear();
+  int offset = 0;
+  for (auto& i : mol_->atoms())
+    for (auto& j : i->shells()) {
+      shells_.emplace_back(j, i->position(), offset);
+      offset += j->nbasis();
+    }
+  vector<double> ext;
+  for (auto& i : shells_)
+    ext.push_back(extent(get<0>(i), basis_thresh_));
+
+  // recursive bisection along the longest side of the bounding box
+  vector<size_t> index(size());
+  iota(index.begin(), index.end(), 0LU);
+  vector<pair<size_t, size_t>> ranges;
+  vector<pair<size_t, size_t>> stack{{0LU, size()}};
+  while (!stack.empty()) {
+    const pair<size_t, size_t> r = stack.back();
+    stack.pop_back();
+    if (r.second - r.first <= batch_size_) {
+      if (r.second > r.first)
+        ranges.push_back(r);
+      continue;
+    }
+    array<double,3> lower{{numeric_limits<double>::max(), numeric_limits<double>::max(), numeric_limits<double>::max()}};
+    array<double,3> upper{{numeric_limits<double>::lowest(), numeric_limits<double>::lowest(), numeric_limits<double>::lowest()}};
+    for (size_t i = r.first; i != r.second; ++i)
+      for (int x = 0; x != 3; ++x) {
+        lower[x] = min(lower[x], data_->element(x, index[i]));
+        upper[x] = max(upper[x], data_->element(x, index[i]));
+      }
+    int longest = 0;
+    for (int x = 1; x != 3; ++x)
+      if (upper[x]-lower[x] > upper[longest]-lower[longest])
+        longest = x;
+    const size_t mid = r.first + (r.second - r.first) / 2;
+    nth_element(index.begin()+r.first, index.begin()+mid, index.begin()+r.second,
+                [&](const size_t a, const size_t b) { return data_->element(longest, a) < data_->element(longest, b); });
+    stack.emplace_back(mid, r.second);
+    stack.emplace_back(r.first, mid);
+  }
+
+  // screening of the shells using the bounding sphere of each batch
+  for (auto& r : ranges) {
+    array<double,3> center{{0.0, 0.0, 0.0}};
+    for (size_t i = r.first; i != r.second; ++i)
+      for (int x = 0; x != 3; ++x)
+        center[x] += data_->element(x, index[i]);
+    for (auto& x : center)
+      x /= r.second - r.first;
+    double radius = 0.0;
+    for (size_t i = r.first; i != r.second; ++i)
+      radius = max(radius, sqrt(pow(data_->element(0, index[i])-center[0], 2) + pow(data_->element(1, index[i])-center[1], 2)
+                                + pow(data_->element(2, index[i])-center[2], 2)));
+
+    vector<int> shells, basis;
+    for (int s = 0; s != shells_.size(); ++s) {
+      const array<double,3>& pos = get<1>(shells_[s]);
+      const double dist = sqrt(pow(pos[0]-center[0], 2) + pow(pos[1]-center[1], 2) + pow(pos[2]-center[2], 2));
+      if (dist - radius < ext[s]) {
+        shells.push_back(s);
+        for (int i = 0; i != get<0>(shells_[s])->nbasis(); ++i)
+          basis.push_back(get<2>(shells_[s]) + i);
+      }
+    }
+    batches_.emplace_back(vector<size_t>(index.begin()+r.first, index.begin()+r.second), move(shells), move(basis));
+  }
+}
+
+
+double Grid::extent(shared_ptr<const Shell> shell, const double thresh) {
+  // radius beyond which the values and gradients of the (primitive) functions r^l exp(-a r^2) fall below thresh
+  const int l = shell->angular_number();
+  double out = 0.0;
+  for (int j = 0; j != shell->num_primitive(); ++j) {
+    double c = 0.0;
+    for (auto& i : shell->contractions())
+      c = max(c, fabs(i[j]));
+    const double a = shell->exponents(j);
+    // fixed-point iteration from outside converges to the outermost solution (or to zero if there is none)
+    double r = 100.0 / sqrt(a);
+    for (int iter = 0; iter != 100; ++iter) {
+      const double arg = log(c*(1.0+l+2.0*a*r)*shell->num_primitive()/thresh) + (r > 0.0 ? l*log(r) : 0.0);
+      const double rnew = arg > 0.0 ? sqrt(arg/a) : 0.0;
+      const bool conv = fabs(rnew - r) < 1.0e-6;
+      r = rnew;
+      if (conv || r == 0.0) break;
+    }
+    out = max(out, r);
+  }
+  return out;
+}
+
+
+array<shared_ptr<Matrix>,4> Grid::compute_batch(const GridBatch& batch, const bool grad) const {
+  array<shared_ptr<Matrix>,4> out;
+  out[0] = make_shared<Matrix>(batch.nbasis(), batch.size());
+  if (grad)
+    for (int i = 1; i != 4; ++i)
+      out[i] = make_shared<Matrix>(batch.nbasis(), batch.size());
+
+  for (size_t g = 0; g != batch.size(); ++g) {
+    const size_t p = batch.points()[g];
+    int pos = 0;
+    for (auto& s : batch.shells()) {
+      const array<double,3>& center = get<1>(shells_[s]);
+      get<0>(shells_[s])->compute_grid_value(out[0]->element_ptr(pos, g), grad ? out[1]->element_ptr(pos, g) : nullptr,
+                                             grad ? out[2]->element_ptr(pos, g) : nullptr, grad ? out[3]->element_ptr(pos, g) : nullptr,
+                                             data_->element(0, p)-center[0], data_->element(1, p)-center[1], data_->element(2, p)-center[2]);
+      pos += get<0>(shells_[s])->nbasis();
+    }
+  }
+  return out;
+}
+
+
+void Grid::init_dense() const {
   const int ngrid = size();
   basis_ = make_shared<Matrix>(mol_->nbasis(), ngrid);
   gradx_ = make_shared<Matrix>(mol_->nbasis(), ngrid);
   grady_ = make_shared<Matrix>(mol_->nbasis(), ngrid);
   gradz_ = make_shared<Matrix>(mol_->nbasis(), ngrid);
 
-  // TODO I guess this should be more efficient..
   TaskQueue<GridBasisTask> tasks(ngrid);
   for (size_t g = 0; g != ngrid; ++g) {
     tasks.emplace_back(basis_->element_ptr(0,g), gradx_->element_ptr(0,g), grady_->element_ptr(0,g), gradz_->element_ptr(0,g),
@@ -27,40 +27,77 @@
 
 #include <array>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 #include <src/molecule/molecule.h>
 #include <src/util/math/xyzfile.h>
 
 namespace bagel {
 
+// A spatially compact set of grid points together with the basis functions that are not negligible on them
+class GridBatch {
+  protected:
+    std::vector<size_t> points_;  // indices of the grid points
+    std::vector<int> shells_;     // indices of the significant shells (see Grid::shells_)
+    std::vector<int> basis_;      // AO indices of the significant basis functions
+
+  public:
+    GridBatch(std::vector<size_t>&& p, std::vector<int>&& s, std::vector<int>&& b) : points_(p), shells_(s), basis_(b) { }
+
+    const std::vector<size_t>& points() const { return points_; }
+    const std::vector<int>& shells() const { return shells_; }
+    const std::vector<int>& basis() const { return basis_; }
+    size_t size() const { return points_.size(); }
+    size_t nbasis() const { return basis_.size(); }
+};
+
+
 class Grid {
   protected:
     const std::shared_ptr<const Molecule> mol_;
     const std::shared_ptr<const Matrix> data_; // x,y,z,weight
 
-    // basis functions and derivaties on this grid
-    std::shared_ptr<Matrix> basis_;
-    std::shared_ptr<Matrix> gradx_;
-    std::shared_ptr<Matrix> grady_;
-    std::shared_ptr<Matrix> gradz_;
+    // max number of points in a batch and the threshold for basis function values to be considered nonzero
+    constexpr static size_t batch_size_ = 128;
+    constexpr static double basis_thresh_ = 1.0e-12;
+
+    // shells with the center of the atom and the AO offset
+    std::vector<std::tuple<std::shared_ptr<const Shell>, std::array<double,3>, int>> shells_;
+    std::vector<GridBatch> batches_;
+
+    // basis functions and derivaties on this grid (dense; computed once on demand, also when requested from several threads)
+    mutable std::once_flag dense_flag_;
+    mutable std::shared_ptr<Matrix> basis_;
+    mutable std::shared_ptr<Matrix> gradx_;
+    mutable std::shared_ptr<Matrix> grady_;
+    mutable std::shared_ptr<Matrix> gradz_;
+
+    void init_dense() const;
+    static double extent(std::shared_ptr<const Shell> shell, const double thresh);
 
   public:
     Grid(std::shared_ptr<const Molecule> g, std::shared_ptr<const Matrix>& o)
       : mol_(g), data_(o) { assert(data_->ndim() == 4); }
 
-    std::shared_ptr<const Matrix> basis() const { return basis_; }
-    std::shared_ptr<const Matrix> gradx() const { return gradx_; }
-    std::shared_ptr<const Matrix> grady() const { return grady_; }
-    std::shared_ptr<const Matrix> gradz() const { return gradz_; }
+    std::shared_ptr<const Matrix> basis() const { std::call_once(dense_flag_, &Grid::init_dense, this); return basis_; }
+    std::shared_ptr<const Matrix> gradx() const { std::call_once(dense_flag_, &Grid::init_dense, this); return gradx_; }
+    std::shared_ptr<const Matrix> grady() const { std::call_once(dense_flag_, &Grid::init_dense, this); return grady_; }
+    std::shared_ptr<const Matrix> gradz() const { std::call_once(dense_flag_, &Grid::init_dense, this); return gradz_; }
     const double& weight(const size_t i) const { return data_->element(3,i); }
     size_t size() const { return data_->mdim(); }
     std::shared_ptr<const Matrix> data() const { return data_; }
 
     std::array<std::shared_ptr<Matrix>,6> compute_grad2() const;
 
+    const std::vector<GridBatch>& batches() const { return batches_; }
+    // values (and gradients if requested) of the significant basis functions on the points of a batch (nbasis x npoints)
+    std::array<std::shared_ptr<Matrix>,4> compute_batch(const GridBatch& batch, const bool grad) const;
+
+    // partitions the points into batches
     void init();
 
 };
-
 }
 
 #endif
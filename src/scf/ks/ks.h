@@ -51,7 +51,8 @@ class KS : public SCF_base {
       func_ = std::make_shared<XCFunc>(name_);
 
       Timer preptime;
-      grid_ = std::make_shared<DefaultGrid>(geom);
+      // partitioning weights with neighbor-list screening (linear scaling)
+      grid_ = std::make_shared<DefaultGrid>(geom, idata->get<bool>("grid_screening", false));
       preptime.tick_print("DFT grid generation");
 
       std::cout << std::endl;
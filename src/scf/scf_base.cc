@@ -60,6 +60,7 @@ SCF_base_<MatType, OvlType, HcType, Enable>::SCF_base_(shared_ptr<const PTree> i
   thresh_overlap_ = idata_->get<double>("thresh_overlap", 1.0e-8);
   thresh_scf_ = idata_->get<double>("thresh", 1.0e-8);
   thresh_scf_ = idata_->get<double>("thresh_scf", thresh_scf_);
+  local_exchange_ = idata_->get<double>("local_exchange", 0.0);
 
   if (dofmm_) {
     fmm_ = make_shared<const FMM>(idata_, geom);
@@ -97,6 +98,8 @@ SCF_base_<MatType, OvlType, HcType, Enable>::SCF_base_(shared_ptr<const PTree> i
 template <typename MatType, typename OvlType, typename HcType, class Enable>
 void SCF_base_<MatType, OvlType, HcType, Enable>::init_schwarz() {
   schwarz_ = geom_->schwarz();
+  if (geom_->qqr())
+    shellpairs_ = make_shared<const vector<shared_ptr<const ShellPair>>>(geom_->shellpairs(schwarz_));
 }
 
 
@@ -31,6 +31,7 @@
 #include <src/mat1e/giao/zhcore.h>
 #include <src/wfn/method.h>
 #include <src/scf/fmm/fmm.h>
+#include <src/scf/hf/localexchange.h>
 
 namespace bagel {
 
@@ -51,10 +52,21 @@ class SCF_base_ : public Method {
 
     double thresh_overlap_;
     double thresh_scf_;
+    // if positive, exchange is computed with localized orbitals using this threshold (DF only)
+    double local_exchange_;
+    // local exchange for the alpha (0) and beta (1) orbitals; kept during the iterations to reuse the localized orbitals
+    std::array<std::shared_ptr<LocalExchange>,2> local_k_;
+    std::shared_ptr<LocalExchange> local_exchange(const int spin = 0) {
+      if (local_exchange_ > 0.0 && !local_k_[spin])
+        local_k_[spin] = std::make_shared<LocalExchange>(geom_, local_exchange_);
+      return local_k_[spin];
+    }
     int multipole_print_;
     int dma_print_;
 
     std::vector<double> schwarz_;
+    // shell pairs for the QQR screening in non-DF Fock builds, made once together with schwarz_
+    std::shared_ptr<const std::vector<std::shared_ptr<const ShellPair>>> shellpairs_;
     void init_schwarz();
 
     VectorB eig_;
@@ -88,7 +100,7 @@ class SCF_base_ : public Method {
       ar & boost::serialization::base_object<Method>(*this);
       ar & tildex_ & overlap_ & hcore_ & coeff_ & max_iter_ & diis_start_ & diis_size_
          & thresh_overlap_ & thresh_scf_ & multipole_print_ & dma_print_ & schwarz_ & eig_ & energy_
-         & nocc_ & noccB_ & do_grad_ & restart_ & dofmm_ & fmm_ & fmmK_;
+         & nocc_ & noccB_ & do_grad_ & restart_ & dofmm_ & fmm_ & fmmK_ & local_exchange_;
     }
 
   public:
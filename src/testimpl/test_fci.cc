@@ -104,6 +104,7 @@ BOOST_AUTO_TEST_SUITE(TEST_FCI)
 
 BOOST_AUTO_TEST_CASE(KNOWLES_HANDY) {
     BOOST_CHECK(compare(fci_energy("hf_sto3g_fci_kh"), reference_fci_energy()));
+    BOOST_CHECK(compare(fci_energy("hf_sto3g_fci_kh_block"), reference_fci_energy()));
 #ifndef DISABLE_SERIALIZATION
 //  BOOST_CHECK(compare(fci_energy("hf_sto3g_fci_restart"), reference_fci_energy()));
 #endif
@@ -112,6 +113,7 @@ BOOST_AUTO_TEST_CASE(KNOWLES_HANDY) {
 
 BOOST_AUTO_TEST_CASE(HARRISON_ZARRABIAN) {
     BOOST_CHECK(compare(fci_energy("hf_sto3g_fci_hz"), reference_fci_energy()));
+    BOOST_CHECK(compare(fci_energy("hf_sto3g_fci_hz_block"), reference_fci_energy()));
     BOOST_CHECK(compare(fci_energy("hhe_svp_fci_hz_trip"), reference_fci_energy2()));
 }
 
@@ -62,6 +62,7 @@ BOOST_AUTO_TEST_SUITE(TEST_KS)
 
 BOOST_AUTO_TEST_CASE(DF_KS) {
     BOOST_CHECK(compare(ks_energy("hf_svp_b3lyp"),         -100.28959774));
+    BOOST_CHECK(compare(ks_energy("hf_svp_b3lyp_screened"), -100.28959774));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: test_math.cc
+// Copyright (C) 2026 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <src/util/math/btas_interface.h>
+
+using namespace bagel;
+
+// Tensors of different sizes (and pool size classes) are moved and swapped into each other and reallocated afterwards.
+// The capacity handed back to the allocator has to follow the buffer, since PoolAllocator derives the size class from it.
+bool tensor_move() {
+  const size_t n0 = BufferPool::min_bytes / sizeof(double) * 3;
+  const size_t n1 = BufferPool::min_bytes / sizeof(double) * 17;
+  const size_t n2 = BufferPool::min_bytes / sizeof(double) * 5;
+
+  auto consistent = [](const btas::Tensor1<double>& t, const double val) {
+    return t.storage().capacity() == t.size() && std::all_of(t.begin(), t.end(), [&val](const double& i) { return i == val; });
+  };
+
+  bool out = true;
+  for (int iter = 0; iter != 4; ++iter) {
+    btas::Tensor1<double> a(n0), b(n1), c(n2);
+    std::fill(a.begin(), a.end(), 1.0);
+    std::fill(b.begin(), b.end(), 2.0);
+    std::fill(c.begin(), c.end(), 3.0);
+
+    a = std::move(b);
+    out &= consistent(a, 2.0);
+    std::swap(a, c);
+    out &= consistent(a, 3.0) && consistent(c, 2.0);
+    c = btas::Tensor1<double>(n0);
+    std::fill(c.begin(), c.end(), 4.0);
+    out &= consistent(c, 4.0);
+
+    // the buffers released above are handed out again
+    btas::Tensor1<double> d(n1), e(n2), f(n0);
+    std::fill(d.begin(), d.end(), 5.0);
+    std::fill(e.begin(), e.end(), 6.0);
+    std::fill(f.begin(), f.end(), 7.0);
+    out &= consistent(a, 3.0) && consistent(c, 4.0) && consistent(d, 5.0) && consistent(e, 6.0) && consistent(f, 7.0);
+  }
+  return out;
+}
+
+BOOST_AUTO_TEST_SUITE(TEST_MATH)
+
+BOOST_AUTO_TEST_CASE(BUFFER_POOL) {
+    BOOST_CHECK(tensor_move());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,9 @@
 //
 
 #include <sstream>
+#include <cstdio>
+#include <dirent.h>
+#include <unistd.h>
 #include <src/scf/hf/rhf.h>
 #include <src/scf/hf/rohf.h>
 #include <src/scf/hf/uhf.h>
@@ -31,18 +34,14 @@
 
 using namespace bagel;
 
-double scf_energy(std::string filename, std::string extension = ".json") {
+double scf_energy(const std::vector<std::shared_ptr<const PTree>>& keys, std::string filename) {
   auto ofs = std::make_shared<std::ofstream>(filename + ".testout", std::ios::trunc);
   std::streambuf* backup_stream = std::cout.rdbuf(ofs->rdbuf());
 
-  // a bit ugly to hardwire an input file, but anyway...
-  std::stringstream ss; ss << location__ << filename << extension;
-  auto idata = std::make_shared<const PTree>(ss.str());
-  auto keys = idata->get_child("bagel");
   std::shared_ptr<Geometry> geom;
   std::shared_ptr<const Reference> ref;
 
-  for (auto& itree : *keys) {
+  for (auto& itree : keys) {
     const std::string method = to_lower(itree->get<std::string>("title", ""));
 
     if (method == "molecule") {
@@ -81,11 +80,72 @@ double scf_energy(std::string filename, std::string extension = ".json") {
   return ref->energy(0);
 }
 
+std::vector<std::shared_ptr<const PTree>> scf_input(std::string filename, std::string extension = ".json") {
+  // a bit ugly to hardwire an input file, but anyway...
+  std::stringstream ss; ss << location__ << filename << extension;
+  auto idata = std::make_shared<const PTree>(ss.str());
+  std::vector<std::shared_ptr<const PTree>> keys;
+  for (auto& itree : *idata->get_child("bagel"))
+    keys.push_back(itree);
+  return keys;
+}
+
+double scf_energy(std::string filename, std::string extension = ".json") {
+  return scf_energy(scf_input(filename, extension), filename);
+}
+
+// runs the input twice with the DF integral cache in a new temporary directory.
+// The first run has to compute the integrals and the second one has to load them, giving the same energy.
+double scf_energy_dfcache(std::string filename) {
+  char dir[] = "/tmp/bagel_dfcache_XXXXXX";
+  if (!mkdtemp(dir))
+    throw std::runtime_error("could not create a temporary directory for the DF cache test");
+
+  std::vector<std::shared_ptr<const PTree>> keys;
+  for (auto& itree : scf_input(filename)) {
+    auto tmp = std::make_shared<PTree>(*itree);
+    if (to_lower(tmp->get<std::string>("title", "")) == "molecule")
+      tmp->put<std::string>("df_cache", dir);
+    keys.push_back(tmp);
+  }
+
+  auto loaded = [&filename]() {
+    std::ifstream fs(filename + ".testout");
+    const std::string out((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+    return out.find("3-index integrals are loaded from") != std::string::npos;
+  };
+  const double first = scf_energy(keys, filename);
+  BOOST_CHECK(!loaded());
+  const double second = scf_energy(keys, filename);
+  BOOST_CHECK(loaded());
+  BOOST_CHECK(compare(first, second, 1.0e-10));
+
+  if (DIR* d = opendir(dir)) {
+    while (dirent* e = readdir(d)) {
+      const std::string name = e->d_name;
+      if (name != "." && name != "..")
+        std::remove((std::string(dir) + "/" + name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir);
+  return second;
+}
+
 BOOST_AUTO_TEST_SUITE(TEST_SCF)
 
 BOOST_AUTO_TEST_CASE(DF_HF) {
     BOOST_CHECK(compare(scf_energy("hf_svp_hf"),          -99.84779026));
+    BOOST_CHECK(compare(scf_energy("hf_svp_hf_rebuild"),  -99.84779026));
+    BOOST_CHECK(compare(scf_energy("hf_svp_hf_sym"),      -99.84779026));
+    BOOST_CHECK(compare(scf_energy("hf_svp_hf_qqr"),      -99.84779026));
     BOOST_CHECK(compare(scf_energy("hf_svp_dfhf"),        -99.84772354));
+    BOOST_CHECK(compare(scf_energy("hf_svp_dfhf_sym"),    -99.84772354));
+    BOOST_CHECK(compare(scf_energy("hf_svp_dfhf_sparse"), -99.84772354));
+    BOOST_CHECK(compare(scf_energy("hf_svp_dfhf_disk"),   -99.84772354));
+    BOOST_CHECK(compare(scf_energy_dfcache("hf_svp_dfhf_cache"),  -99.84772354));
+    BOOST_CHECK(compare(scf_energy("hf_svp_dfhf_localk"), -199.86913495));
+    BOOST_CHECK(compare(scf_energy("hf_svp_cdhf"),        -99.84779026, 1.0e-6));
 #ifndef DISABLE_SERIALIZATION
     BOOST_CHECK(compare(scf_energy("hf_svp_dfhf_restart"),-99.84772354));
 #endif
@@ -30,6 +30,8 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <limits>
 #include <src/util/math/factorial.h>
 
 namespace bagel {
@@ -76,6 +78,62 @@ class MSphBesselI {
 
 };
 
+
+// e^{-x} i_l(x) for all l <= lmax at once. For x <= 16, it is evaluated by a Taylor expansion about the nearest point of a table,
+// whose derivatives follow from s_l' = (l s_{l-1} + (l+1) s_{l+1})/(2l+1) - s_l with s_l = e^{-x} i_l(x).
+class MSphBesselITable {
+
+  public:
+    static constexpr int max_l = 24;
+
+  private:
+    static constexpr int order = 8;
+    static constexpr int ngrid = 257;
+    static constexpr double xmax = 16.0;
+
+    const MSphBesselI bessel_;
+    // [grid][order][l]; the k-th derivatives are divided by k!
+    std::vector<double> table_;
+
+  public:
+    MSphBesselITable() : table_(ngrid * (order+1) * (max_l+1)) {
+      const int lsize = max_l + order + 1;
+      std::vector<double> d(lsize), dn(lsize);
+      for (int g = 0; g != ngrid; ++g) {
+        // at x = 0, the values are set explicitly since MSphBesselI covers only l <= 10 there
+        for (int l = 0; l != lsize; ++l)
+          d[l] = g == 0 ? (l == 0 ? 1.0 : 0.0) : bessel_.compute(l, g * xmax / (ngrid-1));
+        double fac = 1.0;
+        for (int k = 0; k <= order; ++k) {
+          fac /= std::max(k, 1);
+          for (int l = 0; l <= max_l; ++l)
+            table_[(g*(order+1) + k)*(max_l+1) + l] = d[l] * fac;
+          // after k+1 derivatives, the values are valid for l < lsize-k-1
+          for (int l = 0; l < lsize-k-1; ++l)
+            dn[l] = ((l > 0 ? l * d[l-1] : 0.0) + (l+1) * d[l+1]) / (2*l+1) - d[l];
+          std::swap(d, dn);
+        }
+      }
+    }
+
+    void compute(const int lmax, const double x, double* out) const {
+      if (lmax > max_l || x > xmax) {
+        for (int l = 0; l <= lmax; ++l)
+          out[l] = bessel_.compute(l, x);
+        return;
+      }
+      const int g = static_cast<int>(std::lround(x * (ngrid-1) / xmax));
+      const double dx = x - g * xmax / (ngrid-1);
+      const double* const coeff = table_.data() + g*(order+1)*(max_l+1);
+      for (int l = 0; l <= lmax; ++l)
+        out[l] = coeff[order*(max_l+1) + l];
+      for (int k = order-1; k >= 0; --k)
+        for (int l = 0; l <= lmax; ++l)
+          out[l] = out[l] * dx + coeff[k*(max_l+1) + l];
+    }
+
+};
+
 }
 
 #endif
@@ -9,12 +9,13 @@
 #include <boost/serialization/split_free.hpp>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/collection_size_type.hpp>
+#include <src/util/math/bufferpool.h>
 
 namespace bagel {
 
-/// variable size array class *with* capacity info
+/// variable size array class *with* capacity info; large buffers are recycled through BufferPool
 template <typename _T,
-          typename _Allocator = std::allocator<_T> >
+          typename _Allocator = PoolAllocator<_T> >
 class varray : private _Allocator {
 public:
 
@@ -91,10 +92,8 @@ private:
 
      void swap (_M_impl& other)
      {
-       _M_start = other._M_start;
-       _M_finish = other._M_finish;
-       other._M_start = nullptr;
-       other._M_finish = nullptr;
+       std::swap(_M_start, other._M_start);
+       std::swap(_M_finish, other._M_finish);
      }
    };
    _M_impl data_;
@@ -168,6 +167,7 @@ public:
    varray (varray&& x)
    : allocator_type(std::move(static_cast<allocator_type&&>(x))), data_(std::move(x.data_)), capacity_(x.capacity_)
    {
+     x.capacity_ = 0;
    }
 
    template <typename U, class = typename std::enable_if< std::is_convertible<U, value_type>::value >::type >
@@ -196,7 +196,11 @@ public:
 
    varray& operator= (varray&& x)
    {
-      swap (x); // if something in this object, it will be destructed by x
+      // the allocator is told the capacity on deallocation (PoolAllocator derives the size class from it)
+      if (this != &x) {
+        deallocate();
+        swap (x);
+      }
       return *this;
    }
 
@@ -276,9 +280,7 @@ public:
    {
      if (size() != n) {
        if (n > capacity_) {
-         if (!empty()) {
-           deallocate();
-         }
+         deallocate();
          if (n > 0) {
            allocate(n);
          }
@@ -328,13 +330,14 @@ public:
    { return data_.data(); }
 
    void swap (varray& x)
-   { data_.swap(x.data_); }
+   {
+     data_.swap(x.data_);
+     std::swap(capacity_, x.capacity_);
+   }
 
    void clear ()
    {
-      if (!empty()) {
-        deallocate();
-      }
+      deallocate();
    }
 
   private:
@@ -347,7 +350,8 @@ public:
    }
 
    void deallocate() {
-     if (!data_.empty())
+     // the buffer is held even when resized to zero
+     if (data_._M_start)
        allocator_traits::deallocate(alloc(), data_._M_start, capacity_);
      data_._M_start = data_._M_finish = nullptr;
      capacity_ = 0;
@@ -392,6 +396,14 @@ public:
    }
 };
 
+// btas calls begin() and the like unqualified; with PoolAllocator, std is no longer an associated namespace of varray
+template <typename T> inline auto begin(varray<T>& x) -> decltype(x.begin()) { return x.begin(); }
+template <typename T> inline auto begin(const varray<T>& x) -> decltype(x.begin()) { return x.begin(); }
+template <typename T> inline auto cbegin(const varray<T>& x) -> decltype(x.cbegin()) { return x.cbegin(); }
+template <typename T> inline auto end(varray<T>& x) -> decltype(x.end()) { return x.end(); }
+template <typename T> inline auto end(const varray<T>& x) -> decltype(x.end()) { return x.end(); }
+template <typename T> inline auto cend(const varray<T>& x) -> decltype(x.cend()) { return x.cend(); }
+
 template <typename T>
 inline bool operator== (const bagel::varray<T>& a,
                         const bagel::varray<T>& b) {
@@ -0,0 +1,110 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: bufferpool.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <sstream>
+#include <iomanip>
+#include <src/global.h>
+#include <src/util/math/bufferpool.h>
+
+using namespace std;
+using namespace bagel;
+
+constexpr int BufferPool::min_log2;
+constexpr size_t BufferPool::min_bytes;
+constexpr int BufferPool::nclass;
+
+BufferPool::BufferPool() : max_cached_(1024LU << 20), cached_(0LU), peak_cached_(0LU), nalloc_(0LU), nreuse_(0LU) {
+  const string size = getenv_multiple("BAGEL_BUFFER_POOL");
+  if (!size.empty())
+    max_cached_ = stoul(size) << 20;
+}
+
+
+int BufferPool::size_class(const size_t bytes) {
+  // bytes is rounded up to 2^e, 1.25*2^e, 1.5*2^e, 1.75*2^e; 2^(e+1) is the first class of the next octave
+  const int e = 63 - __builtin_clzl(bytes);
+  const size_t step = (1LU << e) >> 2;
+  const int k = (bytes - (1LU << e) + step - 1) / step;
+  return (e - min_log2)*4 + k;
+}
+
+
+size_t BufferPool::class_bytes(const int c) {
+  return ((1LU << (c/4 + min_log2)) >> 2) * (4 + c%4);
+}
+
+
+void* BufferPool::allocate(const size_t bytes) {
+  const int c = size_class(bytes);
+  if (c >= nclass)
+    return ::operator new(bytes);
+  {
+    lock_guard<mutex> lock(mutex_);
+    ++nalloc_;
+    if (!free_[c].empty()) {
+      void* out = free_[c].back();
+      free_[c].pop_back();
+      cached_ -= class_bytes(c);
+      ++nreuse_;
+      return out;
+    }
+  }
+  return ::operator new(class_bytes(c));
+}
+
+
+void BufferPool::deallocate(void* p, const size_t bytes) {
+  const int c = size_class(bytes);
+  if (c < nclass) {
+    lock_guard<mutex> lock(mutex_);
+    if (cached_ + class_bytes(c) <= max_cached_) {
+      free_[c].push_back(p);
+      cached_ += class_bytes(c);
+      peak_cached_ = max(peak_cached_, cached_);
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
+
+void BufferPool::clear() {
+  lock_guard<mutex> lock(mutex_);
+  for (auto& i : free_) {
+    for (auto& j : i)
+      ::operator delete(j);
+    i.clear();
+  }
+  cached_ = 0LU;
+}
+
+
+string BufferPool::statistics() const {
+  lock_guard<mutex> lock(mutex_);
+  stringstream ss;
+  ss << "  buffer pool: " << nreuse_ << " of " << nalloc_ << " allocations reused, "
+     << setprecision(1) << fixed << cached_ / 1048576.0 << " MB cached (peak " << peak_cached_ / 1048576.0 << " MB)";
+  return ss.str();
+}
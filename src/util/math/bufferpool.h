@@ -0,0 +1,107 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: bufferpool.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __SRC_MATH_BUFFERPOOL_H
+#define __SRC_MATH_BUFFERPOOL_H
+
+#include <array>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace bagel {
+
+// Cache of large buffers sorted into size classes (four per power of two), so that the storage of matrices and tensors
+// that are created in every iteration is reused rather than mapped and faulted in again. Buffers smaller than min_bytes
+// are left to the regular allocator. The total size of cached buffers is limited by BAGEL_BUFFER_POOL (in MB, 0 disables).
+class BufferPool {
+  public:
+    static constexpr int min_log2 = 17;
+    static constexpr size_t min_bytes = 1LU << min_log2;
+
+  protected:
+    static constexpr int nclass = 4*(40 - min_log2);
+
+    std::array<std::vector<void*>, nclass> free_;
+    mutable std::mutex mutex_;
+
+    size_t max_cached_;
+    size_t cached_;
+    size_t peak_cached_;
+    size_t nalloc_;
+    size_t nreuse_;
+
+    BufferPool();
+
+    static int size_class(const size_t bytes);
+    static size_t class_bytes(const int c);
+
+  public:
+    // never destructed, since buffers may be returned by static objects at exit
+    static BufferPool& get() { static BufferPool* pool = new BufferPool(); return *pool; }
+
+    void* allocate(const size_t bytes);
+    void deallocate(void* p, const size_t bytes);
+
+    // returns all the cached buffers to the system
+    void clear();
+
+    std::string statistics() const;
+};
+
+
+// Allocator for bagel::varray, i.e., the storage of btas tensors, Matrix and ZMatrix
+template <typename T>
+class PoolAllocator {
+  public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) { }
+
+    T* allocate(const size_t n) {
+      const size_t bytes = n * sizeof(T);
+      return static_cast<T*>(bytes < BufferPool::min_bytes ? ::operator new(bytes) : BufferPool::get().allocate(bytes));
+    }
+
+    void deallocate(T* p, const size_t n) {
+      const size_t bytes = n * sizeof(T);
+      if (bytes < BufferPool::min_bytes)
+        ::operator delete(p);
+      else
+        BufferPool::get().deallocate(p, bytes);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+}
+
+#endif
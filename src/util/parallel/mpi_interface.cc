@@ -86,17 +86,25 @@ MPI_Interface::MPI_Interface()
 
   // set MPI_COMM_WORLD to mpi_comm_
   mpi_comm_ = MPI_COMM_WORLD;
+
+  // processes that share memory
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, world_rank_, MPI_INFO_NULL, &node_comm_);
+  MPI_Comm_rank(node_comm_, &node_rank_);
+  MPI_Comm_size(node_comm_, &node_size_);
 #else
   world_rank_ = 0;
   world_size_ = 1;
   rank_ = world_rank_;
   size_ = world_size_;
+  node_rank_ = 0;
+  node_size_ = 1;
 #endif
 }
 
 
 MPI_Interface::~MPI_Interface() {
 #ifdef HAVE_MPI_H
+  MPI_Comm_free(&node_comm_);
 #ifndef HAVE_SCALAPACK
   MPI_Finalize();
 #else
@@ -144,6 +152,37 @@ void MPI_Interface::allreduce(complex<double>* a, const size_t size) const {
 }
 
 
+int MPI_Interface::request_allreduce(double* a, const size_t size) {
+#ifdef HAVE_MPI_H
+  assert(size != 0);
+  vector<MPI_Request> rq;
+  const int nbatch = (size-1)/bsize  + 1;
+  for (int i = 0; i != nbatch; ++i) {
+    MPI_Request c;
+    MPI_Iallreduce(MPI_IN_PLACE, static_cast<void*>(a+i*bsize), (i+1 == nbatch ? size-i*bsize : bsize), MPI_DOUBLE, MPI_SUM, mpi_comm_, &c);
+    rq.push_back(c);
+  }
+#endif
+  lock_guard<mutex> lock(mpimutex_);
+#ifdef HAVE_MPI_H
+  request_.emplace(cnt_, rq);
+#endif
+  ++cnt_;
+  return cnt_-1;
+}
+
+
+void MPI_Interface::reduce_scatter(const double* send, double* rec, const vector<int>& counts) const {
+  assert(counts.size() == size_);
+#ifdef HAVE_MPI_H
+  // I hate const_cast. Blame the MPI C binding
+  MPI_Reduce_scatter(const_cast<void*>(static_cast<const void*>(send)), static_cast<void*>(rec), const_cast<int*>(counts.data()), MPI_DOUBLE, MPI_SUM, mpi_comm_);
+#else
+  copy_n(send, counts.front(), rec);
+#endif
+}
+
+
 void MPI_Interface::broadcast(size_t* a, const size_t size, const int root) const {
 #ifdef HAVE_MPI_H
   static_assert(sizeof(size_t) == sizeof(unsigned long long), "size_t is assumed to be the same size as unsigned long long");
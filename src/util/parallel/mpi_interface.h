@@ -45,11 +45,15 @@ class MPI_Interface {
     int rank_;
     int size_;
     int depth_;
+    // processes on the same node (i.e., those that can share memory)
+    int node_rank_;
+    int node_size_;
 
     int cnt_;
     // request handles
 #ifdef HAVE_MPI_H
     MPI_Comm mpi_comm_;
+    MPI_Comm node_comm_;
     std::map<int, std::vector<MPI_Request>> request_;
     std::vector<std::pair<MPI_Comm,std::array<int,5>>> mpi_comm_old_;
 #endif
@@ -81,6 +85,8 @@ class MPI_Interface {
     int size() const { return size_; }
     int depth() const { return depth_; }
     bool last() const { return rank() == size()-1; }
+    int node_rank() const { return node_rank_; }
+    int node_size() const { return node_size_; }
 
     // collective functions
     // barrier
@@ -89,6 +95,10 @@ class MPI_Interface {
     void allreduce(int*, const size_t size) const;
     void allreduce(double*, const size_t size) const;
     void allreduce(std::complex<double>*, const size_t size) const;
+    // non-blocking sum reduce; the returned handle is to be passed to wait()
+    int request_allreduce(double*, const size_t size);
+    // sum reduce, after which each process receives counts[rank] elements (in the order of the ranks)
+    void reduce_scatter(const double* send, double* rec, const std::vector<int>& counts) const;
     // broadcast
     void broadcast(size_t*, const size_t size, const int root) const;
     void broadcast(double*, const size_t size, const int root) const;
@@ -119,6 +129,8 @@ class MPI_Interface {
 #ifdef HAVE_MPI_H
     // communicators. n is the number of processes per communicator.
     const MPI_Comm& mpi_comm() const { return mpi_comm_; }
+    // communicator of the processes on this node, taken from MPI_COMM_WORLD (not affected by split)
+    const MPI_Comm& node_comm() const { return node_comm_; }
 #endif
     void split(const int n);
     void merge();
@@ -27,8 +27,20 @@
 using namespace std;
 using namespace bagel;
 
-StackMem::StackMem() : pointer_(0LU), total_(20000000LU) { // TODO this should not be hardwired
-  stack_area_ = unique_ptr<double[]>(new double[total_]);
+namespace {
+  // stacks that belong to the calling thread. More than one is used when integral objects are nested.
+  struct LocalStacks {
+    const Resources* owner = nullptr;
+    vector<shared_ptr<StackMem>> stacks;
+  };
+  thread_local LocalStacks local_stacks;
+}
+
+
+StackMem::StackMem() : current_(0LU), total_(20000000LU), used_(0LU), high_water_(0LU) { // TODO this should not be hardwired
+  // pages are not touched here; they are mapped when the owning thread first writes to them
+  chunks_.push_back(Chunk{unique_ptr<double[]>(new double[total_]), total_, 0LU});
+  in_use_.clear();
 
   // in case we use Libint for ERI
 #ifdef LIBINT_INTERFACE
@@ -42,30 +54,76 @@ StackMem::StackMem() : pointer_(0LU), total_(20000000LU) { // TODO this should n
 }
 
 
-Resources::Resources(const int max) : proc_(make_shared<Process>()), max_num_threads_(max) {
+void StackMem::next_chunk(const size_t size) {
+  // chunks after the current one are empty, as the stack is last-in-first-out
+  ++current_;
+  if (current_ == chunks_.size())
+    chunks_.push_back(Chunk{nullptr, 0LU, 0LU});
+  Chunk& chunk = chunks_[current_];
+  assert(chunk.pointer == 0LU);
+  if (chunk.size < size) {
+    chunk.size = max(total_, size);
+    chunk.area.reset();
+    chunk.area = unique_ptr<double[]>(new double[chunk.size]);
+  }
+}
+
+
+void StackMem::clear() {
+  for (auto& i : chunks_)
+    i.pointer = 0LU;
+  current_ = 0LU;
+  used_ = 0LU;
+}
+
+
+Resources::Resources(const int max) : proc_(make_shared<Process>()), max_num_threads_(max), pool_(make_shared<ThreadPool>(max)) {
 #ifdef LIBINT_INTERFACE
   LIBINT2_PREFIXED_NAME(libint2_static_init)();
 #endif
-  for (int i = 0; i != max; ++i)
-    stackmem_[make_shared<StackMem>()].clear();
 }
 
 
 shared_ptr<StackMem> Resources::get() {
-  for (auto& i : stackmem_) {
-    if (!i.second.test_and_set())
-      return i.first;
+  LocalStacks& local = local_stacks;
+  if (local.owner != this) {
+    local.owner = this;
+    local.stacks.clear();
   }
+  for (auto& i : local.stacks)
+    if (!i->in_use_.test_and_set())
+      return i;
+
   // This error most often occurs if we forget to destruct one integral object before constructing another
-  throw runtime_error("Stack Memory exhausted");
-  return nullptr;
+  if (local.stacks.size() >= max_num_threads_)
+    throw runtime_error("Stack Memory exhausted");
+
+  auto out = make_shared<StackMem>();
+  out->in_use_.test_and_set();
+  local.stacks.push_back(out);
+  lock_guard<mutex> lock(mutex_);
+  stackmem_.push_back(out);
+  return out;
 }
 
 
 void Resources::release(shared_ptr<StackMem> o) {
+  // may be called from a thread other than the owner
   o->clear();
-  auto iter = stackmem_.find(o);
-  assert(iter != stackmem_.end());
-  iter->second.clear();
+  o->in_use_.clear();
+}
+
+
+size_t Resources::stack_high_water() const {
+  lock_guard<mutex> lock(mutex_);
+  size_t out = 0LU;
+  for (auto& i : stackmem_)
+    out = max(out, i->high_water());
+  return out * sizeof(double);
 }
 
+
+size_t Resources::num_stacks() const {
+  lock_guard<mutex> lock(mutex_);
+  return stackmem_.size();
+}
@@ -34,46 +34,80 @@
 #include <cassert>
 #include <stdexcept>
 #include <complex>
-#include <map>
+#include <mutex>
+#include <algorithm>
 #ifdef LIBINT_INTERFACE
   #include <libint2.h>
 #endif
 #include <src/util/parallel/process.h>
+#include <src/util/parallel/threadpool.h>
 #include <src/util/constants.h>
 
 namespace bagel {
 
 class StackMem {
+  friend class Resources;
   protected:
-    std::unique_ptr<double[]> stack_area_;
-    size_t pointer_;
+    // the area is a list of chunks; a request that does not fit in the current chunk moves on to the next one,
+    // which is allocated when needed. Chunks are kept for reuse until the stack is destroyed.
+    struct Chunk {
+      std::unique_ptr<double[]> area;
+      size_t size;
+      size_t pointer;
+    };
+    std::vector<Chunk> chunks_;
+    size_t current_;
     const size_t total_;
 
+    // number of doubles in use, and its maximum over the lifetime of the stack
+    size_t used_;
+    size_t high_water_;
+
+    // set while the stack is handed out by Resources
+    std::atomic_flag in_use_;
+
 #ifdef LIBINT_INTERFACE
     std::unique_ptr<Libint_t[]> libint_t_;
 #endif
 
+    void next_chunk(const size_t size);
+
   public:
     StackMem();
 
     template <typename DataType = double>
     DataType* get(const size_t size) {
-      assert(pointer_ + size < total_);
       assert(size * sizeof(DataType) % sizeof(double) == 0);
-      DataType* out = reinterpret_cast<DataType*> (stack_area_.get() + pointer_);
-      pointer_ += (size * sizeof(DataType) / sizeof(double));
+      const size_t n = size * sizeof(DataType) / sizeof(double);
+      if (chunks_[current_].pointer + n > chunks_[current_].size)
+        next_chunk(n);
+      Chunk& chunk = chunks_[current_];
+      DataType* out = reinterpret_cast<DataType*> (chunk.area.get() + chunk.pointer);
+      chunk.pointer += n;
+      used_ += n;
+      high_water_ = std::max(high_water_, used_);
       return out;
     }
 
     template <typename DataType = double>
     void release(const size_t size, DataType* p) {
       assert(size * sizeof(DataType) % sizeof(double) == 0);
-      pointer_ -= (size * sizeof(DataType) / sizeof(double));
-      assert(p == reinterpret_cast<DataType*> (stack_area_.get()+pointer_) || size == 0);
+      const size_t n = size * sizeof(DataType) / sizeof(double);
+      if (n == 0) return;
+      Chunk& chunk = chunks_[current_];
+      assert(chunk.pointer >= n);
+      chunk.pointer -= n;
+      assert(p == reinterpret_cast<DataType*> (chunk.area.get()+chunk.pointer));
+      used_ -= n;
+      if (chunk.pointer == 0 && current_ > 0)
+        --current_;
     }
 
-    void clear() { pointer_ = 0LU; }
-    size_t pointer() const { return pointer_; }
+    void clear();
+    size_t pointer() const { return used_; }
+
+    size_t high_water() const { return high_water_; }
+    size_t num_chunks() const { return chunks_.size(); }
 
 #ifdef LIBINT_INTERFACE
     Libint_t* libint_t_ptr(const int i) { return &libint_t_[i]; }
@@ -82,11 +116,17 @@ class StackMem {
 };
 
 
+// Stacks are owned by threads: get() returns a free stack of the calling thread from a thread-local list, and
+// creates one when there is none. Since the stacks are created (and their pages first written) by the thread that
+// uses them, they are placed on the NUMA node of that thread by the first-touch policy of the operating system.
 class Resources {
   private:
     std::shared_ptr<Process> proc_;
-    std::map<std::shared_ptr<StackMem>, std::atomic_flag> stackmem_;
+    // all the stacks created so far (only used for statistics)
+    std::vector<std::shared_ptr<StackMem>> stackmem_;
+    mutable std::mutex mutex_;
     size_t max_num_threads_;
+    std::shared_ptr<ThreadPool> pool_;
 
   public:
     Resources(const int max);
@@ -94,8 +134,13 @@ class Resources {
     std::shared_ptr<StackMem> get();
     void release(std::shared_ptr<StackMem> o);
 
+    // largest use of a single stack (in bytes) and the number of stacks created so far
+    size_t stack_high_water() const;
+    size_t num_stacks() const;
+
     size_t max_num_threads() const { return max_num_threads_; }
     std::shared_ptr<Process> proc() { return proc_; }
+    std::shared_ptr<ThreadPool> pool() { return pool_; }
 };
 
 extern Resources* resources__;
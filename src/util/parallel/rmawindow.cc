@@ -340,7 +340,38 @@ void RMAWindow<DataType>::accumulate_buffer(const DataType a, const unique_ptr<D
 }
 
 
+template<typename DataType>
+RMAWindow_shared<DataType>::RMAWindow_shared(const size_t size) : size_(size), owner_(mpi__->node_rank() == 0) {
+#ifdef HAVE_MPI_H
+  // the first process on the node allocates the memory; the others obtain the address in their address space
+  MPI_Win_allocate_shared(localsize()*sizeof(DataType), sizeof(DataType), MPI_INFO_NULL, mpi__->node_comm(), &this->win_base_, &this->win_);
+  if (!owner_) {
+    MPI_Aint sz;
+    int disp;
+    MPI_Win_shared_query(this->win_, 0, &sz, &disp, &this->win_base_);
+    assert(sz == size_*sizeof(DataType));
+  }
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, this->win_);
+
+  this->initialized_ = true;
+  this->zero();
+#endif
+}
+
+
+template<typename DataType>
+void RMAWindow_shared<DataType>::sync() const {
+#ifdef HAVE_MPI_H
+  MPI_Win_sync(this->win_);
+  mpi__->barrier();
+  MPI_Win_sync(this->win_);
+#endif
+}
+
+
 template class bagel::RMATask<double>;
 template class bagel::RMATask<complex<double>>;
 template class bagel::RMAWindow<double>;
 template class bagel::RMAWindow<complex<double>>;
+template class bagel::RMAWindow_shared<double>;
+template class bagel::RMAWindow_shared<complex<double>>;
@@ -28,6 +28,8 @@
 #include <bagel_config.h>
 #include <complex>
 #include <memory>
+#include <tuple>
+#include <stdexcept>
 #ifdef HAVE_MPI_H
  #include <mpi.h>
 #endif
@@ -133,10 +135,38 @@ class RMAWindow_bare : public RMAWindow<DataType> {
 };
 
 
+// Window that is shared by the processes on a node using MPI-3 shared memory. The data are held once per node
+// (by the first process on the node) and are directly addressable by all the processes on it.
+// Construction is collective over all the processes.
+template<typename DataType>
+class RMAWindow_shared : public RMAWindow<DataType> {
+  protected:
+    size_t size_;
+    bool owner_;
+
+  public:
+    RMAWindow_shared(const size_t size);
+
+    // writing should be done by owner() (or on disjoint parts) and is visible to the others after sync()
+    DataType* data() { return this->win_base_; }
+    const DataType* data() const { return this->win_base_; }
+    size_t size() const { return size_; }
+    bool owner() const { return owner_; }
+    // MPI_Win_sync before and after a barrier, which orders the direct loads and stores of all the processes. Collective.
+    void sync() const;
+
+    bool is_local(const size_t key) const override { throw std::logic_error("RMAWindow_shared::is_local should not be called"); }
+    std::tuple<size_t, size_t, size_t> locate(const size_t key) const override { throw std::logic_error("RMAWindow_shared::locate should not be called"); }
+    size_t localsize() const override { return owner_ ? size_ : 0LU; }
+};
+
+
 extern template class RMATask<double>;
 extern template class RMATask<std::complex<double>>;
 extern template class RMAWindow<double>;
 extern template class RMAWindow<std::complex<double>>;
+extern template class RMAWindow_shared<double>;
+extern template class RMAWindow_shared<std::complex<double>>;
 
 }
 
@@ -0,0 +1,198 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: threadpool.cc
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <src/util/parallel/threadpool.h>
+
+using namespace std;
+using namespace bagel;
+
+ThreadPool::ThreadPool(const int max) : max_num_threads_(max), finish_(false) {
+}
+
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    finish_ = true;
+  }
+  start_.notify_all();
+  for (auto& i : threads_)
+    i.join();
+}
+
+
+void ThreadPool::run(const size_t ntask, const function<void(size_t)>& f, const int nthreads, const vector<double>& cost) {
+  if (ntask == 0) return;
+  if (ntask > 0xffffffffLU)
+    throw logic_error("too many tasks in ThreadPool::run");
+
+  const int n = min(static_cast<size_t>(min(nthreads, max_num_threads_)), ntask);
+  if (n <= 1) {
+    for (size_t i = 0; i != ntask; ++i)
+      f(i);
+    return;
+  }
+
+  auto job = make_shared<Job>(f, ntask, n);
+  distribute(*job, cost);
+  {
+    lock_guard<mutex> lock(mutex_);
+    // threads are spawned when first needed, and reused afterwards
+    if (threads_.empty())
+      for (int i = 1; i != max_num_threads_; ++i)
+        threads_.emplace_back(&ThreadPool::worker, this);
+    jobs_.push_back(job);
+  }
+  start_.notify_all();
+
+  work(*job, 0);
+
+  {
+    unique_lock<mutex> lock(mutex_);
+    // no one joins once the calling thread has run out of tasks
+    auto iter = find(jobs_.begin(), jobs_.end(), job);
+    if (iter != jobs_.end())
+      jobs_.erase(iter);
+    done_.wait(lock, [&job]{ return job->remaining == 0; });
+  }
+
+  if (job->error)
+    rethrow_exception(job->error);
+}
+
+
+void ThreadPool::distribute(Job& job, const vector<double>& cost) {
+  const size_t ntask = job.order.size();
+  const int nthreads = job.nslot;
+  if (cost.empty()) {
+    // contiguous blocks retain the locality of the original task order
+    iota(job.order.begin(), job.order.end(), 0LU);
+    const size_t chunk = ntask / nthreads;
+    const size_t rem = ntask % nthreads;
+    size_t offset = 0LU;
+    for (int i = 0; i != nthreads; ++i) {
+      const size_t size = chunk + (i < rem ? 1 : 0);
+      job.deque[i].range = pack(offset, offset+size);
+      offset += size;
+    }
+  } else {
+    assert(cost.size() == ntask);
+    // largest tasks first, each assigned to the least loaded thread (LPT). Small tasks end up at the back of the deques and are stolen.
+    vector<size_t> sorted(ntask);
+    iota(sorted.begin(), sorted.end(), 0LU);
+    stable_sort(sorted.begin(), sorted.end(), [&cost](const size_t a, const size_t b) { return cost[a] > cost[b]; });
+
+    using Load = pair<double,int>;
+    priority_queue<Load, vector<Load>, greater<Load>> load;
+    for (int i = 0; i != nthreads; ++i)
+      load.emplace(0.0, i);
+    vector<vector<size_t>> assigned(nthreads);
+    for (auto& i : sorted) {
+      Load l = load.top();
+      load.pop();
+      assigned[l.second].push_back(i);
+      load.emplace(l.first + cost[i], l.second);
+    }
+
+    auto iter = job.order.begin();
+    for (int i = 0; i != nthreads; ++i) {
+      const size_t offset = iter - job.order.begin();
+      iter = copy(assigned[i].begin(), assigned[i].end(), iter);
+      job.deque[i].range = pack(offset, offset+assigned[i].size());
+    }
+  }
+}
+
+
+void ThreadPool::worker() {
+  while (true) {
+    shared_ptr<Job> job;
+    int id;
+    {
+      unique_lock<mutex> lock(mutex_);
+      start_.wait(lock, [this]{ return finish_ || !jobs_.empty(); });
+      if (finish_) return;
+      // the newest job first, so that nested calls, whose callers are blocked, finish early
+      job = jobs_.back();
+      id = job->joined++;
+      if (job->joined == job->nslot)
+        jobs_.pop_back();
+    }
+    work(*job, id);
+  }
+}
+
+
+void ThreadPool::work(Job& job, const int id) {
+  size_t task;
+  do {
+    while (pop(job, id, task)) {
+      try {
+        (*job.func)(job.order[task]);
+      } catch (...) {
+        lock_guard<mutex> lock(job.error_mutex);
+        if (!job.error)
+          job.error = current_exception();
+      }
+      if (--job.remaining == 0) {
+        lock_guard<mutex> lock(mutex_);
+        done_.notify_all();
+      }
+    }
+  } while (steal(job, id));
+}
+
+
+bool ThreadPool::pop(Job& job, const int id, size_t& task) {
+  Deque& own = job.deque[id];
+  uint64_t r = own.range.load();
+  while (begin(r) < end(r)) {
+    if (own.range.compare_exchange_weak(r, pack(begin(r)+1, end(r)))) {
+      task = begin(r);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool ThreadPool::steal(Job& job, const int id) {
+  for (int k = 1; k != job.nslot; ++k) {
+    Deque& victim = job.deque[(id+k) % job.nslot];
+    uint64_t r = victim.range.load();
+    while (begin(r) < end(r)) {
+      const size_t take = (end(r) - begin(r) + 1) / 2;
+      if (victim.range.compare_exchange_weak(r, pack(begin(r), end(r)-take))) {
+        job.deque[id].range = pack(end(r)-take, end(r));
+        return true;
+      }
+    }
+  }
+  return false;
+}
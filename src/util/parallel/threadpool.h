@@ -0,0 +1,100 @@
+//
+// BAGEL - Brilliantly Advanced General Electronic Structure Library
+// Filename: threadpool.h
+// Copyright (C) 2020 Toru Shiozaki
+//
+// Author: Shiozaki group <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the BAGEL package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __SRC_PARALLEL_THREADPOOL_H
+#define __SRC_PARALLEL_THREADPOOL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bagel {
+
+// Persistent pool of worker threads with work stealing. The calling thread participates as the first slot of its job.
+// Tasks are first distributed to per-slot deques (contiguously, or greedily by cost when hints are given);
+// each thread consumes its own deque from the front, and idle threads steal half of the remainder from the back of others.
+// Nested or concurrent calls create separate jobs that idle workers join, so that they share the pool.
+class ThreadPool {
+  protected:
+    // [begin, end) of a slot's share of the task order, packed into one word so that owner and thieves can CAS it.
+    // Padded to a cache line so that neighboring deques are not falsely shared.
+    struct Deque {
+      std::atomic<uint64_t> range;
+      char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    static uint64_t pack(const uint64_t b, const uint64_t e) { return (b << 32) | e; }
+    static size_t begin(const uint64_t r) { return r >> 32; }
+    static size_t end(const uint64_t r) { return r & 0xffffffffLU; }
+
+    // one call to run()
+    struct Job {
+      const std::function<void(size_t)>* func;
+      const int nslot;
+      int joined;
+      std::unique_ptr<Deque[]> deque;
+      std::vector<size_t> order;
+      std::atomic<size_t> remaining;
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      Job(const std::function<void(size_t)>& f, const size_t ntask, const int n)
+        : func(&f), nslot(n), joined(1), deque(new Deque[n]), order(ntask), remaining(ntask) { }
+    };
+
+    const int max_num_threads_;
+    std::vector<std::thread> threads_;
+
+    // synchronization of the workers; jobs_ holds the jobs that still have free slots, newest last
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    std::vector<std::shared_ptr<Job>> jobs_;
+    bool finish_;
+
+    void worker();
+    void work(Job& job, const int id);
+    bool pop(Job& job, const int id, size_t& task);
+    bool steal(Job& job, const int id);
+
+    void distribute(Job& job, const std::vector<double>& cost);
+
+  public:
+    ThreadPool(const int max);
+    ~ThreadPool();
+
+    // runs f(i) for i in [0, ntask) using up to nthreads threads; cost (optional) is used for the initial distribution.
+    void run(const size_t ntask, const std::function<void(size_t)>& f, const int nthreads, const std::vector<double>& cost = std::vector<double>());
+
+    int max_num_threads() const { return max_num_threads_; }
+};
+
+}
+
+#endif
@@ -34,7 +34,8 @@
 #include <utility>
 #include <thread>
 #include <algorithm>
-
+#include <type_traits>
+#include <cassert>
 #include <vector>
 #include <bagel_config.h>
 #ifdef HAVE_MKL_H
@@ -44,6 +45,8 @@
 
 namespace bagel {
 
+// Tasks are run on the persistent work-stealing pool in Resources.
+// If a task class has "double cost() const", it is used as a hint for the initial distribution.
 template<typename T>
 class TaskQueue {
 
@@ -65,10 +68,28 @@ class TaskQueue {
     template<typename U> void call_compute(U& task)                  { call<U, has_compute<U>::value>::compute(task); }
     template<typename U> void call_compute(std::shared_ptr<U>& task) { call<U, has_compute<U>::value>::compute(*task); }
 
+    template <class U>
+    struct has_cost {
+      protected:
+        template<class V> static auto __cost(const V* p) -> decltype(p->cost(), std::true_type());
+        template<class  > static std::false_type __cost(...);
+      public:
+        static constexpr const bool value = std::is_same<std::true_type, decltype(__cost<U>(0))>::value;
+    };
+    template<typename U, bool>
+    struct cost_of       { static double cost(const U& task) { return task.cost(); } };
+    template<typename U>
+    struct cost_of<U, false> { static double cost(const U& task) { return 1.0; } };
+    template<typename U> struct has_cost_ptr { static constexpr const bool value = has_cost<U>::value; };
+    template<typename U> struct has_cost_ptr<std::shared_ptr<U>> { static constexpr const bool value = has_cost<U>::value; };
+    template<typename U> double call_cost(const U& task)                  const { return cost_of<U, has_cost<U>::value>::cost(task); }
+    template<typename U> double call_cost(const std::shared_ptr<U>& task) const { return cost_of<U, has_cost<U>::value>::cost(*task); }
+
   protected:
     std::vector<T> task_;
-    std::list<std::atomic_flag> flag_;
+#ifdef _OPENMP
     static const int chunck_ = 12;
+#endif
 
   public:
     TaskQueue(size_t expected = 0) { task_.reserve(expected); }
@@ -84,12 +105,13 @@ class TaskQueue {
       mkl_set_num_threads(1);
 #endif
 #ifndef _OPENMP
-      flag_.resize((task_.size()-1)/chunck_+1);
-      std::for_each(flag_.begin(), flag_.end(), [](std::atomic_flag& i){ i.clear(); });
-      std::list<std::thread> threads;
-      for (int i = 0; i != num_threads; ++i)
-        threads.emplace_back(&TaskQueue<T>::compute_one_thread, this);
-      std::for_each(threads.begin(), threads.end(), [](std::thread& i){ i.join(); });
+      std::vector<double> cost;
+      if (has_cost_ptr<T>::value) {
+        cost.reserve(task_.size());
+        for (auto& i : task_)
+          cost.push_back(call_cost(i));
+      }
+      resources__->pool()->run(task_.size(), [this](const size_t i) { call_compute(task_[i]); }, num_threads, cost);
 #else
       const size_t n = task_.size();
       #pragma omp parallel for schedule(dynamic,chunck_)
@@ -100,16 +122,6 @@ class TaskQueue {
       mkl_set_num_threads(mkl_num);
 #endif
     }
-
-    void compute_one_thread() {
-      int j = 0;
-      for (auto i = flag_.begin(); i != flag_.end(); ++i, j += chunck_)
-        if (!i->test_and_set()) {
-          call_compute(task_[j]);
-          for (int k = 1; k < chunck_; ++k)
-            if (j+k < task_.size()) call_compute(task_[j+k]);
-        }
-    }
 };
 
 }
@@ -25,13 +25,15 @@
 
 #include <src/wfn/geometry.h>
 #include <src/df/complexdf.h>
+#include <src/df/dfcache.h>
+#include <src/df/cholesky.h>
 #include <src/integral/rys/eribatch.h>
 #include <src/integral/rys/smalleribatch.h>
 #include <src/integral/rys/mixederibatch.h>
 #include <src/integral/comprys/complexeribatch.h>
 #include <src/integral/comprys/complexsmalleribatch.h>
 #include <src/integral/comprys/complexmixederibatch.h>
-#include <src/integral/libint/libint.h>
+#include <src/integral/eribackend.h>
 #include <src/util/io/moldenin.h>
 #include <src/util/math/quatern.h>
 
@@ -48,7 +50,15 @@ Geometry::Geometry(shared_ptr<const PTree> geominfo) : magnetism_(false), do_per
   lmax_ = 0;
 
   schwarz_thresh_ = geominfo->get<double>("schwarz_thresh", 1.0e-12);
+  qqr_ = geominfo->get<bool>("qqr", false);
   overlap_thresh_ = geominfo->get<double>("thresh_overlap", 1.0e-8);
+  symmetry_ = to_lower(geominfo->get<string>("symmetry", "c1"));
+  df_sparse_ = geominfo->get<bool>("df_sparse", false);
+  df_scratch_ = geominfo->get<string>("df_scratch", "");
+  df_batch_memory_ = geominfo->get<int>("df_batch_memory", 256);
+  df_cache_ = geominfo->get<string>("df_cache", "");
+  df_cache_size_ = geominfo->get<int>("df_cache_size", 16384);
+  cholesky_thresh_ = geominfo->get<double>("cholesky_thresh", 0.0);
 
   // skip self interaction between the charges.
   skip_self_interaction_ = geominfo->get<bool>("skip_self_interaction", true);
@@ -155,18 +165,32 @@ Geometry::Geometry(shared_ptr<const PTree> geominfo) : magnetism_(false), do_per
 void Geometry::common_init2(const bool print, const double thresh, const bool nodf) {
 
   if (london_ || nonzero_magnetic_field()) init_magnetism();
+  init_symmetry(print);
 
-  if (!auxfile_.empty() && !nodf && !do_periodic_df_ && !fmm_) {
+  if (cholesky_thresh_ > 0.0 && !nodf && !do_periodic_df_ && !fmm_) {
+    if (magnetism_)
+      throw runtime_error("cholesky_thresh is not implemented with magnetic fields");
+    cout << "  Since cholesky_thresh is specified, we compute pivoted Cholesky vectors of the ERIs:" << endl;
+    Timer timer;
+    compute_integrals(thresh);
+    cout << "        elapsed time:  " << setw(10) << setprecision(2) << timer.tick() << " sec." << endl << endl;
+  } else if (!auxfile_.empty() && !nodf && !do_periodic_df_ && !fmm_) {
     if (print) cout << "  Number of auxiliary basis functions: " << setw(8) << naux() << endl << endl;
     cout << "  Since a DF basis is specified, we compute 2- and 3-index integrals:" << endl;
     const double scale = magnetism_ ? 2.0 : 1.0;
-    cout << "    o Being stored without compression. Storage requirement is "
+    if (df_sparse_ && !df_scratch_.empty())
+      throw runtime_error("df_sparse and df_scratch cannot be used together");
+    cout << "    o Being stored " << (df_scratch_.empty() ? "without compression" : "out of core") << ". Storage requirement is "
          << setprecision(3) << static_cast<size_t>(naux_)*nbasis()*nbasis()*scale*8.e-9 << " GB" << endl;
     Timer timer;
     compute_integrals(thresh);
     cout << "        elapsed time:  " << setw(10) << setprecision(2) << timer.tick() << " sec." << endl << endl;
   }
 
+  // the number of Cholesky vectors plays the role of the number of auxiliary functions
+  if (cholesky_thresh_ > 0.0 && df_)
+    naux_ = df_->naux();
+
   if (print) {
     cout << endl;
     cout << "  Number of basis functions: " << setw(8) << nbasis() << endl;
@@ -180,7 +204,8 @@ void Geometry::common_init2(const bool print, const double thresh, const bool no
 
 // suitable for geometry updates in optimization
 Geometry::Geometry(const Geometry& o, shared_ptr<const Matrix> displ, shared_ptr<const PTree> geominfo, const bool rotate, const bool nodf)
-  : Molecule(o, displ, rotate), schwarz_thresh_(o.schwarz_thresh_), magnetism_(false), london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_) {
+  : Molecule(o, displ, rotate), schwarz_thresh_(o.schwarz_thresh_), qqr_(o.qqr_), magnetism_(false), london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_),
+    df_sparse_(o.df_sparse_), df_scratch_(o.df_scratch_), df_batch_memory_(o.df_batch_memory_), df_cache_(o.df_cache_), df_cache_size_(o.df_cache_size_), cholesky_thresh_(o.cholesky_thresh_), symmetry_(o.symmetry_) {
 
   overlap_thresh_ = geominfo->get<double>("thresh_overlap", 1.0e-8);
   set_london(geominfo);
@@ -191,8 +216,8 @@ Geometry::Geometry(const Geometry& o, shared_ptr<const Matrix> displ, shared_ptr
 
 
 Geometry::Geometry(const Geometry& o, const array<double,3> displ)
-  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_),  magnetism_(false),
-    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_) {
+  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_), qqr_(o.qqr_),  magnetism_(false),
+    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_), df_sparse_(o.df_sparse_), df_scratch_(o.df_scratch_), df_batch_memory_(o.df_batch_memory_), df_cache_(o.df_cache_), df_cache_size_(o.df_cache_size_), cholesky_thresh_(o.cholesky_thresh_), symmetry_(o.symmetry_) {
 
   // members of Molecule
   spherical_ = o.spherical_;
@@ -222,8 +247,8 @@ Geometry::Geometry(const Geometry& o, const array<double,3> displ)
 
 // used when a new Geometry block is provided in input
 Geometry::Geometry(const Geometry& o, shared_ptr<const PTree> geominfo, const bool discard)
-  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_), magnetism_(false),
-    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_) {
+  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_), qqr_(o.qqr_), magnetism_(false),
+    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), fmm_(o.fmm_), df_sparse_(o.df_sparse_), df_scratch_(o.df_scratch_), df_batch_memory_(o.df_batch_memory_), df_cache_(o.df_cache_), df_cache_size_(o.df_cache_size_), cholesky_thresh_(o.cholesky_thresh_), symmetry_(o.symmetry_) {
 
   // members of Molecule
   spherical_ = o.spherical_;
@@ -238,7 +263,15 @@ Geometry::Geometry(const Geometry& o, shared_ptr<const PTree> geominfo, const bo
 
   // check all the options
   schwarz_thresh_ = geominfo->get<double>("schwarz_thresh", schwarz_thresh_);
+  qqr_ = geominfo->get<bool>("qqr", qqr_);
   overlap_thresh_ = geominfo->get<double>("thresh_overlap", overlap_thresh_);
+  symmetry_ = to_lower(geominfo->get<string>("symmetry", symmetry_));
+  df_sparse_ = geominfo->get<bool>("df_sparse", df_sparse_);
+  df_scratch_ = geominfo->get<string>("df_scratch", df_scratch_);
+  df_batch_memory_ = geominfo->get<int>("df_batch_memory", df_batch_memory_);
+  df_cache_ = geominfo->get<string>("df_cache", df_cache_);
+  df_cache_size_ = geominfo->get<int>("df_cache_size", df_cache_size_);
+  cholesky_thresh_ = geominfo->get<double>("cholesky_thresh", cholesky_thresh_);
 
   spherical_ = !geominfo->get<bool>("cartesian", !spherical_);
 
@@ -297,11 +330,14 @@ Geometry::Geometry(const Geometry& o, shared_ptr<const PTree> geominfo, const bo
 
   common_init1();
 
-  if (o.basisfile_ != basisfile_ || o.auxfile_ != auxfile_ || atoms || newfield) {
+  // the options that change how the 3-index integrals are stored or evaluated also require new integrals
+  const bool newstorage = o.df_sparse_ != df_sparse_ || o.df_scratch_ != df_scratch_ || o.symmetry_ != symmetry_
+                       || (df_sparse_ && (o.schwarz_thresh_ != schwarz_thresh_ || o.qqr_ != qqr_)) || (!df_scratch_.empty() && o.df_batch_memory_ != df_batch_memory_);
+  if (o.basisfile_ != basisfile_ || o.auxfile_ != auxfile_ || o.cholesky_thresh_ != cholesky_thresh_ || newstorage || atoms || newfield) {
     // discard the previous one before we compute the new one. Note that df_'s are mutable... too bad, I know..
     if (discard)
       o.discard_df();
-    common_init2(true, overlap_thresh_, auxfile_.empty());
+    common_init2(true, overlap_thresh_, auxfile_.empty() && cholesky_thresh_ <= 0.0);
   } else {
     df_ = o.df_;
     dfs_ = o.dfs_;
@@ -317,8 +353,9 @@ Geometry::Geometry(const Geometry& o, shared_ptr<const PTree> geominfo, const bo
 *  supergeometry                                            *
 ************************************************************/
 Geometry::Geometry(vector<shared_ptr<const Geometry>> nmer, const bool nodf) :
-  schwarz_thresh_(nmer.front()->schwarz_thresh_), overlap_thresh_(nmer.front()->overlap_thresh_), magnetism_(false), london_(nmer.front()->london_),
-  use_finite_(nmer.front()->use_finite_), do_periodic_df_(false), hcoreinfo_(nmer.front()->hcoreinfo()), fmm_(nmer.front()->fmm()) {
+  schwarz_thresh_(nmer.front()->schwarz_thresh_), overlap_thresh_(nmer.front()->overlap_thresh_), qqr_(nmer.front()->qqr_), magnetism_(false), london_(nmer.front()->london_),
+  use_finite_(nmer.front()->use_finite_), do_periodic_df_(false), hcoreinfo_(nmer.front()->hcoreinfo()), fmm_(nmer.front()->fmm()), df_sparse_(nmer.front()->df_sparse_), df_scratch_(nmer.front()->df_scratch_), df_batch_memory_(nmer.front()->df_batch_memory_),
+  df_cache_(nmer.front()->df_cache_), df_cache_size_(nmer.front()->df_cache_size_), cholesky_thresh_(nmer.front()->cholesky_thresh_), symmetry_("c1") {
 
   // A member of Molecule
   spherical_ = nmer.front()->spherical_;
@@ -362,6 +399,7 @@ Geometry::Geometry(vector<shared_ptr<const Geometry>> nmer, const bool nodf) :
   /* Use the strictest thresholds */
   for (auto& inmer : nmer) {
     schwarz_thresh_ = min(schwarz_thresh_, inmer->schwarz_thresh_);
+    qqr_ = qqr_ && inmer->qqr_;
     overlap_thresh_ = min(overlap_thresh_, inmer->overlap_thresh_);
   }
 
@@ -393,7 +431,15 @@ Geometry::Geometry(const vector<shared_ptr<const Atom>> atoms, shared_ptr<const
   const bool angstrom = geominfo->get<bool>("angstrom", false);
 
   schwarz_thresh_ = geominfo->get<double>("schwarz_thresh", 1.0e-12);
+  qqr_ = geominfo->get<bool>("qqr", false);
   overlap_thresh_ = geominfo->get<double>("thresh_overlap", 1.0e-8);
+  symmetry_ = to_lower(geominfo->get<string>("symmetry", "c1"));
+  df_sparse_ = geominfo->get<bool>("df_sparse", false);
+  df_scratch_ = geominfo->get<string>("df_scratch", "");
+  df_batch_memory_ = geominfo->get<int>("df_batch_memory", 256);
+  df_cache_ = geominfo->get<string>("df_cache", "");
+  df_cache_size_ = geominfo->get<int>("df_cache_size", 16384);
+  cholesky_thresh_ = geominfo->get<double>("cholesky_thresh", 0.0);
   skip_self_interaction_ = geominfo->get<bool>("skip_self_interaction", true);
 
   // cartesian or not. Look in the atoms info to find out
@@ -482,14 +528,10 @@ vector<double> Geometry::schwarz() const {
         shared_ptr<const Shell> b1 = basis[i1];
 
         array<shared_ptr<const Shell>,4> input = {{b1, b0, b1, b0}};
- #ifdef LIBINT_INTERFACE
-        Libint eribatch(input);
- #else
-        ERIBatch eribatch(input, 0.0);
- #endif
-        eribatch.compute();
-        const double* eridata = eribatch.data();
-        const int datasize = eribatch.data_size();
+        shared_ptr<RysInt> eribatch = make_eribatch(input, 0.0);
+        eribatch->compute();
+        const double* eridata = eribatch->data();
+        const int datasize = eribatch->data_size();
         double cmax = 0.0;
         for (int xi = 0; xi != datasize; ++xi, ++eridata) {
           const double absed = sqrt(abs(*eridata));
@@ -510,6 +552,53 @@ vector<double> Geometry::schwarz() const {
 }
 
 
+vector<shared_ptr<const ShellPair>> Geometry::shellpairs(const vector<double>& schwarz) const {
+  if (fmm_)
+    return fmm_->shellpairs();
+
+  vector<int> offsets;
+  vector<shared_ptr<const Shell>> basis;
+  for (int n = 0; n != natom(); ++n) {
+    const vector<int> tmpoff = offset(n);
+    offsets.insert(offsets.end(), tmpoff.begin(), tmpoff.end());
+    const vector<shared_ptr<const Shell>> tmpsh = atoms_[n]->shells();
+    basis.insert(basis.end(), tmpsh.begin(), tmpsh.end());
+  }
+
+  const int size = basis.size();
+  assert(schwarz.size() == size * size);
+  vector<shared_ptr<const ShellPair>> out(size * size);
+  for (int i0 = 0; i0 != size; ++i0)
+    for (int i1 = i0; i1 != size; ++i1)
+      out[i0*size+i1] = make_shared<const ShellPair>(array<shared_ptr<const Shell>,2>{{basis[i1], basis[i0]}}, array<int,2>{{offsets[i1], offsets[i0]}},
+                                                     make_pair(i1, i0), "yang", schwarz_thresh_, schwarz[i0*size+i1]);
+  return out;
+}
+
+
+void Geometry::init_symmetry(const bool print) {
+  plist_.reset();
+  aux_plist_.reset();
+  // London orbitals carry phase factors that are not invariant under the point-group operations
+  if (symmetry_ == "c1" || magnetism_) return;
+  try {
+    plist_ = make_shared<const Petite>(atoms_, symmetry_);
+    if (!aux_atoms_.empty())
+      aux_plist_ = make_shared<const Petite>(aux_atoms_, symmetry_);
+    if (print) {
+      cout << "  * " << symmetry_ << " symmetry is used in integral evaluation" << endl << endl;
+      if (df_sparse_ || !df_scratch_.empty())
+        cout << "  * warning: the 3-index integrals are computed without symmetry when df_sparse or df_scratch is used" << endl << endl;
+    }
+  } catch (const logic_error& e) {
+    plist_.reset();
+    aux_plist_.reset();
+    if (print)
+      cout << "  * the molecule does not conform to " << symmetry_ << " symmetry; symmetry is not used" << endl << endl;
+  }
+}
+
+
 void Geometry::get_electric_field(shared_ptr<const PTree>& geominfo) {
   // static external electric field
   external_[0] = geominfo->get<double>("ex", 0.0);
@@ -544,6 +633,8 @@ shared_ptr<const Geometry> Geometry::periodic(vector<shared_ptr<const Atom>> ato
 
 
 shared_ptr<const Geometry> Geometry::relativistic(const bool do_gaunt, const bool do_coulomb) const {
+  if (cholesky_thresh_ > 0.0)
+    throw runtime_error("cholesky_thresh is not implemented for relativistic methods");
   cout << "  *** Geometry (Relativistic) ***" << endl;
   Timer timer;
   // basically the same
@@ -602,15 +693,30 @@ void Geometry::set_london(shared_ptr<const PTree>& geominfo) {
 
 
 void Geometry::compute_integrals(const double thresh) const {
+  if (cholesky_thresh_ > 0.0) {
+    df_ = make_shared<DFDist_cholesky>(nbasis(), atoms(), cholesky_thresh_);
+  } else if (!magnetism_) {
+    // only the dense integrals are cached
+    unique_ptr<DFCache> cache;
+    string description;
+    if (!df_cache_.empty() && !df_sparse_ && df_scratch_.empty()) {
+      cache.reset(new DFCache(df_cache_, df_cache_size_));
+      description = DFCache::describe(atoms(), aux_atoms(), thresh);
+      df_ = cache->load(description, nbasis(), naux());
+      if (df_) return;
+    }
 #ifdef LIBINT_INTERFACE
-  if (!magnetism_)
-    df_ = form_fit<DFDist_ints<Libint>>(thresh, true); // true means we construct J^-1/2
+    using Batch = AutoERIBatch;
 #else
-  if (!magnetism_)
-    df_ = form_fit<DFDist_ints<ERIBatch>>(thresh, true); // true means we construct J^-1/2
+    using Batch = ERIBatch;
 #endif
-  else
+    df_ = make_shared<DFDist_ints<Batch>>(nbasis(), naux(), atoms(), aux_atoms(), thresh, true, 0.0, false, nullptr, false, plist_, aux_plist_,
+                                          df_sparse_ ? schwarz_thresh_ : 0.0, df_scratch_, df_batch_memory_, qqr_); // true means we construct J^-1/2
+    if (cache)
+      cache->save(description, df_);
+  } else {
     df_ = form_fit<ComplexDFDist_ints<ComplexERIBatch>>(thresh, true); // true means we construct J^-1/2
+  }
 }
 
 
@@ -639,8 +745,8 @@ void Geometry::init_magnetism() {
 
 
 Geometry::Geometry(const Geometry& o, const string type)
-  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_), magnetism_(false),
-    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_) {
+  : schwarz_thresh_(o.schwarz_thresh_), overlap_thresh_(o.overlap_thresh_), qqr_(o.qqr_), magnetism_(false),
+    london_(o.london_), use_finite_(o.use_finite_), do_periodic_df_(o.do_periodic_df_), hcoreinfo_(o.hcoreinfo_), df_sparse_(o.df_sparse_), df_scratch_(o.df_scratch_), df_batch_memory_(o.df_batch_memory_), df_cache_(o.df_cache_), df_cache_size_(o.df_cache_size_), cholesky_thresh_(o.cholesky_thresh_), symmetry_(o.symmetry_) {
 
   if (!o.fmm_)
     throw logic_error("Geometry construction called during FMM only");
@@ -29,6 +29,7 @@
 #include <src/df/df.h>
 #include <src/util/input/input.h>
 #include <src/molecule/molecule.h>
+#include <src/molecule/petite.h>
 #include <src/wfn/hcoreinfo.h>
 #include <src/wfn/fmminfo.h>
 
@@ -39,6 +40,8 @@ class Geometry : public Molecule {
     // integral screening
     double schwarz_thresh_;
     double overlap_thresh_;
+    // if true, the Schwarz bounds are multiplied by the distance-including (QQR) factor (see ShellPair::qqr)
+    bool qqr_;
 
     // for DF calculations
     mutable std::shared_ptr<DFDist> df_;
@@ -69,6 +72,23 @@ class Geometry : public Molecule {
     // FMM
     std::shared_ptr<const FMMInfo> fmm_;
 
+    // if true, 3-index integrals are stored only for significant shell pairs (screened by schwarz_thresh_)
+    bool df_sparse_;
+    // if not empty, 3-index integrals are stored out of core in this directory, in auxiliary batches of df_batch_memory_ MB
+    std::string df_scratch_;
+    int df_batch_memory_;
+    // if not empty, DF integrals are cached in this directory across jobs, using at most df_cache_size_ MB per process
+    std::string df_cache_;
+    int df_cache_size_;
+    // if positive, pivoted Cholesky vectors of the ERIs with this threshold are used in place of the DF integrals
+    double cholesky_thresh_;
+
+    // point-group symmetry used in integral evaluation (D2h and its subgroups)
+    std::string symmetry_;
+    std::shared_ptr<const Petite> plist_;
+    std::shared_ptr<const Petite> aux_plist_;
+    void init_symmetry(const bool print);
+
   private:
     // serialization
     friend class boost::serialization::access;
@@ -76,7 +96,7 @@ class Geometry : public Molecule {
     template<class Archive>
     void save(Archive& ar, const unsigned int) const {
       ar << boost::serialization::base_object<Molecule>(*this);
-      ar << schwarz_thresh_ << overlap_thresh_ << magnetism_ << london_ << use_finite_ << do_periodic_df_ << hcoreinfo_ << fmm_;
+      ar << schwarz_thresh_ << overlap_thresh_ << magnetism_ << london_ << use_finite_ << do_periodic_df_ << hcoreinfo_ << fmm_ << symmetry_ << df_sparse_ << df_scratch_ << df_batch_memory_ << df_cache_ << df_cache_size_ << cholesky_thresh_ << qqr_;
       const size_t dfindex = !df_ ? 0 : std::hash<DFDist*>()(df_.get());
       ar << dfindex;
       const bool do_rel   = !!dfs_;
@@ -85,9 +105,16 @@ class Geometry : public Molecule {
     }
 
     template<class Archive>
-    void load(Archive& ar, const unsigned int) {
+    void load(Archive& ar, const unsigned int version) {
       ar >> boost::serialization::base_object<Molecule>(*this);
       ar >> schwarz_thresh_ >> overlap_thresh_ >> magnetism_ >> london_ >> use_finite_ >> do_periodic_df_ >> hcoreinfo_ >> fmm_;
+      // the integral options below were added in version 1
+      if (version > 0)
+        ar >> symmetry_ >> df_sparse_ >> df_scratch_ >> df_batch_memory_ >> df_cache_ >> df_cache_size_ >> cholesky_thresh_;
+      // and QQR screening in version 2
+      if (version > 1)
+        ar >> qqr_;
+      init_symmetry(false);
       size_t dfindex;
       ar >> dfindex;
       static std::map<size_t, std::weak_ptr<DFDist>> dfmap;
@@ -112,7 +139,7 @@ class Geometry : public Molecule {
     }
 
   public:
-    Geometry() { }
+    Geometry() : qqr_(false), df_sparse_(false), df_batch_memory_(256), df_cache_size_(16384), cholesky_thresh_(0.0), symmetry_("c1") { }
     Geometry(std::shared_ptr<const PTree> idata);
     Geometry(const std::vector<std::shared_ptr<const Atom>> atoms, std::shared_ptr<const PTree> o);
     Geometry(const Geometry& o, std::shared_ptr<const PTree> idata, const bool discard_prev_df = true);
@@ -127,14 +154,25 @@ class Geometry : public Molecule {
     // Thresholds
     double schwarz_thresh() const { return schwarz_thresh_; }
     double overlap_thresh() const { return overlap_thresh_; }
+    bool qqr() const { return qqr_; }
     bool london() const { return london_; }
     bool magnetism() const { return magnetism_; }
 
     // returns schwarz screening TODO not working for DF yet
     std::vector<double> schwarz() const;
+    // shell pairs (i0 <= i1 at i0*size+i1) with their centres, extents and multipoles for the QQR screening, using the Schwarz factors above
+    std::vector<std::shared_ptr<const ShellPair>> shellpairs(const std::vector<double>& schwarz) const;
+
+    // Symmetry. plist() returns nullptr unless symmetry is requested and the molecule conforms to it
+    const std::string& symmetry() const { return symmetry_; }
+    std::shared_ptr<const Petite> plist() const { return plist_; }
+    std::shared_ptr<const Petite> aux_plist() const { return aux_plist_; }
 
     // Returns DF data
     std::shared_ptr<const DFDist> df() const { return df_; }
+    bool df_sparse() const { return df_sparse_; }
+    const std::string& df_scratch() const { return df_scratch_; }
+    double cholesky_thresh() const { return cholesky_thresh_; }
     std::shared_ptr<const DFDist> dfs() const { return dfs_; }
     std::shared_ptr<const DFDist> dfsl() const { return dfsl_; }
 
@@ -168,6 +206,8 @@ class Geometry : public Molecule {
 }
 
 #include <src/util/archive.h>
+#include <boost/serialization/version.hpp>
 BOOST_CLASS_EXPORT_KEY(bagel::Geometry)
+BOOST_CLASS_VERSION(bagel::Geometry, 2)
 
 #endif